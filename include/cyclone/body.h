@@ -2,6 +2,8 @@
 #define CYCLONE_BODY_H
 
 #include "core.h"
+#include "integration.h"
+#include "determinism.h"
 
 namespace cyclone {
 	/*
@@ -9,6 +11,20 @@ namespace cyclone {
 	* position and orientation, reacts to forces and torques, can be rendered
 	*/
 	class RigidBody {
+	public:
+		/*
+		* how the body takes part in the simulation
+		* dynamic bodies are moved by forces and contacts. kinematic bodies
+		* follow the transform they are driven to and push dynamic bodies
+		* without being pushed back. static bodies never move, they are
+		* level geometry that contacts treat as scenery
+		*/
+		enum BodyType : unsigned char {
+			BODY_DYNAMIC,
+			BODY_KINEMATIC,
+			BODY_STATIC
+		};
+
 	protected:
 		real inverseMass;
 		Vector3 position;
@@ -50,6 +66,40 @@ namespace cyclone {
 		Vector3 forceAccum;
 		Vector3 torqueAccum;
 
+		/*
+		* fast moving bodies are flagged as continuous so the collision
+		* detector sweeps them over the step instead of only testing the end pose
+		*/
+		bool continuous;
+
+		BodyType bodyType;
+
+		/*
+		* where a kinematic body has been asked to be at the end of the step
+		*/
+		Vector3 targetPosition;
+		Quaternion targetOrientation;
+		bool hasTarget;
+
+		/*
+		* moves a kinematic body to its target, or on at its velocity
+		*/
+		void integrateKinematic(real duration);
+
+		/*
+		* steps kinematic and static bodies, false leaves a dynamic body
+		* to the caller
+		*/
+		bool integrateFixed(real duration);
+
+		/*
+		* the parts of a step shared by both integrate overloads, with
+		* damping^duration already worked out. the linear part is semi
+		* implicit euler, the angular part only updates the rotation
+		*/
+		void integrateLinear(real duration, real linearFactor);
+		void integrateAngular(real duration, real angularFactor);
+
 	public:
 		RigidBody();
 
@@ -68,6 +118,12 @@ namespace cyclone {
 		*/
 		void integrate(real duration);
 
+		/*
+		* simulates over the context's step with its integration and rotation
+		* schemes, reusing its cached damping factors
+		*/
+		void integrate(IntegrationContext& context);
+
 		/*
 		* add force to the center of mass
 		*/
@@ -88,6 +144,11 @@ namespace cyclone {
 
 		void addForceAtBodyPoint(const Vector3& force, const Vector3& point);
 
+		/*
+		* add torque about the center of mass
+		*/
+		void addTorque(const Vector3& torque);
+
 		void clearAccumulators();
 
 		void setMass(real mass);
@@ -95,13 +156,47 @@ namespace cyclone {
 		void setInverseMass(real inverseMass);
 		real getInverseMass() const;
 
+		/*
+		* true for dynamic bodies with a mass, kinematic and static bodies
+		* have infinite mass whatever mass they were given
+		*/
 		bool hasFiniteMass() const;
 
+		/*
+		* a kinematic or static body keeps its mass, and gets it back when it
+		* is made dynamic again. static bodies are not integrated, so their
+		* derived data only needs calculating once they are positioned
+		*/
+		void setBodyType(BodyType type);
+		BodyType getBodyType() const;
+
+		bool isDynamic() const {
+			return bodyType == BODY_DYNAMIC;
+		}
+
+		bool isKinematic() const {
+			return bodyType == BODY_KINEMATIC;
+		}
+
+		bool isStatic() const {
+			return bodyType == BODY_STATIC;
+		}
+
+		/*
+		* the transform a kinematic body reaches at the end of the next step
+		* integrate sets the velocity and rotation that get it there, so
+		* contacts see the body move instead of teleport. without a target
+		* the body carries on at its velocity and rotation
+		*/
+		void setKinematicTarget(const Vector3& position, const Quaternion& orientation);
+
 		void setInertiaTensor(const Matrix3& inertiaTensor);
 		void getInertiaTensor(Matrix3* inertiaTensor) const;
 		void getInertiaTensorWorld(Matrix3* inertiaTensor) const;
 
 		void setDamping(real linearDamping, real angularDamping);
+		real getLinearDamping() const;
+		real getAngularDamping() const;
 
 		void setPosition(const Vector3& position);
 		void setPosition(const real x, const real y, const real z);
@@ -123,6 +218,23 @@ namespace cyclone {
 		Vector3 getVelocity() const;
 		void addVelocity(const Vector3& deltaVelocity);
 
+		void setAccelaration(const Vector3& accelaration);
+		Vector3 getAccelaration() const;
+
+		/*
+		* acceleration of the last integration step (constant + accumulated forces)
+		* used by the contact resolver to remove velocity built up by resting contacts
+		*/
+		Vector3 getLastFrameAccelaration() const;
+
+		/*
+		* adds the state that carries over between steps to the hash
+		*/
+		void hashState(StateHash* hash) const;
+
+		void setContinuous(bool continuous);
+		bool isContinuous() const;
+
 		void setRotation(const Vector3& rotation);
 		void setRotation(const real x, const real y, const real z);
 		Vector3 getRotation() const;
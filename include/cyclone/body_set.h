@@ -0,0 +1,178 @@
+#ifndef CYCLONE_BODY_SET_H
+#define CYCLONE_BODY_SET_H
+
+#include "body.h"
+#include "parallel.h"
+#include "snapshot.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* many rigid bodies stored as structure of arrays
+	* the state integrate touches every step (position, orientation, velocity,
+	* rotation, forces and the world inertia tensor) is kept in one array per
+	* component so a step streams through memory and the loops vectorise.
+	* the body space inertia tensor and the transform matrix are only read by
+	* the derived data pass and by collision code, so they are kept apart.
+	* bodies are addressed by index and behave like RigidBody
+	*/
+	class RigidBodySet {
+	public:
+		/*
+		* adds a body with the state of the given one, returns its index
+		*/
+		unsigned add(const RigidBody& body);
+
+		/*
+		* adds a body with RigidBody's default state
+		*/
+		unsigned add();
+
+		/*
+		* copies a body's state into a RigidBody, e.g. for collision primitives
+		*/
+		void store(unsigned index, RigidBody* body) const;
+
+		/*
+		* copies a RigidBody's state into the set
+		*/
+		void load(unsigned index, const RigidBody& body);
+
+		unsigned size() const {
+			return (unsigned)inverseMass.size();
+		}
+
+		void reserve(unsigned count);
+
+		void clear();
+
+		/*
+		* simulates every body forward in time, like RigidBody::integrate,
+		* and updates their derived data
+		*/
+		void integrate(real duration);
+
+		/*
+		* the same, split across the pool
+		*/
+		void integrate(real duration, ThreadPool& pool);
+
+		/*
+		* recalculates transforms and world inertia tensors for all bodies
+		* needs to be called after manually setting positions/orientations
+		*/
+		void calculateDerivedData();
+
+		void clearAccumulators();
+
+		/*
+		* the context the set takes damping factors from, e.g. to pick its mode,
+		* integration scheme or rotation scheme
+		*/
+		IntegrationContext& getIntegrationContext() {
+			return integrationContext;
+		}
+
+		void addForce(unsigned index, const Vector3& force);
+		void addForceAtPoint(unsigned index, const Vector3& force, const Vector3& point);
+		void addTorque(unsigned index, const Vector3& torque);
+
+		void setMass(unsigned index, real mass);
+		void setInverseMass(unsigned index, real inverseMass);
+		real getInverseMass(unsigned index) const;
+
+		/*
+		* takes the inverse inertia tensor, like RigidBody::setInertiaTensor
+		*/
+		void setInertiaTensor(unsigned index, const Matrix3& inverseInertiaTensor);
+		void getInertiaTensorWorld(unsigned index, Matrix3* inverseInertiaTensor) const;
+
+		void setDamping(unsigned index, real linearDamping, real angularDamping);
+
+		void setPosition(unsigned index, const Vector3& position);
+		Vector3 getPosition(unsigned index) const;
+
+		void setOrientation(unsigned index, const Quaternion& orientation);
+		Quaternion getOrientation(unsigned index) const;
+
+		void setVelocity(unsigned index, const Vector3& velocity);
+		Vector3 getVelocity(unsigned index) const;
+
+		void setRotation(unsigned index, const Vector3& rotation);
+		Vector3 getRotation(unsigned index) const;
+
+		void setAccelaration(unsigned index, const Vector3& accelaration);
+		Vector3 getLastFrameAccelaration(unsigned index) const;
+
+		/*
+		* buffer that integrate publishes every body's state to, in index
+		* order, at the end of each step. null stops publishing
+		*/
+		void setSnapshotBuffer(SnapshotBuffer* buffer);
+
+		/*
+		* hash of every body's state in index order, like RigidBody::hashState
+		*/
+		uint64_t stateHash() const;
+
+		const Matrix4& getTransform(unsigned index) const {
+			return transform[index];
+		}
+
+	private:
+		void integrateRange(unsigned begin, unsigned end, real duration);
+
+		// position and velocity with the context's scheme
+		template <IntegrationContext::IntegrationScheme scheme>
+		void integrateLinear(unsigned begin, unsigned end, real duration);
+
+		// rotation and orientation with the context's rotation scheme
+		void integrateAngular(unsigned begin, unsigned end, real duration);
+
+		void calculateDerivedRange(unsigned begin, unsigned end);
+
+		void publishRange(TransformState* states, unsigned begin, unsigned end) const;
+
+		/*
+		* recomputes the damping factors when the step length or a damping changes
+		*/
+		void prepareDamping(real duration);
+
+		// hot: read and written by every integration step
+		std::vector<real> positionX, positionY, positionZ;
+		std::vector<real> velocityX, velocityY, velocityZ;
+		std::vector<real> rotationX, rotationY, rotationZ;
+		std::vector<real> orientationR, orientationI, orientationJ, orientationK;
+		std::vector<real> forceX, forceY, forceZ;
+		std::vector<real> torqueX, torqueY, torqueZ;
+		std::vector<real> accelarationX, accelarationY, accelarationZ;
+		std::vector<real> inverseMass;
+
+		// world inverse inertia tensor, one array per matrix entry
+		std::vector<real> inertiaWorld[9];
+
+		/*
+		* damping raised to the power of the step length, cached so the step
+		* does not call std::pow per body. linearDamping and angularDamping
+		* are the raw values. the factors come from the context, which only
+		* works out each distinct damping value once
+		*/
+		std::vector<real> linearDamping, angularDamping;
+		std::vector<real> linearFactor, angularFactor;
+		real dampingDuration = -1;
+		bool dampingChanged = true;
+		IntegrationContext integrationContext;
+
+		SnapshotBuffer* snapshots = nullptr;
+		uint64_t steps = 0;
+
+		// cold: only read when derived data is rebuilt or by collision code
+		std::vector<Matrix3> inverseInertiaTensor;
+		std::vector<Matrix4> transform;
+		std::vector<Vector3> lastFrameAccelaration;
+	};
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef CYCLONE_BODY_STEP_H
+#define CYCLONE_BODY_STEP_H
+
+#include "body.h"
+#include "fgen.h"
+#include "contacts.h"
+#include "contact_buffer.h"
+#include "collide_broad.h"
+#include "collide_dispatch.h"
+#include "parallel.h"
+#include "task_graph.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* the phases of a rigid body step: forces, collision data of the
+	* primitives, broadphase, narrowphase and resolution, integration
+	* it owns none of the parts, they are set up by the caller, only the
+	* pairs and the contacts of the frame. addStepTasks adds the phases to a
+	* task graph like ParticleWorld::addStepTasks, so the force pass and the
+	* primitive pass run side by side with each other and with particles
+	*/
+	class RigidBodyStep {
+	public:
+		/*
+		* maxContacts: starting capacity of the contact buffer, which grows
+		* when a frame needs more
+		*/
+		RigidBodyStep(std::vector<RigidBody*>& bodies, std::vector<CollisionPrimitive*>& primitives,
+			ForceRegistry& forces, CollisionBroadPhase& broadPhase, ContactResolver& resolver, unsigned maxContacts = 256);
+
+		/*
+		* pool for the primitive and integration passes
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		void setDispatcher(const CollisionDispatcher* dispatcher);
+
+		/*
+		* friction and restitution of the contacts
+		*/
+		void setContactMaterial(real friction, real restitution);
+
+		/*
+		* the phases of one step, in order, on the caller
+		*/
+		void step(real duration);
+
+		/*
+		* adds the phases to a step graph over the body resources
+		*/
+		void addStepTasks(TaskGraph& graph);
+
+		ContactBuffer<Contact>& getContactBuffer();
+
+		/*
+		* contacts found in the last step
+		*/
+		unsigned getContactCount() const;
+
+		/*
+		* hash of every body's state in list order, see StateHash
+		*/
+		uint64_t stateHash() const;
+
+	private:
+		void updatePrimitives();
+		void findPairs(real duration);
+		void resolveContacts(real duration);
+		void integrate(real duration);
+
+		std::vector<RigidBody*>& bodies;
+		std::vector<CollisionPrimitive*>& primitives;
+		ForceRegistry& forces;
+		CollisionBroadPhase& broadPhase;
+		ContactResolver& resolver;
+		const CollisionDispatcher* dispatcher;
+
+		std::vector<PrimitivePair> pairs;
+		ContactBuffer<Contact> contactBuffer;
+		CollisionData data;
+		unsigned contactCount = 0;
+
+		ThreadPool* pool = nullptr;
+	};
+}
+
+#endif // !CYCLONE_BODY_STEP_H
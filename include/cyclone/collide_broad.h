@@ -0,0 +1,102 @@
+#ifndef CYCLONE_COLLISION_BROAD_H
+#define CYCLONE_COLLISION_BROAD_H
+
+#include "collide_coarse.h"
+#include "collide_dispatch.h"
+
+#include <vector>
+
+namespace cyclone {
+
+    /**
+     * Finds the primitive pairs that may be touching, for the dispatcher.
+     *
+     * Static primitives (level geometry, whose bodies are static or null)
+     * are kept in their own bounding volume tree. It is built once, the
+     * first time pairs are found after statics were added, and never
+     * refitted, so a level made mostly of statics costs nothing per frame
+     * beyond the queries into it. Moving primitives (dynamic and kinematic
+     * bodies) have their bounds taken from their current pose every frame;
+     * dynamic ones query the static tree and all of them are swept against
+     * each other along x. Pairs where neither body is dynamic are never
+     * generated, and every pair has a dynamic primitive first.
+     */
+    class CollisionBroadPhase {
+    public:
+        /**
+         * Adds level geometry. The bounds are taken from the primitive's
+         * current pose, so calculateInternals must have run. The primitive
+         * must not move afterwards.
+         */
+        void addStatic(const CollisionSphere* sphere);
+        void addStatic(const CollisionBox* box);
+
+        /**
+         * Adds level geometry of any type with bounds given by the caller.
+         */
+        void addStatic(const CollisionPrimitive* primitive, const BoundingBox& bounds);
+
+        /**
+         * Adds a primitive of a dynamic or kinematic body.
+         */
+        void addMoving(const CollisionSphere* sphere);
+        void addMoving(const CollisionBox* box);
+
+        /**
+         * Removes all primitives.
+         */
+        void clear();
+
+        /**
+         * Grows the bounds of moving primitives, so pairs are found a
+         * little before the shapes touch (e.g. for speculative contacts).
+         */
+        void setMargin(real margin);
+
+        /**
+         * Replaces the contents of pairs with the pairs found from the
+         * primitives' current poses. Returns how many there are. With a
+         * duration, the bounds of continuous bodies are stretched over the
+         * distance they will travel in it, so a fast body is paired with
+         * thin geometry it would otherwise pass through in one step.
+         */
+        unsigned findPairs(std::vector<PrimitivePair>& pairs, real duration = 0);
+
+        unsigned getStaticCount() const {
+            return (unsigned)statics.size();
+        }
+
+        unsigned getMovingCount() const {
+            return (unsigned)moving.size();
+        }
+
+    private:
+        enum ShapeKind : unsigned char {
+            SPHERE,
+            BOX
+        };
+
+        struct Shape {
+            const CollisionPrimitive* primitive;
+            ShapeKind kind;
+        };
+
+        void updateMovingBounds(real duration);
+
+        std::vector<const CollisionPrimitive*> statics;
+        std::vector<BoundingBox> staticBounds;
+        BoundingVolumeTree staticTree;
+        bool staticsBuilt = false;
+
+        std::vector<Shape> moving;
+        std::vector<BoundingBox> movingBounds;
+
+        // moving primitives ordered by the minimum x of their bounds
+        std::vector<unsigned> sweepOrder;
+
+        real margin = 0;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_BROAD_H
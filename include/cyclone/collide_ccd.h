@@ -0,0 +1,73 @@
+#ifndef CYCLONE_COLLIDE_CCD_H
+#define CYCLONE_COLLIDE_CCD_H
+
+#include "collide_fine.h"
+
+namespace cyclone {
+
+    /**
+     * Result of a sweep: when and where the moving shapes first touch.
+     */
+    struct SweepHit {
+        // Fraction of the motion at which the shapes touch, in [0, 1]
+        real time;
+
+        // Separation of the shapes at the start of the motion (lower bound)
+        real distance;
+
+        // Point of first contact, in world space
+        Vector3 point;
+
+        // Contact normal at the time of impact, pointing towards the first shape
+        Vector3 normal;
+    };
+
+    /**
+     * Time of impact tests. Each shape is swept along its motion
+     * (the displacement over the step). Box rotations are the angular
+     * displacement over the step and are applied about the owning body's
+     * centre of mass; boxes use conservative advancement so they may spin.
+     * A sphere swept against a box only sees the box translate.
+     */
+    class SweepTests {
+    public:
+        static bool sphereAndHalfSpace(const CollisionSphere& sphere, const Vector3& motion,
+            const CollisionPlane& plane, SweepHit* hit);
+
+        static bool sphereAndSphere(const CollisionSphere& one, const Vector3& motionOne,
+            const CollisionSphere& two, const Vector3& motionTwo, SweepHit* hit);
+
+        static bool sphereAndBox(const CollisionSphere& sphere, const Vector3& motion,
+            const CollisionBox& box, const Vector3& boxMotion, SweepHit* hit);
+
+        static bool boxAndHalfSpace(const CollisionBox& box, const Vector3& motion, const Vector3& rotation,
+            const CollisionPlane& plane, SweepHit* hit);
+
+        static bool boxAndBox(const CollisionBox& one, const Vector3& motionOne, const Vector3& rotationOne,
+            const CollisionBox& two, const Vector3& motionTwo, const Vector3& rotationTwo, SweepHit* hit);
+    };
+
+    /**
+     * Continuous versions of the CollisionDetector routines.
+     *
+     * Pairs where neither body is flagged continuous (RigidBody::setContinuous)
+     * go straight to the discrete test, so only fast bodies pay for the sweep.
+     * For fast bodies that are not yet touching, the motion predicted for the
+     * next step (velocity * duration) is swept and a speculative contact is
+     * written if they would meet: its penetration is minus the remaining gap,
+     * and the resolver only removes the closing velocity that would cross it.
+     * Contacts use the same body order and normal direction as the discrete tests.
+     */
+    class ContinuousDetector {
+    public:
+        static unsigned sphereAndHalfSpace(const CollisionSphere& sphere, const CollisionPlane& plane, real duration, CollisionData* data);
+        static unsigned sphereAndSphere(const CollisionSphere& one, const CollisionSphere& two, real duration, CollisionData* data);
+
+        static unsigned boxAndHalfSpace(const CollisionBox& box, const CollisionPlane& plane, real duration, CollisionData* data);
+        static unsigned boxAndBox(const CollisionBox& one, const CollisionBox& two, real duration, CollisionData* data);
+        static unsigned boxAndSphere(const CollisionBox& box, const CollisionSphere& sphere, real duration, CollisionData* data);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLIDE_CCD_H
@@ -0,0 +1,269 @@
+#ifndef CYCLONE_COLLISION_COARSE_H
+#define CYCLONE_COLLISION_COARSE_H
+
+#include "collide_fine.h"
+
+#include <cassert>
+#include <cfloat>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CYCLONE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace cyclone {
+
+    /**
+     * An axis aligned bounding box.
+     */
+    struct BoundingBox {
+        Vector3 min;
+        Vector3 max;
+
+        // A box that contains nothing, grows when points are enclosed
+        static BoundingBox empty() {
+            BoundingBox box;
+            box.min = Vector3(DBL_MAX, DBL_MAX, DBL_MAX);
+            box.max = Vector3(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+            return box;
+        }
+
+        void enclose(const Vector3& point) {
+            min = Vector3(std::fmin(min.x, point.x), std::fmin(min.y, point.y), std::fmin(min.z, point.z));
+            max = Vector3(std::fmax(max.x, point.x), std::fmax(max.y, point.y), std::fmax(max.z, point.z));
+        }
+
+        void enclose(const BoundingBox& other) {
+            enclose(other.min);
+            enclose(other.max);
+        }
+
+        bool overlaps(const BoundingBox& other) const {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                min.y <= other.max.y && max.y >= other.min.y &&
+                min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        Vector3 getCentre() const {
+            return (min + max) * 0.5;
+        }
+
+        Vector3 getHalfSize() const {
+            return (max - min) * 0.5;
+        }
+
+        // Bounds of the shapes in their current (calculateInternals) pose
+        static BoundingBox of(const CollisionSphere& sphere);
+        static BoundingBox of(const CollisionBox& box);
+    };
+
+    /**
+     * A bounding volume hierarchy over a set of items, each given by its bounds.
+     *
+     * The tree is binary and flattened into an array in depth first order.
+     * Every node stores the bounds of both of its children side by side, so a
+     * ray is tested against the pair with one SIMD slab test. Leaves hold up
+     * to maxLeafSize items. Traversal is read only and safe to run from any
+     * number of threads; build and refit are not.
+     */
+    class BoundingVolumeTree {
+    public:
+        struct Node {
+            real minX[2], minY[2], minZ[2];
+            real maxX[2], maxY[2], maxZ[2];
+
+            // Index of a child node, or ~index of a leaf when negative
+            int child[2];
+        };
+
+        struct Leaf {
+            unsigned first;
+            unsigned count;
+        };
+
+        static const unsigned maxLeafSize = 4;
+
+        /**
+         * Builds the tree over items 0..count-1 using a median split
+         * along the longest axis of the item centres.
+         */
+        void build(const BoundingBox* bounds, unsigned count);
+
+        /**
+         * Updates the node bounds for moved items without changing the
+         * topology. Cheap, but the tree degrades if items move far.
+         */
+        void refit(const BoundingBox* bounds);
+
+        void clear();
+
+        bool isEmpty() const {
+            return nodes.empty();
+        }
+
+        /**
+         * Item indices in leaf order, leaves refer to ranges of this array.
+         */
+        const unsigned* getItems() const {
+            return items.data();
+        }
+
+        BoundingBox getBounds() const;
+
+        /**
+         * Visits leaves hit by the ray, nearest first. The bounds are grown by
+         * inflate (for shape casts). The visitor is called as
+         *     real visit(const unsigned* items, unsigned count, real maxDistance)
+         * and returns the new maximum distance, so closer hits prune the rest.
+         */
+        template <typename LeafVisitor>
+        void raycast(const Vector3& origin, const Vector3& direction, real maxDistance,
+            real inflate, LeafVisitor&& visit) const;
+
+        /**
+         * Calls visit(item) for every item whose bounds overlap the box.
+         */
+        template <typename ItemVisitor>
+        void overlap(const BoundingBox& box, ItemVisitor&& visit) const;
+
+    private:
+        static const unsigned maxDepth = 64;
+
+        int buildRange(const BoundingBox* bounds, unsigned first, unsigned count, unsigned depth);
+
+        void setChildBounds(Node& node, unsigned slot, const BoundingBox& box);
+
+        BoundingBox childBounds(const Node& node, unsigned slot) const;
+
+        std::vector<Node> nodes;
+        std::vector<Leaf> leaves;
+        std::vector<unsigned> items;
+
+        // centres used while building, kept to avoid reallocating
+        std::vector<Vector3> centres;
+    };
+
+    /**
+     * Slab test of a ray against both children of a node.
+     * Writes the entry distances and returns a two bit hit mask.
+     */
+    inline unsigned raycastNodePair(const BoundingVolumeTree::Node& node, const Vector3& origin,
+        const real inverse[3], real inflate, real maxDistance, real entry[2]) {
+#ifdef CYCLONE_SSE2
+        const __m128d grow = _mm_set1_pd(inflate);
+        const __m128d ox = _mm_set1_pd(origin.x), oy = _mm_set1_pd(origin.y), oz = _mm_set1_pd(origin.z);
+        const __m128d ix = _mm_set1_pd(inverse[0]), iy = _mm_set1_pd(inverse[1]), iz = _mm_set1_pd(inverse[2]);
+
+        __m128d t0x = _mm_mul_pd(_mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(node.minX), grow), ox), ix);
+        __m128d t1x = _mm_mul_pd(_mm_sub_pd(_mm_add_pd(_mm_loadu_pd(node.maxX), grow), ox), ix);
+        __m128d t0y = _mm_mul_pd(_mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(node.minY), grow), oy), iy);
+        __m128d t1y = _mm_mul_pd(_mm_sub_pd(_mm_add_pd(_mm_loadu_pd(node.maxY), grow), oy), iy);
+        __m128d t0z = _mm_mul_pd(_mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(node.minZ), grow), oz), iz);
+        __m128d t1z = _mm_mul_pd(_mm_sub_pd(_mm_add_pd(_mm_loadu_pd(node.maxZ), grow), oz), iz);
+
+        __m128d enter = _mm_max_pd(
+            _mm_max_pd(_mm_min_pd(t0x, t1x), _mm_min_pd(t0y, t1y)),
+            _mm_max_pd(_mm_min_pd(t0z, t1z), _mm_setzero_pd()));
+        __m128d exit = _mm_min_pd(
+            _mm_min_pd(_mm_max_pd(t0x, t1x), _mm_max_pd(t0y, t1y)),
+            _mm_min_pd(_mm_max_pd(t0z, t1z), _mm_set1_pd(maxDistance)));
+
+        _mm_storeu_pd(entry, enter);
+        return (unsigned)_mm_movemask_pd(_mm_cmple_pd(enter, exit));
+#else
+        unsigned mask = 0;
+        for (unsigned i = 0; i < 2; i++) {
+            real t0x = (node.minX[i] - inflate - origin.x) * inverse[0];
+            real t1x = (node.maxX[i] + inflate - origin.x) * inverse[0];
+            real t0y = (node.minY[i] - inflate - origin.y) * inverse[1];
+            real t1y = (node.maxY[i] + inflate - origin.y) * inverse[1];
+            real t0z = (node.minZ[i] - inflate - origin.z) * inverse[2];
+            real t1z = (node.maxZ[i] + inflate - origin.z) * inverse[2];
+
+            real enter = std::fmax(std::fmax(std::fmin(t0x, t1x), std::fmin(t0y, t1y)), std::fmax(std::fmin(t0z, t1z), (real)0));
+            real exit = std::fmin(std::fmin(std::fmax(t0x, t1x), std::fmax(t0y, t1y)), std::fmin(std::fmax(t0z, t1z), maxDistance));
+            entry[i] = enter;
+            if (enter <= exit) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    template <typename LeafVisitor>
+    void BoundingVolumeTree::raycast(const Vector3& origin, const Vector3& direction, real maxDistance,
+        real inflate, LeafVisitor&& visit) const {
+        if (nodes.empty()) return;
+
+        // large finite reciprocals keep zero direction components out of NaN territory
+        real inverse[3];
+        const real components[3] = { direction.x, direction.y, direction.z };
+        for (unsigned i = 0; i < 3; i++) {
+            inverse[i] = std::abs(components[i]) > 1e-12 ? 1 / components[i] : (components[i] < 0 ? -1e30 : 1e30);
+        }
+
+        int stack[maxDepth];
+        unsigned top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+
+            real entry[2];
+            unsigned mask = raycastNodePair(node, origin, inverse, inflate, maxDistance, entry);
+            if (!mask) continue;
+
+            unsigned nearSlot = (mask == 3 && entry[1] < entry[0]) ? 1 : 0;
+            unsigned order[2] = { nearSlot, 1 - nearSlot };
+
+            // leaves are visited straight away nearest first, nodes are pushed far first
+            int pushed[2];
+            unsigned pushCount = 0;
+            for (unsigned slot : order) {
+                if (!(mask & (1u << slot)) || entry[slot] > maxDistance) continue;
+
+                int child = node.child[slot];
+                if (child < 0) {
+                    const Leaf& leaf = leaves[~child];
+                    if (leaf.count) maxDistance = visit(&items[leaf.first], leaf.count, maxDistance);
+                }
+                else {
+                    pushed[pushCount++] = child;
+                }
+            }
+            while (pushCount > 0) {
+                assert(top < maxDepth);
+                stack[top++] = pushed[--pushCount];
+            }
+        }
+    }
+
+    template <typename ItemVisitor>
+    void BoundingVolumeTree::overlap(const BoundingBox& box, ItemVisitor&& visit) const {
+        if (nodes.empty()) return;
+
+        int stack[maxDepth];
+        unsigned top = 0;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            for (unsigned slot = 0; slot < 2; slot++) {
+                if (!box.overlaps(childBounds(node, slot))) continue;
+
+                int child = node.child[slot];
+                if (child < 0) {
+                    const Leaf& leaf = leaves[~child];
+                    for (unsigned i = 0; i < leaf.count; i++) visit(items[leaf.first + i]);
+                }
+                else {
+                    assert(top < maxDepth);
+                    stack[top++] = child;
+                }
+            }
+        }
+    }
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_COARSE_H
@@ -0,0 +1,187 @@
+#ifndef CYCLONE_COLLISION_CONVEX_H
+#define CYCLONE_COLLISION_CONVEX_H
+
+#include "collide_fine.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace cyclone {
+
+    /**
+     * A convex hull given by a cloud of points in the primitive's local space.
+     *
+     * Building the hull keeps the points that lie on it and links each to its
+     * neighbours along hull edges. A support query then walks uphill from a
+     * starting vertex instead of testing every point; on a convex polytope the
+     * first vertex with no better neighbour is the furthest one. Starting from
+     * the previous frame's answer usually takes only a step or two.
+     */
+    class CollisionConvex : public CollisionPrimitive {
+    public:
+        CollisionConvex() : CollisionPrimitive(PRIMITIVE_CONVEX) {}
+
+        /**
+         * Sets the points and builds the hull. Points inside the hull are dropped.
+         */
+        void setVertices(const Vector3* points, unsigned count);
+
+        unsigned getVertexCount() const {
+            return (unsigned)vertices.size();
+        }
+
+        // A hull vertex in local space
+        const Vector3& getVertex(unsigned index) const {
+            return vertices[index];
+        }
+
+        /**
+         * Index of the vertex furthest along the local direction.
+         * start is where the hill climb begins (any valid vertex index).
+         */
+        unsigned supportIndex(const Vector3& localDirection, unsigned start = 0) const;
+
+        /**
+         * The furthest point along a world direction, in world space.
+         */
+        Vector3 support(const Vector3& direction) const;
+
+        // Distance from the local origin to the furthest vertex
+        real getBoundingRadius() const {
+            return boundingRadius;
+        }
+
+    private:
+        std::vector<Vector3> vertices;
+
+        /*
+        * hull edges in compressed rows: the neighbours of vertex i are
+        * neighbours[neighbourStart[i] .. neighbourStart[i + 1])
+        */
+        std::vector<unsigned> neighbourStart;
+        std::vector<unsigned> neighbours;
+
+        real boundingRadius = 0;
+    };
+
+    /**
+     * Frame to frame state for one pair of shapes, kept by the caller.
+     *
+     * Holds the feature indices of the last GJK simplex, which seed the next
+     * run at the shapes' new poses, and the hill climbing start vertices.
+     * Coherent pairs then converge in one or two iterations.
+     */
+    struct GjkCache {
+        unsigned indexA[4];
+        unsigned indexB[4];
+        unsigned count = 0;
+    };
+
+    /**
+     * A primitive seen through its support function, as used by GJK and EPA.
+     *
+     * Spheres are treated as their centre point plus a margin of the radius,
+     * so their contacts are exact instead of converging on a curved surface.
+     */
+    class ConvexShape {
+    public:
+        ConvexShape(const CollisionSphere& sphere);
+        ConvexShape(const CollisionBox& box);
+        ConvexShape(const CollisionConvex& convex);
+
+        /**
+         * Furthest point of the core shape (without margin) along the world
+         * direction; index receives its feature index and holds the start hint.
+         */
+        Vector3 support(const Vector3& direction, unsigned* index) const;
+
+        /**
+         * The core point with the given feature index, in world space.
+         */
+        Vector3 vertex(unsigned index) const;
+
+        Vector3 getCentre() const;
+
+        const CollisionPrimitive* primitive;
+        real margin;
+
+    private:
+        enum Kind : unsigned char {
+            POINT,
+            BOX,
+            HULL
+        };
+
+        Kind kind;
+    };
+
+    /**
+     * GJK distance and EPA penetration between any pair of convex shapes.
+     *
+     * The contact functions follow the CollisionDetector conventions: the
+     * first shape's body is contact[0] and the normal points from the second
+     * shape towards the first. Passing a GjkCache is optional but lets the
+     * pair reuse last frame's simplex.
+     */
+    class ConvexDetector {
+    public:
+        /**
+         * Distance between the shapes, zero if they overlap. Writes the
+         * closest points on each surface when separated.
+         */
+        static real distance(const ConvexShape& one, const ConvexShape& two,
+            Vector3* pointOne, Vector3* pointTwo, GjkCache* cache = nullptr);
+
+        /**
+         * Generates a contact for overlapping shapes.
+         */
+        static unsigned collide(const ConvexShape& one, const ConvexShape& two,
+            CollisionData* data, GjkCache* cache = nullptr);
+
+        static unsigned convexAndHalfSpace(const CollisionConvex& convex, const CollisionPlane& plane, CollisionData* data);
+
+        static unsigned convexAndSphere(const CollisionConvex& convex, const CollisionSphere& sphere,
+            CollisionData* data, GjkCache* cache = nullptr);
+        static unsigned convexAndBox(const CollisionConvex& convex, const CollisionBox& box,
+            CollisionData* data, GjkCache* cache = nullptr);
+        static unsigned convexAndConvex(const CollisionConvex& one, const CollisionConvex& two,
+            CollisionData* data, GjkCache* cache = nullptr);
+    };
+
+    /**
+     * Keeps a GjkCache for every pair that was tested recently.
+     * Call endFrame once per step to forget pairs that stopped being tested.
+     */
+    class GjkCacheTable {
+    public:
+        GjkCache* find(const CollisionPrimitive* one, const CollisionPrimitive* two);
+
+        void endFrame();
+
+        void clear();
+
+        unsigned size() const {
+            return (unsigned)entries.size();
+        }
+
+    private:
+        struct PairHash {
+            size_t operator()(const std::pair<const CollisionPrimitive*, const CollisionPrimitive*>& pair) const {
+                size_t a = std::hash<const void*>()(pair.first);
+                size_t b = std::hash<const void*>()(pair.second);
+                return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+            }
+        };
+
+        struct Entry {
+            GjkCache cache;
+            unsigned lastFrame;
+        };
+
+        std::unordered_map<std::pair<const CollisionPrimitive*, const CollisionPrimitive*>, Entry, PairHash> entries;
+        unsigned frame = 0;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_CONVEX_H
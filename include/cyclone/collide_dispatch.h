@@ -0,0 +1,111 @@
+#ifndef CYCLONE_COLLISION_DISPATCH_H
+#define CYCLONE_COLLISION_DISPATCH_H
+
+#include "collide_fine.h"
+
+namespace cyclone {
+
+    /**
+     * Two primitives the broadphase thinks may be touching.
+     */
+    struct PrimitivePair {
+        const CollisionPrimitive* one;
+        const CollisionPrimitive* two;
+    };
+
+    /**
+     * Picks the narrowphase function for a pair of primitives by their types.
+     *
+     * The table holds one function per unordered pair of types. When a pair
+     * arrives in the other order the function is called with the primitives
+     * swapped and the contacts it wrote are swapped back, so the first
+     * primitive's body is always contact[0]. Pairs whose collision layers
+     * and masks do not match, and pairs where neither body is dynamic
+     * (static or kinematic against static or kinematic), are skipped
+     * before any geometry is touched.
+     *
+     * The overloads that take the step duration use the ContinuousDetector
+     * routine for a pair when one of the bodies is flagged continuous
+     * (RigidBody::setContinuous) and the table has one for its types, so
+     * fast bodies get speculative contacts instead of tunnelling.
+     */
+    class CollisionDispatcher {
+    public:
+        using PairFunction = unsigned (*)(const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data);
+        using PlaneFunction = unsigned (*)(const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data);
+        using ContinuousPairFunction = unsigned (*)(const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data);
+        using ContinuousPlaneFunction = unsigned (*)(const CollisionPrimitive& primitive, const CollisionPlane& plane, real duration, CollisionData* data);
+
+        /**
+         * Creates a dispatcher with every detector the engine has.
+         */
+        CollisionDispatcher();
+
+        /**
+         * Sets the function for the types in this order; the reverse order
+         * is handled by swapping. A null function makes the pair never collide.
+         */
+        void setFunction(PrimitiveType one, PrimitiveType two, PairFunction function);
+
+        void setPlaneFunction(PrimitiveType type, PlaneFunction function);
+
+        /**
+         * Sets the function used for the types when a body is continuous.
+         * Without one the pair falls back to the discrete function.
+         */
+        void setContinuousFunction(PrimitiveType one, PrimitiveType two, ContinuousPairFunction function);
+
+        void setContinuousPlaneFunction(PrimitiveType type, ContinuousPlaneFunction function);
+
+        /**
+         * Generates contacts for the pair. Returns the number written.
+         */
+        unsigned collide(const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) const;
+
+        /**
+         * Generates contacts against a half space. Planes are on every layer
+         * and are static, so only dynamic primitives touch them.
+         */
+        unsigned collide(const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data) const;
+
+        /**
+         * Runs the narrowphase over broadphase pairs, stopping when the
+         * contact array is full. Returns the number of contacts written.
+         */
+        unsigned collide(const PrimitivePair* pairs, unsigned count, CollisionData* data) const;
+
+        /**
+         * The same, sweeping continuous bodies over the step.
+         */
+        unsigned collide(const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data) const;
+        unsigned collide(const CollisionPrimitive& primitive, const CollisionPlane& plane, real duration, CollisionData* data) const;
+        unsigned collide(const PrimitivePair* pairs, unsigned count, real duration, CollisionData* data) const;
+
+        /**
+         * The dispatcher with the default table, shared by the engine.
+         */
+        static const CollisionDispatcher& standard();
+
+    private:
+        struct Entry {
+            PairFunction function;
+            ContinuousPairFunction continuous;
+
+            // true when function expects the primitives the other way around
+            bool swapped;
+            bool continuousSwapped;
+        };
+
+        /**
+         * Turns the contacts a detector wrote for (two, one) around.
+         */
+        static void swapContacts(CollisionData* data, unsigned first, unsigned count);
+
+        Entry table[PRIMITIVE_TYPE_COUNT][PRIMITIVE_TYPE_COUNT];
+        PlaneFunction planeTable[PRIMITIVE_TYPE_COUNT];
+        ContinuousPlaneFunction continuousPlaneTable[PRIMITIVE_TYPE_COUNT];
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_DISPATCH_H
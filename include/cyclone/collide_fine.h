@@ -2,6 +2,9 @@
 #define CYCLONE_COLLISION_FINE_H
 
 #include "contacts.h"
+#include "contact_buffer.h"
+
+#include <cstdint>
 
 namespace cyclone {
 
@@ -26,6 +29,9 @@ namespace cyclone {
         real friction;
         real restitution;
 
+        // When set, contactArray lives in this buffer and a full array grows
+        ContactBuffer<Contact>* buffer = nullptr;
+
         bool hasMoreContacts() {
             return contactsLeft > 0;
         }
@@ -36,20 +42,57 @@ namespace cyclone {
             contacts = contactArray;
         }
 
+        /**
+         * Starts a frame writing into the buffer. Close it with
+         * buffer->endFrame(contactCount) so the buffer can record its load.
+         */
+        void reset(ContactBuffer<Contact>* buffer) {
+            this->buffer = buffer;
+            contactArray = buffer->data();
+            reset(buffer->capacity());
+        }
+
         void addContacts(unsigned count) {
             contactsLeft -= count;
             contactCount += count;
             contacts += count;
+
+            // detectors check for room before writing, so grow as soon as
+            // the array is full. contactArray and contacts may move
+            if (contactsLeft <= 0 && buffer && buffer->reserve(contactCount + 1, contactCount)) {
+                contactArray = buffer->data();
+                contacts = contactArray + contactCount;
+                contactsLeft = (int)(buffer->capacity() - contactCount);
+            }
         }
     };
 
+    /**
+     * The concrete kind of a CollisionPrimitive, used to pick the
+     * narrowphase function for a pair.
+     */
+    enum PrimitiveType : unsigned char {
+        PRIMITIVE_SPHERE,
+        PRIMITIVE_BOX,
+        PRIMITIVE_CONVEX,
+        PRIMITIVE_MESH,
+        PRIMITIVE_HEIGHTFIELD,
+        PRIMITIVE_TYPE_COUNT
+    };
+
     /**
      * Represents a geometric shape attached to a rigid body.
      */
     class CollisionPrimitive {
     public:
         // The rigid body that this primitive represents.
-        RigidBody* body;
+        RigidBody* body = nullptr;
+
+        // The layers this primitive is on, one bit per layer.
+        uint32_t collisionLayer = 1;
+
+        // The layers this primitive collides with.
+        uint32_t collisionMask = 0xffffffff;
 
         // The offset of this shape from the body's center of mass.
         Matrix4 offset;
@@ -70,9 +113,27 @@ namespace cyclone {
             return transform;
         }
 
+        PrimitiveType getType() const {
+            return type;
+        }
+
+        // Both primitives must be on a layer the other one collides with
+        bool canCollideWith(const CollisionPrimitive& other) const {
+            return (collisionLayer & other.collisionMask) != 0 && (other.collisionLayer & collisionMask) != 0;
+        }
+
+        // True if contacts can move the primitive, a primitive without a body is scenery
+        bool isDynamic() const {
+            return body && body->isDynamic();
+        }
+
     protected:
+        explicit CollisionPrimitive(PrimitiveType type) : type(type) {}
+
         // Cache: The primitive's actual position/rotation in the world.
         Matrix4 transform;
+
+        PrimitiveType type;
     };
 
     /**
@@ -80,6 +141,8 @@ namespace cyclone {
      */
     class CollisionSphere : public CollisionPrimitive {
     public:
+        CollisionSphere() : CollisionPrimitive(PRIMITIVE_SPHERE) {}
+
         real radius;
     };
 
@@ -99,6 +162,8 @@ namespace cyclone {
      */
     class CollisionBox : public CollisionPrimitive {
     public:
+        CollisionBox() : CollisionPrimitive(PRIMITIVE_BOX) {}
+
         // Holds the distance from the center to the edge along local X, Y, Z.
         // E.g., A 2x2x2 cube has halfSizes of (1, 1, 1).
         Vector3 halfSize;
@@ -0,0 +1,325 @@
+#ifndef CYCLONE_COLLISION_MESH_H
+#define CYCLONE_COLLISION_MESH_H
+
+#include "collide_coarse.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace cyclone {
+
+    /**
+     * A bounding volume hierarchy for static geometry, built once.
+     *
+     * Nodes are 16 bytes: bounds quantized to 16 bits per axis against the
+     * tree's overall bounds (rounded outwards, so they never shrink) and one
+     * index. Nodes are stored depth first with one item per leaf; an inner
+     * node stores the size of its subtree, so a query that misses it skips
+     * straight past it without a stack.
+     */
+    class QuantizedTree {
+    public:
+        struct Node {
+            uint16_t min[3];
+            uint16_t max[3];
+
+            // The item index for a leaf, minus the subtree size for an inner node
+            int32_t data;
+
+            bool isLeaf() const {
+                return data >= 0;
+            }
+        };
+
+        QuantizedTree() = default;
+
+        // Nodes may point into storage, so trees move but do not copy
+        QuantizedTree(const QuantizedTree&) = delete;
+        QuantizedTree& operator=(const QuantizedTree&) = delete;
+        QuantizedTree(QuantizedTree&&) = default;
+        QuantizedTree& operator=(QuantizedTree&&) = default;
+
+        /**
+         * Builds the tree over items 0..count-1 with a median split.
+         */
+        void build(const BoundingBox* bounds, unsigned count);
+
+        /**
+         * Uses nodes held elsewhere (a mapped file) instead of building.
+         * They must outlive the tree.
+         */
+        void attach(const Node* nodes, unsigned count, const Vector3& origin, const Vector3& scale);
+
+        /**
+         * Checks nodes from outside (a file) in one pass: leaves must name an
+         * item below itemCount and inner nodes must skip forward within the
+         * nodes, so a query can neither read out of bounds nor loop.
+         */
+        static bool validate(const Node* nodes, unsigned count, unsigned itemCount);
+
+        void clear();
+
+        const Node* getNodes() const {
+            return nodes;
+        }
+
+        unsigned getNodeCount() const {
+            return nodeCount;
+        }
+
+        // The quantization frame: local = origin + quantized / scale
+        const Vector3& getOrigin() const {
+            return origin;
+        }
+
+        const Vector3& getScale() const {
+            return scale;
+        }
+
+        /**
+         * Calls visit(item) for every item whose quantized bounds overlap
+         * the box.
+         */
+        template <typename ItemVisitor>
+        void overlap(const BoundingBox& box, ItemVisitor&& visit) const;
+
+    private:
+        void quantize(const Vector3& point, uint16_t out[3], bool roundUp) const;
+
+        unsigned buildRange(const BoundingBox* bounds, std::vector<unsigned>& items,
+            const std::vector<Vector3>& centres, unsigned first, unsigned count);
+
+        std::vector<Node> storage;
+        const Node* nodes = nullptr;
+        unsigned nodeCount = 0;
+
+        Vector3 origin;
+        Vector3 scale;
+    };
+
+    template <typename ItemVisitor>
+    void QuantizedTree::overlap(const BoundingBox& box, ItemVisitor&& visit) const {
+        if (nodeCount == 0) return;
+
+        uint16_t queryMin[3], queryMax[3];
+        quantize(box.min, queryMin, false);
+        quantize(box.max, queryMax, true);
+
+        unsigned index = 0;
+        while (index < nodeCount) {
+            const Node& node = nodes[index];
+            bool hit =
+                node.min[0] <= queryMax[0] && node.max[0] >= queryMin[0] &&
+                node.min[1] <= queryMax[1] && node.max[1] >= queryMin[1] &&
+                node.min[2] <= queryMax[2] && node.max[2] >= queryMin[2];
+
+            if (node.isLeaf()) {
+                if (hit) visit((unsigned)node.data);
+                index++;
+            }
+            else {
+                index += hit ? 1 : (unsigned)-node.data;
+            }
+        }
+    }
+
+    /**
+     * A triangle mesh for static level geometry.
+     *
+     * Vertices are in the primitive's local space; body may be null, in which
+     * case offset places the mesh in the world. Triangles are wound counter
+     * clockwise seen from their solid side's outside and are one sided:
+     * shapes are only pushed out along the front.
+     */
+    class CollisionMesh : public CollisionPrimitive {
+    public:
+        CollisionMesh() : CollisionPrimitive(PRIMITIVE_MESH) {}
+
+        /**
+         * Copies the vertices and triangles (three indices each) and
+         * builds the tree.
+         */
+        void build(const Vector3* vertices, unsigned vertexCount, const unsigned* indices, unsigned triangleCount);
+
+        /**
+         * Writes the mesh and its tree in the layout load() maps.
+         */
+        bool save(const char* path) const;
+
+        /**
+         * Maps a file written by save() and uses its contents in place,
+         * without copying or rebuilding. Returns false if the file is
+         * missing or was written with a different real type.
+         */
+        bool load(const char* path);
+
+        unsigned getVertexCount() const {
+            return vertexCount;
+        }
+
+        unsigned getTriangleCount() const {
+            return triangleCount;
+        }
+
+        // The corners of a triangle in local space
+        void getTriangle(unsigned index, Vector3 corners[3]) const {
+            const unsigned* triangle = indices + 3 * index;
+            corners[0] = vertices[triangle[0]];
+            corners[1] = vertices[triangle[1]];
+            corners[2] = vertices[triangle[2]];
+        }
+
+        const QuantizedTree& getTree() const {
+            return tree;
+        }
+
+    private:
+        std::vector<Vector3> vertexStorage;
+        std::vector<unsigned> indexStorage;
+
+        // point at the storage above or into the mapped file
+        const Vector3* vertices = nullptr;
+        const unsigned* indices = nullptr;
+        unsigned vertexCount = 0;
+        unsigned triangleCount = 0;
+
+        QuantizedTree tree;
+        MappedFile file;
+    };
+
+    /**
+     * A regular grid of heights for terrain.
+     *
+     * Sample (column, row) sits at local (column * spacing, height, row * spacing)
+     * and every cell is split into two triangles facing local +y. The tree
+     * holds tiles of tileSize by tileSize cells.
+     */
+    class CollisionHeightfield : public CollisionPrimitive {
+    public:
+        static const unsigned tileSize = 4;
+
+        CollisionHeightfield() : CollisionPrimitive(PRIMITIVE_HEIGHTFIELD) {}
+
+        /**
+         * Copies columns * rows heights, stored row by row, and builds the tree.
+         */
+        void build(const real* heights, unsigned columns, unsigned rows, real spacing);
+
+        bool save(const char* path) const;
+
+        bool load(const char* path);
+
+        unsigned getColumns() const {
+            return columns;
+        }
+
+        unsigned getRows() const {
+            return rows;
+        }
+
+        real getSpacing() const {
+            return spacing;
+        }
+
+        const QuantizedTree& getTree() const {
+            return tree;
+        }
+
+        real getHeight(unsigned column, unsigned row) const {
+            return heights[row * columns + column];
+        }
+
+        /**
+         * The two triangles of a cell in local space, corners 0-2 and 3-5.
+         */
+        void getCellTriangles(unsigned column, unsigned row, Vector3 corners[6]) const;
+
+        /**
+         * Calls visit(column, row) for every cell whose bounds overlap the
+         * box (in local space).
+         */
+        template <typename CellVisitor>
+        void overlap(const BoundingBox& box, CellVisitor&& visit) const;
+
+    private:
+        BoundingBox tileBounds(unsigned tileColumn, unsigned tileRow) const;
+
+        std::vector<real> heightStorage;
+        const real* heights = nullptr;
+        unsigned columns = 0;
+        unsigned rows = 0;
+        real spacing = 1;
+
+        // tiles across the grid, items are tileRow * tileColumns + tileColumn
+        unsigned tileColumns = 0;
+
+        QuantizedTree tree;
+        MappedFile file;
+    };
+
+    template <typename CellVisitor>
+    void CollisionHeightfield::overlap(const BoundingBox& box, CellVisitor&& visit) const {
+        if (columns < 2 || rows < 2) return;
+
+        // the cells under the box, clamped to the grid
+        real inverseSpacing = 1 / spacing;
+        real lastCell[2] = { (real)(columns - 2), (real)(rows - 2) };
+        if (box.max.x < 0 || box.max.z < 0 || box.min.x * inverseSpacing > lastCell[0] + 1 ||
+            box.min.z * inverseSpacing > lastCell[1] + 1) return;
+
+        unsigned fromColumn = (unsigned)std::clamp(std::floor(box.min.x * inverseSpacing), (real)0, lastCell[0]);
+        unsigned toColumn = (unsigned)std::clamp(std::floor(box.max.x * inverseSpacing), (real)0, lastCell[0]);
+        unsigned fromRow = (unsigned)std::clamp(std::floor(box.min.z * inverseSpacing), (real)0, lastCell[1]);
+        unsigned toRow = (unsigned)std::clamp(std::floor(box.max.z * inverseSpacing), (real)0, lastCell[1]);
+
+        tree.overlap(box, [&](unsigned tile) {
+            unsigned tileColumn = (tile % tileColumns) * tileSize;
+            unsigned tileRow = (tile / tileColumns) * tileSize;
+            unsigned firstColumn = std::max(tileColumn, fromColumn), lastColumn = std::min(tileColumn + tileSize - 1, toColumn);
+            unsigned firstRow = std::max(tileRow, fromRow), lastRow = std::min(tileRow + tileSize - 1, toRow);
+
+            for (unsigned row = firstRow; row <= lastRow; row++) {
+                for (unsigned column = firstColumn; column <= lastColumn; column++) {
+                    real h00 = getHeight(column, row), h10 = getHeight(column + 1, row);
+                    real h01 = getHeight(column, row + 1), h11 = getHeight(column + 1, row + 1);
+                    real low = std::min(std::min(h00, h10), std::min(h01, h11));
+                    real high = std::max(std::max(h00, h10), std::max(h01, h11));
+                    if (low <= box.max.y && high >= box.min.y) visit(column, row);
+                }
+            }
+        });
+    }
+
+    /**
+     * Contact generation against static triangles.
+     *
+     * The shape's body is contact[0] and the mesh's body (usually null) is
+     * contact[1]; normals point from the triangle towards the shape. Each
+     * touching triangle gives at most one contact.
+     */
+    class MeshDetector {
+    public:
+        /**
+         * A sphere against one triangle given in world space.
+         */
+        static unsigned sphereAndTriangle(const CollisionSphere& sphere, const Vector3 triangle[3],
+            RigidBody* triangleBody, CollisionData* data);
+
+        /**
+         * A box against one triangle given in world space, by separating axes.
+         */
+        static unsigned boxAndTriangle(const CollisionBox& box, const Vector3 triangle[3],
+            RigidBody* triangleBody, CollisionData* data);
+
+        static unsigned sphereAndMesh(const CollisionSphere& sphere, const CollisionMesh& mesh, CollisionData* data);
+        static unsigned boxAndMesh(const CollisionBox& box, const CollisionMesh& mesh, CollisionData* data);
+
+        static unsigned sphereAndHeightfield(const CollisionSphere& sphere, const CollisionHeightfield& field, CollisionData* data);
+        static unsigned boxAndHeightfield(const CollisionBox& box, const CollisionHeightfield& field, CollisionData* data);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_MESH_H
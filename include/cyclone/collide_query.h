@@ -0,0 +1,127 @@
+#ifndef CYCLONE_COLLISION_QUERY_H
+#define CYCLONE_COLLISION_QUERY_H
+
+#include "collide_coarse.h"
+#include "parallel.h"
+
+namespace cyclone {
+
+    /**
+     * A ray (or the path of a cast shape). The direction does not
+     * need to be normalised; distances are measured along its unit length.
+     */
+    struct Ray {
+        Vector3 origin;
+        Vector3 direction;
+        real maxDistance;
+
+        Ray() : maxDistance(DBL_MAX) {}
+        Ray(const Vector3& origin, const Vector3& direction, real maxDistance = DBL_MAX)
+            : origin(origin), direction(direction), maxDistance(maxDistance) {}
+    };
+
+    /**
+     * The closest thing a ray or shape cast hit.
+     * Exactly one of primitive and plane is set on a hit, neither on a miss.
+     */
+    struct QueryHit {
+        real distance;
+        Vector3 point;
+        Vector3 normal;
+        const CollisionPrimitive* primitive;
+        const CollisionPlane* plane;
+
+        bool isHit() const {
+            return primitive != nullptr || plane != nullptr;
+        }
+    };
+
+    /**
+     * Ray, sphere cast and overlap queries against a set of collision shapes.
+     *
+     * Spheres and boxes are kept in a bounding volume tree; planes are few
+     * and tested directly. Planes are one sided: rays only hit them from the
+     * front. The tree caches the shapes' poses, so call build() after adding
+     * shapes and refit() (or build()) after they move and calculateInternals
+     * has run. Queries are const and only read the tree and the shapes, so
+     * any number of threads may query while the world is not being written.
+     */
+    class CollisionQuery {
+    public:
+        void addSphere(const CollisionSphere* sphere);
+        void addBox(const CollisionBox* box);
+        void addPlane(const CollisionPlane* plane);
+
+        /**
+         * Removes all shapes.
+         */
+        void clear();
+
+        /**
+         * Rebuilds the tree from the shapes' current poses.
+         */
+        void build();
+
+        /**
+         * Updates the tree for moved shapes, keeping its topology.
+         */
+        void refit();
+
+        /**
+         * Finds the closest shape along the ray.
+         */
+        bool raycast(const Ray& ray, QueryHit* hit) const;
+
+        /**
+         * Sweeps a sphere of the given radius along the ray and finds the
+         * first shape it touches. The hit point is on the shape's surface.
+         */
+        bool sphereCast(const Ray& ray, real radius, QueryHit* hit) const;
+
+        /**
+         * Finds the spheres and boxes that overlap the box. Writes at most
+         * maxResults of them and returns how many there were in total.
+         */
+        unsigned overlap(const BoundingBox& bounds, const CollisionPrimitive** results, unsigned maxResults) const;
+
+        /**
+         * Casts many rays at once. Rays are sorted by direction octant and
+         * origin so neighbouring rays walk the same part of the tree, and
+         * the batch is split across the pool. hits[i] answers rays[i].
+         * Returns the number of rays that hit something.
+         */
+        unsigned raycastBatch(const Ray* rays, unsigned count, QueryHit* hits,
+            ThreadPool& pool = ThreadPool::global()) const;
+
+    private:
+        enum ShapeKind : unsigned char {
+            SPHERE,
+            BOX
+        };
+
+        struct Shape {
+            const CollisionPrimitive* primitive;
+            ShapeKind kind;
+        };
+
+        bool castAgainstShapes(const Vector3& origin, const Vector3& direction, real maxDistance,
+            real radius, QueryHit* hit) const;
+
+        void updateBounds();
+
+        std::vector<Shape> shapes;
+        std::vector<const CollisionPlane*> planes;
+        std::vector<BoundingBox> bounds;
+
+        /*
+        * sphere centres and radii, structure of arrays indexed like shapes
+        * so the leaf kernel can test two spheres per instruction
+        */
+        std::vector<real> sphereX, sphereY, sphereZ, sphereRadius;
+
+        BoundingVolumeTree tree;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_QUERY_H
@@ -0,0 +1,180 @@
+#ifndef CYCLONE_CONTACT_BUFFER_H
+#define CYCLONE_CONTACT_BUFFER_H
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* what a contact buffer went through, for tuning its capacity from
+	* telemetry. counts are since the last resetStats
+	*/
+	struct ContactBufferStats {
+		// frames closed with endFrame
+		unsigned frames = 0;
+
+		// frames that filled the buffer and could not grow, contacts past
+		// the capacity were lost
+		unsigned overflows = 0;
+
+		unsigned growths = 0;
+		unsigned shrinks = 0;
+
+		// most contacts in one frame, and in the last one
+		unsigned highWater = 0;
+		unsigned lastCount = 0;
+
+		unsigned capacity = 0;
+	};
+
+	/*
+	* storage for the contacts of a frame that is reused from frame to frame
+	* a fixed buffer keeps its capacity and counts the frames that overflow
+	* it. a growable one doubles when it fills (up to an optional maximum)
+	* and shrinks back towards the high water mark after a run of quiet
+	* frames, so memory follows the actual load instead of the worst case.
+	* data() always has one spare slot past capacity(), so a generator that
+	* can not be given more room can be asked for one contact more than
+	* fits, which tells a buffer filled exactly from one that overflowed
+	*/
+	template <typename ContactType>
+	class ContactBuffer {
+	public:
+		explicit ContactBuffer(unsigned capacity = 256) : storage((capacity > 0 ? capacity : 1) + 1), minimumCapacity(capacity > 0 ? capacity : 1) {
+			stats.capacity = this->capacity();
+		}
+
+		/*
+		* maxCapacity of 0 lets the buffer grow without bound
+		*/
+		void setGrowable(bool growable, unsigned maxCapacity = 0) {
+			this->growable = growable;
+			this->maxCapacity = maxCapacity;
+		}
+
+		bool isGrowable() const {
+			return growable;
+		}
+
+		/*
+		* a growable buffer shrinks once frames frames in a row used under a
+		* quarter of it, to twice their high water mark but never below the
+		* starting capacity. 0 never shrinks
+		*/
+		void setShrinkPolicy(unsigned frames) {
+			shrinkFrames = frames;
+		}
+
+		ContactType* data() {
+			return storage.data();
+		}
+
+		unsigned capacity() const {
+			return (unsigned)storage.size() - 1;
+		}
+
+		/*
+		* true when reserve can still make the buffer bigger
+		*/
+		bool canGrow() const {
+			return growable && (maxCapacity == 0 || capacity() < maxCapacity);
+		}
+
+		/*
+		* counts the frame as overflowed, for a caller that found contacts
+		* past the capacity through the spare slot
+		*/
+		void markOverflow() {
+			overflowed = true;
+		}
+
+		/*
+		* makes room for needed contacts, keeping the first used ones
+		* returns false if there is not enough room and the buffer can not
+		* grow, which is counted as an overflow of the frame
+		*/
+		bool reserve(unsigned needed, unsigned used) {
+			if (needed <= capacity()) return true;
+
+			unsigned limit = maxCapacity > 0 ? maxCapacity : ~0u;
+			if (!growable || capacity() >= limit) {
+				overflowed = true;
+				return false;
+			}
+
+			unsigned grown = capacity();
+			while (grown < needed && grown < limit) grown = grown > limit / 2 ? limit : grown * 2;
+			resize(grown, used);
+			stats.growths++;
+			if (grown < needed) {
+				overflowed = true;
+				return false;
+			}
+			return true;
+		}
+
+		/*
+		* records a finished frame that used count contacts and applies the
+		* shrink policy. the contacts are not kept
+		*/
+		void endFrame(unsigned count) {
+			stats.frames++;
+			stats.lastCount = count;
+			if (count > stats.highWater) stats.highWater = count;
+			if (overflowed) stats.overflows++;
+			overflowed = false;
+
+			if (!growable || shrinkFrames == 0) return;
+
+			if (count * 4 >= capacity()) {
+				quietFrames = 0;
+				quietHighWater = 0;
+				return;
+			}
+
+			quietFrames++;
+			if (count > quietHighWater) quietHighWater = count;
+			if (quietFrames < shrinkFrames) return;
+
+			unsigned target = quietHighWater * 2;
+			if (target < minimumCapacity) target = minimumCapacity;
+			if (target < capacity()) {
+				resize(target, 0);
+				stats.shrinks++;
+			}
+			quietFrames = 0;
+			quietHighWater = 0;
+		}
+
+		const ContactBufferStats& getStats() const {
+			return stats;
+		}
+
+		void resetStats() {
+			stats = ContactBufferStats();
+			stats.capacity = capacity();
+		}
+
+	private:
+		void resize(unsigned newCapacity, unsigned used) {
+			std::vector<ContactType> resized(newCapacity + 1);
+			for (unsigned i = 0; i < used; i++) resized[i] = storage[i];
+			storage.swap(resized);
+			stats.capacity = capacity();
+		}
+
+		std::vector<ContactType> storage;
+		unsigned minimumCapacity;
+		unsigned maxCapacity = 0;
+		bool growable = false;
+
+		unsigned shrinkFrames = 600;
+		unsigned quietFrames = 0;
+		unsigned quietHighWater = 0;
+		bool overflowed = false;
+
+		ContactBufferStats stats;
+	};
+}
+
+#endif // !CYCLONE_CONTACT_BUFFER_H
@@ -3,6 +3,9 @@
 
 #include "body.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace cyclone {
 
 	/*
@@ -33,6 +36,11 @@ namespace cyclone {
 
 		Vector3 contactNormal;
 
+		/*
+		* depth of interpenetration along the normal
+		* a negative value marks a speculative contact: the bodies are still
+		* that far apart and may only close the gap during this step
+		*/
 		real penetration;
 
 		/*
@@ -41,6 +49,12 @@ namespace cyclone {
 		*/
 		void setBodyData(RigidBody* one, RigidBody* two, real friction, real restitution);
 
+		/*
+		* reverses the contact, swapping the bodies and flipping the normal
+		* used when the first body is scenery or a detector ran the other way round
+		*/
+		void swapBodies();
+
 	protected:
 		/*
 		* transform matrix that converts the coords int the contacts frame of 
@@ -73,6 +87,17 @@ namespace cyclone {
 		*/
 		void calculateContactBasis();
 
+		/*
+		* velocity of the contact point on the given body, in contact coordinates
+		*/
+		Vector3 calculateLocalVelocity(unsigned bodyIndex, real duration);
+
+		/*
+		* calculates the closing velocity the resolver must remove,
+		* taking restitution and speculative gaps into account
+		*/
+		void calculateDesiredDeltaVelocity(real duration);
+
 		/*
 		* calculates the data that depends on the relative position of the 
 		* contact to the bodies
@@ -99,7 +124,7 @@ namespace cyclone {
 		/*
 		* calculates impulse needed to resolve velocity in fricionless state
 		*/
-		void calculateFrictionlessImpulse(Matrix3* inverseInertiaTensor);
+		Vector3 calculateFrictionlessImpulse(Matrix3* inverseInertiaTensor);
 
 		/*
 		* calculates the impulse neede to resolve the velocity with friction
@@ -108,6 +133,8 @@ namespace cyclone {
 
 	};
 
+	class JointSet;
+
 	class ContactResolver {
 	protected:
 		/*
@@ -132,6 +159,24 @@ namespace cyclone {
 		 */
 		unsigned positionIterationsUsed;
 
+		/**
+		 * Velocities smaller than this are treated as zero, avoiding
+		 * jitter on resting contacts.
+		 */
+		real velocityEpsilon;
+
+		/**
+		 * Penetrations smaller than this are considered resolved.
+		 */
+		real positionEpsilon;
+
+		JointSet* joints = nullptr;
+
+		// scratch of sortContacts: the keys, the sorted order and a copy of the contacts
+		std::vector<uint64_t> sortKeys;
+		std::vector<unsigned> sortOrder;
+		std::vector<Contact> sortScratch;
+
 	public:
 		/**
 		 * Creates a new contact resolver.
@@ -149,11 +194,29 @@ namespace cyclone {
 		 */
 		void setIterations(unsigned velocityIterations, unsigned positionIterations);
 
+		/*
+		* joints solved in the velocity pass together with the contacts
+		* every joint sweep is followed by a share of the velocity
+		* iterations, so contacts and joints settle against each other.
+		* null resolves contacts only
+		*/
+		void setJoints(JointSet* joints);
+
 		/**
 		 * Resolves a set of contacts for both penetration and velocity.
 		 */
 		void resolveContacts(Contact* contactArray, unsigned numContacts, real duration);
 
+		/*
+		* orders contacts by the positions of their bodies, then by their own
+		* point, normal and depth. the order then only depends on the state of
+		* the simulation, not on the order the detectors ran in or where the
+		* bodies live in memory. resolution works through the array in order,
+		* so lockstep peers sort before resolving. the scratch memory is kept
+		* by the resolver, so sorting does not allocate once it has grown
+		*/
+		void sortContacts(Contact* contactArray, unsigned numContacts);
+
 	protected:
 		/**
 		 * Sets up contacts ready for processing. This ensures that
@@ -172,6 +235,12 @@ namespace cyclone {
 		 */
 		void adjustPositions(Contact* contacts, unsigned numContacts, real duration);
 
+		/*
+		* recalculates the closing velocities after joints changed the
+		* velocities of the bodies
+		*/
+		void updateContactVelocities(Contact* contacts, unsigned numContacts, real duration);
+
 	};
 }
 
@@ -64,6 +64,18 @@ namespace cyclone {
 			z -= other.z;
 		}
 
+		//adds the given vector scaled by the given amount
+		void addScaledVector(const Vector3& vector, real scale) {
+			x += vector.x * scale;
+			y += vector.y * scale;
+			z += vector.z * scale;
+		}
+
+		//component-wise product, used for scaling by per-axis sizes
+		[[nodiscard]] Vector3 componentProduct(const Vector3& other) const {
+			return Vector3(x * other.x, y * other.y, z * other.z);
+		}
+
 		//newtons third law useful for equal or opposite forces
 		void invert() {
 			x = -x;
@@ -165,6 +177,56 @@ namespace cyclone {
             );
         }
 
+        // Transform a vector by the transpose of this matrix
+        Vector3 transformTranspose(const Vector3& vector) const {
+            return Vector3(
+                vector.x * data[0] + vector.y * data[3] + vector.z * data[6],
+                vector.x * data[1] + vector.y * data[4] + vector.z * data[7],
+                vector.x * data[2] + vector.y * data[5] + vector.z * data[8]
+            );
+        }
+
+        // Sets the matrix from three column vectors
+        void setComponents(const Vector3& one, const Vector3& two, const Vector3& three) {
+            data[0] = one.x; data[1] = two.x; data[2] = three.x;
+            data[3] = one.y; data[4] = two.y; data[5] = three.y;
+            data[6] = one.z; data[7] = two.z; data[8] = three.z;
+        }
+
+        // Sets the matrix to the skew symmetric form of the vector,
+        // so that (M * v) equals (vector ^ v)
+        void setSkewSymmetric(const Vector3& vector) {
+            data[0] = data[4] = data[8] = 0;
+            data[1] = -vector.z;
+            data[2] = vector.y;
+            data[3] = vector.z;
+            data[5] = -vector.x;
+            data[6] = -vector.y;
+            data[7] = vector.x;
+        }
+
+        Matrix3 transpose() const {
+            return Matrix3(
+                data[0], data[3], data[6],
+                data[1], data[4], data[7],
+                data[2], data[5], data[8]
+            );
+        }
+
+        Matrix3 inverse() const {
+            Matrix3 result = *this;
+            result.invert();
+            return result;
+        }
+
+        void operator*=(const real scalar) {
+            for (real& d : data) d *= scalar;
+        }
+
+        void operator+=(const Matrix3& o) {
+            for (unsigned i = 0; i < 9; i++) data[i] += o.data[i];
+        }
+
         // Multiply matrix by matrix
         Matrix3 operator*(const Matrix3& o) const {
             return Matrix3(
@@ -200,21 +262,25 @@ namespace cyclone {
         }
 
         void invert() {
-            real t4 = data[0] * data[4]; real t6 = data[0] * data[5]; real t8 = data[1] * data[3];
-            real t10 = data[2] * data[3]; real t12 = data[1] * data[6]; real t14 = data[2] * data[6];
+            // work from a copy, the cofactors below read entries that are overwritten
+            const Matrix3 source = *this;
+            const real* m = source.data;
+
+            real t4 = m[0] * m[4]; real t6 = m[0] * m[5]; real t8 = m[1] * m[3];
+            real t10 = m[2] * m[3]; real t12 = m[1] * m[6]; real t14 = m[2] * m[6];
             // Calculate the determinant
-            real t16 = (t4 * data[8] - t6 * data[7] - t8 * data[8] + t10 * data[7] + t12 * data[5] - t14 * data[4]);
+            real t16 = (t4 * m[8] - t6 * m[7] - t8 * m[8] + t10 * m[7] + t12 * m[5] - t14 * m[4]);
             if (t16 == (real)0.0f) return; 
             real t17 = 1 / t16;
 
-            data[0] = (data[4] * data[8] - data[5] * data[7]) * t17;
-            data[1] = -(data[1] * data[8] - data[2] * data[7]) * t17;
-            data[2] = (data[1] * data[5] - data[2] * data[4]) * t17;
-            data[3] = -(data[3] * data[8] - data[5] * data[6]) * t17;
-            data[4] = (data[0] * data[8] - t14) * t17;
-            data[5] = -(data[0] * data[5] - t10) * t17;
-            data[6] = (data[3] * data[7] - data[4] * data[6]) * t17;
-            data[7] = -(data[0] * data[7] - t12) * t17;
+            data[0] = (m[4] * m[8] - m[5] * m[7]) * t17;
+            data[1] = -(m[1] * m[8] - m[2] * m[7]) * t17;
+            data[2] = (m[1] * m[5] - m[2] * m[4]) * t17;
+            data[3] = -(m[3] * m[8] - m[5] * m[6]) * t17;
+            data[4] = (m[0] * m[8] - t14) * t17;
+            data[5] = -(t6 - t10) * t17;
+            data[6] = (m[3] * m[7] - m[4] * m[6]) * t17;
+            data[7] = -(m[0] * m[7] - t12) * t17;
             data[8] = (t4 - t8) * t17;
         }
 
@@ -277,6 +343,29 @@ namespace cyclone {
                 vector.x * data[8] + vector.y * data[9] + vector.z * data[10] + data[11]
             );
         }
+
+        // transform a direction by the inverse rotation (world -> local)
+        Vector3 transformInverseDirection(const Vector3& vector) const {
+            return Vector3(
+                vector.x * data[0] + vector.y * data[4] + vector.z * data[8],
+                vector.x * data[1] + vector.y * data[5] + vector.z * data[9],
+                vector.x * data[2] + vector.y * data[6] + vector.z * data[10]
+            );
+        }
+
+        // transform a position by the inverse transform (world -> local),
+        // assumes the matrix is a pure rotation plus translation
+        Vector3 transformInverse(const Vector3& vector) const {
+            return transformInverseDirection(Vector3(
+                vector.x - data[3],
+                vector.y - data[7],
+                vector.z - data[11]
+            ));
+        }
+
+        Vector3 getAxisVector(unsigned index) const {
+            return Vector3(data[index], data[index + 4], data[index + 8]);
+        }
     };
 
 }
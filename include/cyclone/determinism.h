@@ -0,0 +1,55 @@
+#ifndef CYCLONE_DETERMINISM_H
+#define CYCLONE_DETERMINISM_H
+
+#include "core.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace cyclone {
+
+	/*
+	* a 64 bit FNV-1a hash over the exact bit patterns of simulation state
+	* two runs that hash the same after a step are bit identical (up to
+	* collisions), so peers in lockstep can compare one number per frame
+	* to detect a desync
+	*/
+	class StateHash {
+	public:
+		void add(uint64_t bits) {
+			for (unsigned i = 0; i < 8; i++) {
+				value ^= (bits >> (i * 8)) & 0xff;
+				value *= 1099511628211ull;
+			}
+		}
+
+		void add(real number) {
+			uint64_t bits;
+			static_assert(sizeof(bits) == sizeof(number), "real must be 64 bit");
+			std::memcpy(&bits, &number, sizeof(bits));
+			add(bits);
+		}
+
+		void add(const Vector3& vector) {
+			add(vector.x);
+			add(vector.y);
+			add(vector.z);
+		}
+
+		void add(const Quaternion& quaternion) {
+			add(quaternion.r);
+			add(quaternion.i);
+			add(quaternion.j);
+			add(quaternion.k);
+		}
+
+		uint64_t get() const {
+			return value;
+		}
+
+	private:
+		uint64_t value = 14695981039346656037ull;
+	};
+}
+
+#endif // !CYCLONE_DETERMINISM_H
@@ -0,0 +1,256 @@
+#ifndef CYCLONE_FGEN_H
+#define CYCLONE_FGEN_H
+
+#include "body.h"
+#include "parallel.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* a generator can be asked to add a force to one or more rigid bodies
+	*/
+	class ForceGenerator {
+	public:
+		virtual ~ForceGenerator() = default;
+
+		virtual void updateForce(RigidBody* body, real duration) = 0;
+	};
+
+	/*
+	* the built in generators work out the force and the torque about the
+	* centre of mass without touching the body, so the registry can run them
+	* in batches on many threads. updateForce adds the same to the body
+	*/
+
+	/*
+	* a force that accelerates every body with a finite mass equally
+	*/
+	class Gravity : public ForceGenerator {
+	public:
+		Vector3 gravity;
+
+		Gravity(const Vector3& gravity) : gravity(gravity) {}
+
+		void compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const;
+
+		virtual void updateForce(RigidBody* body, real duration);
+	};
+
+	/*
+	* drag through the centre of mass, k1 for the velocity and k2 for the
+	* velocity squared, like ParticleDrag
+	*/
+	class Drag : public ForceGenerator {
+	public:
+		real k1;
+		real k2;
+
+		Drag(real k1, real k2) : k1(k1), k2(k2) {}
+
+		void compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const;
+
+		virtual void updateForce(RigidBody* body, real duration);
+	};
+
+	/*
+	* a spring from a point on the body to a point on another body
+	* only pulls on the body it is registered for, register a second spring
+	* the other way round to pull on both
+	*/
+	class Spring : public ForceGenerator {
+	public:
+		// the connection point on the body, in body space
+		Vector3 connectionPoint;
+
+		RigidBody* other;
+
+		// the connection point on the other body, in its space
+		Vector3 otherConnectionPoint;
+
+		real springConstant;
+		real restLength;
+
+		Spring(const Vector3& localConnectionPoint, RigidBody* other, const Vector3& otherConnectionPoint,
+			real springConstant, real restLength) :
+			connectionPoint(localConnectionPoint), other(other), otherConnectionPoint(otherConnectionPoint),
+			springConstant(springConstant), restLength(restLength) {
+		}
+
+		void compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const;
+
+		virtual void updateForce(RigidBody* body, real duration);
+	};
+
+	/*
+	* lift from a liquid with a flat surface at waterHeight along y
+	* the force grows from nothing when the centre of buoyancy is maxDepth
+	* above the surface to the full weight of the displaced liquid when it
+	* is maxDepth below, and acts at the centre of buoyancy so floating
+	* bodies right themselves
+	*/
+	class Buoyancy : public ForceGenerator {
+	public:
+		// in body space
+		Vector3 centreOfBuoyancy;
+
+		real maxDepth;
+		real volume;
+		real waterHeight;
+		real liquidDensity;
+		real gravity;
+
+		Buoyancy(const Vector3& centreOfBuoyancy, real maxDepth, real volume, real waterHeight,
+			real liquidDensity = 1000.0, real gravity = 9.81) :
+			centreOfBuoyancy(centreOfBuoyancy), maxDepth(maxDepth), volume(volume), waterHeight(waterHeight),
+			liquidDensity(liquidDensity), gravity(gravity) {
+		}
+
+		void compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const;
+
+		virtual void updateForce(RigidBody* body, real duration);
+	};
+
+	/*
+	* an aerodynamic surface (wing, fin, sail) at a point of the body
+	* the tensor turns the air velocity in body space into a force in body
+	* space. the air velocity is the body's velocity against the wind, a null
+	* wind is still air
+	*/
+	class Aero : public ForceGenerator {
+	public:
+		Matrix3 tensor;
+
+		// in body space
+		Vector3 position;
+
+		const Vector3* windspeed;
+
+		Aero(const Matrix3& tensor, const Vector3& position, const Vector3* windspeed = nullptr) :
+			tensor(tensor), position(position), windspeed(windspeed) {
+		}
+
+		void compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const;
+
+		virtual void updateForce(RigidBody* body, real duration);
+	};
+
+	/*
+	* an aerodynamic surface that can be moved (aileron, rudder, flap)
+	* the tensor is blended between the ones for the control at -1, 0 and 1
+	*/
+	class AeroControl : public Aero {
+	public:
+		Matrix3 minTensor;
+		Matrix3 maxTensor;
+		Matrix3 baseTensor;
+
+		AeroControl(const Matrix3& base, const Matrix3& min, const Matrix3& max,
+			const Vector3& position, const Vector3* windspeed = nullptr) :
+			Aero(base, position, windspeed), minTensor(min), maxTensor(max), baseTensor(base) {
+		}
+
+		/*
+		* sets the control between -1 and 1 and updates the tensor
+		*/
+		void setControl(real value);
+
+		real getControl() const {
+			return control;
+		}
+
+	private:
+		real control = 0;
+	};
+
+	/*
+	* holds the rigid bodies and the generators that act on them
+	* registrations of the built in generators are kept in one list per type
+	* and each list is run by a plain loop, so the generators are not called
+	* through a virtual function. the loops are split across the pool, each
+	* registration writing its force and torque to its own slot, and every
+	* body then adds up its slots in registration order. the sum does not
+	* depend on the number of threads, so a step is the same on any machine.
+	* other generators are called one by one on the caller afterwards
+	*/
+	class ForceRegistry {
+	public:
+		void add(RigidBody* body, ForceGenerator* fg);
+		void add(RigidBody* body, Gravity* fg);
+		void add(RigidBody* body, Drag* fg);
+		void add(RigidBody* body, Spring* fg);
+		void add(RigidBody* body, Buoyancy* fg);
+		void add(RigidBody* body, Aero* fg);
+
+		/*
+		* removes the pair from the registry, whichever list it is in
+		*/
+		void remove(RigidBody* body, ForceGenerator* fg);
+
+		/*
+		* removes every registration of the body
+		*/
+		void remove(RigidBody* body);
+
+		void clear();
+
+		unsigned size() const;
+
+		/*
+		* pool for the batches
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		/*
+		* calls all the force generators to update their bodies
+		*/
+		void updateForces(real duration);
+
+	private:
+		template <typename Generator>
+		struct Registration {
+			RigidBody* body;
+			Generator* fg;
+		};
+
+		template <typename Generator>
+		using Registry = std::vector<Registration<Generator>>;
+
+		/*
+		* slots of the batched registrations, in list order, and the slots
+		* of each body. rebuilt when registrations change
+		*/
+		void prepare();
+
+		template <typename Generator>
+		void computeBatch(const Registry<Generator>& registry, unsigned first, real duration);
+
+		template <typename Generator>
+		static void removeFrom(Registry<Generator>& registry, RigidBody* body, ForceGenerator* fg);
+
+		Registry<Gravity> gravity;
+		Registry<Drag> drag;
+		Registry<Spring> springs;
+		Registry<Buoyancy> buoyancy;
+		Registry<Aero> aero;
+		Registry<ForceGenerator> others;
+
+		// force and torque of each batched registration
+		std::vector<Vector3> forces;
+		std::vector<Vector3> torques;
+
+		// every body with a batched registration and its slots, as ranges
+		std::vector<RigidBody*> bodies;
+		std::vector<unsigned> bodyStart;
+		std::vector<unsigned> bodySlots;
+
+		// the body of each slot
+		std::vector<unsigned> slotBody;
+
+		ThreadPool* pool = nullptr;
+		bool prepared = false;
+	};
+}
+
+#endif // !CYCLONE_FGEN_H
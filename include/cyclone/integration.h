@@ -0,0 +1,156 @@
+#ifndef CYCLONE_INTEGRATION_H
+#define CYCLONE_INTEGRATION_H
+
+#include "core.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* per step state shared by everything a world integrates
+	* damping is applied as damping^duration, and objects mostly share a few
+	* damping values and a fixed step, so the factors are computed once per
+	* distinct damping value and reused instead of calling std::pow per object
+	*/
+	class IntegrationContext {
+	public:
+		enum DampingMode : unsigned char {
+			/*
+			* std::pow once per damping value per step length,
+			* the cache is dropped when the step length changes
+			*/
+			DAMPING_EXACT,
+
+			/*
+			* caches log(damping), which does not depend on the step length,
+			* and raises it with a cheap polynomial exp (relative error below 1e-6)
+			* suits variable steps
+			*/
+			DAMPING_APPROXIMATE
+		};
+
+		/*
+		* how positions and velocities are advanced. forces are evaluated once,
+		* before the step, so every scheme reads the accelaration at the start
+		*/
+		enum IntegrationScheme : unsigned char {
+			/*
+			* each object's own scheme: explicit Euler for particles,
+			* semi-implicit Euler for rigid bodies
+			*/
+			INTEGRATE_DEFAULT,
+
+			// position with the old velocity, then velocity
+			INTEGRATE_EXPLICIT_EULER,
+
+			// velocity first, then position with the new velocity (symplectic)
+			INTEGRATE_SEMI_IMPLICIT_EULER,
+
+			/*
+			* stormer-verlet, x' = x + (x - x_prev) * dt / dt_prev + a * dt * (dt + dt_prev) / 2
+			* carried as velocity (x' - x) / dt so resolver impulses carry over.
+			* matches semi-implicit Euler for a fixed step, stays second order
+			* when the step length changes and on the first step
+			*/
+			INTEGRATE_POSITION_VERLET,
+
+			/*
+			* kick, drift, kick. the closing half kick needs the next step's
+			* accelaration, so each step first corrects the previous step's
+			* velocity by half the change in accelaration
+			*/
+			INTEGRATE_VELOCITY_VERLET
+		};
+
+		/*
+		* how orientations follow the angular velocity
+		*/
+		enum RotationScheme : unsigned char {
+			// q += 0.5 * (0, w * dt) * q then normalise, first order
+			ROTATE_LINEAR,
+
+			// q = (cos(|w| dt / 2), sin(|w| dt / 2) w / |w|) * q, exact for constant w
+			ROTATE_EXACT
+		};
+
+		explicit IntegrationContext(DampingMode mode = DAMPING_EXACT);
+
+		void setScheme(IntegrationScheme scheme) {
+			this->scheme = scheme;
+		}
+
+		IntegrationScheme getScheme() const {
+			return scheme;
+		}
+
+		void setRotationScheme(RotationScheme rotationScheme) {
+			this->rotationScheme = rotationScheme;
+		}
+
+		RotationScheme getRotationScheme() const {
+			return rotationScheme;
+		}
+
+		void setMode(DampingMode mode);
+		DampingMode getMode() const;
+
+		/*
+		* starts a step of the given length, call before integrating
+		*/
+		void beginStep(real duration);
+
+		real getDuration() const {
+			return duration;
+		}
+
+		// the length of the step before this one, 0 before the first
+		real getPreviousDuration() const {
+			return previousDuration;
+		}
+
+		/*
+		* damping^duration for the current step
+		*/
+		real dampingFactor(real damping);
+
+		/*
+		* forgets every cached value
+		*/
+		void clear();
+
+		/*
+		* advances an orientation by the angular velocity over the step
+		* with the context's rotation scheme
+		*/
+		void rotate(Quaternion* orientation, const Vector3& rotation) const;
+
+		/*
+		* e^x by range reduction and a short polynomial
+		*/
+		static real approximateExp(real x);
+
+	private:
+		struct Entry {
+			real damping;
+
+			// damping^duration when exact, log(damping) when approximate
+			real value;
+		};
+
+		// beyond this many damping values factors are computed uncached
+		static const unsigned maxEntries = 32;
+
+		real lookup(real damping);
+
+		std::vector<Entry> entries;
+		unsigned lastHit = 0;
+		real duration = 0;
+		real previousDuration = 0;
+		DampingMode mode;
+		IntegrationScheme scheme = INTEGRATE_DEFAULT;
+		RotationScheme rotationScheme = ROTATE_LINEAR;
+	};
+}
+
+#endif // CYCLONE_INTEGRATION_H
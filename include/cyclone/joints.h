@@ -0,0 +1,192 @@
+#ifndef CYCLONE_JOINTS_H
+#define CYCLONE_JOINTS_H
+
+#include "body.h"
+#include "determinism.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* joints between rigid bodies (ragdolls, vehicles, machinery)
+	* solved with sequential impulses at the velocity level, with a
+	* baumgarte bias pulling the bodies back together when they drift. the
+	* impulses of a step are kept and applied again at the start of the next
+	* (warm starting), so a chain of joints holds together in a few sweeps.
+	* each joint type is kept in its own contiguous array and every sweep
+	* goes through them type by type, so the loops are branch free and only
+	* touch the data of that type. the mass terms are worked out once per
+	* step in prepare. a null body is the world, anchored where the joint
+	* was created. static and kinematic bodies are not moved by joints.
+	* joints are solved by the ContactResolver they are given to, in the
+	* same velocity pass as the contacts
+	*/
+	class JointSet {
+	public:
+		enum JointType : unsigned char {
+			// keeps two points together, the bodies turn freely
+			JOINT_BALL,
+
+			// a ball joint that only turns about one axis
+			JOINT_HINGE,
+
+			// the bodies keep their relative orientation and only slide along an axis
+			JOINT_SLIDER,
+
+			// the bodies move as one
+			JOINT_FIXED,
+
+			JOINT_TYPE_COUNT
+		};
+
+		explicit JointSet(unsigned iterations = 8);
+
+		/*
+		* anchors and axes are given in world space for the bodies' current
+		* pose. the add functions return the index of the joint in its type
+		*/
+		unsigned addBall(RigidBody* one, RigidBody* two, const Vector3& anchor);
+		unsigned addHinge(RigidBody* one, RigidBody* two, const Vector3& anchor, const Vector3& axis);
+		unsigned addSlider(RigidBody* one, RigidBody* two, const Vector3& anchor, const Vector3& axis);
+		unsigned addFixed(RigidBody* one, RigidBody* two, const Vector3& anchor);
+
+		unsigned size(JointType type) const;
+		unsigned size() const;
+
+		void clear();
+
+		/*
+		* sweeps over every joint per step. the contact resolver splits its
+		* velocity iterations between them
+		*/
+		void setIterations(unsigned iterations);
+		unsigned getIterations() const;
+
+		/*
+		* fraction of the drift removed per step, 0 leaves drift alone
+		*/
+		void setBias(real bias);
+
+		/*
+		* fraction of last step's impulses applied at the start of a step,
+		* 0 turns warm starting off
+		*/
+		void setWarmStarting(real factor);
+
+		/*
+		* works out the anchors, mass terms and bias of every joint from the
+		* bodies' current pose, and applies the warm start impulses
+		*/
+		void prepare(real duration);
+
+		/*
+		* one sweep of impulses over every joint
+		*/
+		void solveVelocities();
+
+		/*
+		* adds the impulses kept for warm starting to the hash
+		*/
+		void hashState(StateHash* hash) const;
+
+	private:
+		/*
+		* the mass terms a joint needs from one of its bodies for a step
+		*/
+		struct BodyTerms {
+			real inverseMass;
+			Matrix3 inverseInertia;
+		};
+
+		// keeps an anchor point of each body together, 3 rows
+		struct PointPart {
+			Vector3 localAnchor[2];
+			Vector3 relativeAnchor[2];
+			Matrix3 mass;
+			Vector3 bias;
+			Vector3 impulse;
+		};
+
+		// keeps the relative orientation of the bodies, 3 rows
+		struct LockPart {
+			Quaternion relativeOrientation;
+			Matrix3 mass;
+			Vector3 bias;
+			Vector3 impulse;
+		};
+
+		// stops turning about the two axes across the hinge axis, 2 rows
+		struct HingePart {
+			Vector3 localAxis[2];
+			Vector3 across[2];
+			real mass[4];
+			real bias[2];
+			real impulse[2];
+		};
+
+		// stops sliding across the slider axis, 2 rows
+		struct SlidePart {
+			Vector3 localAnchor[2];
+			Vector3 localAxis;
+			Vector3 arm[2];
+			Vector3 across[2];
+			real mass[2];
+			real bias[2];
+			real impulse[2];
+		};
+
+		struct BallJoint {
+			RigidBody* body[2];
+			BodyTerms terms[2];
+			PointPart point;
+		};
+
+		struct HingeJoint {
+			RigidBody* body[2];
+			BodyTerms terms[2];
+			PointPart point;
+			HingePart hinge;
+		};
+
+		struct SliderJoint {
+			RigidBody* body[2];
+			BodyTerms terms[2];
+			LockPart lock;
+			SlidePart slide;
+		};
+
+		struct FixedJoint {
+			RigidBody* body[2];
+			BodyTerms terms[2];
+			PointPart point;
+			LockPart lock;
+		};
+
+		static void prepareBodies(RigidBody* const body[2], BodyTerms terms[2]);
+
+		void initPoint(PointPart& point, RigidBody* const body[2], const Vector3& anchor) const;
+		void initLock(LockPart& lock, RigidBody* const body[2]) const;
+
+		void preparePoint(PointPart& point, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const;
+		void prepareLock(LockPart& lock, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const;
+		void prepareHinge(HingePart& hinge, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const;
+		void prepareSlide(SlidePart& slide, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const;
+
+		static void solvePoint(PointPart& point, RigidBody* const body[2], const BodyTerms terms[2]);
+		static void solveLock(LockPart& lock, RigidBody* const body[2], const BodyTerms terms[2]);
+		static void solveHinge(HingePart& hinge, RigidBody* const body[2], const BodyTerms terms[2]);
+		static void solveSlide(SlidePart& slide, RigidBody* const body[2], const BodyTerms terms[2]);
+
+		std::vector<BallJoint> balls;
+		std::vector<HingeJoint> hinges;
+		std::vector<SliderJoint> sliders;
+		std::vector<FixedJoint> fixed;
+
+		unsigned iterations;
+		real bias = (real)0.2;
+		real warmStarting = 1;
+	};
+}
+
+#endif // !CYCLONE_JOINTS_H
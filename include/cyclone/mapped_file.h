@@ -0,0 +1,56 @@
+#ifndef CYCLONE_MAPPED_FILE_H
+#define CYCLONE_MAPPED_FILE_H
+
+#include <cstddef>
+
+namespace cyclone {
+
+	/*
+	* a read only view of a whole file mapped into memory
+	* pages are loaded by the os on first touch, so opening a large file is cheap
+	*/
+	class MappedFile {
+	public:
+		MappedFile() = default;
+
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		/*
+		* maps the file, closing any file mapped before
+		* returns false if the file can not be opened or is empty
+		*/
+		bool open(const char* path);
+
+		void close();
+
+		bool isOpen() const {
+			return bytes != nullptr;
+		}
+
+		const unsigned char* data() const {
+			return bytes;
+		}
+
+		size_t size() const {
+			return length;
+		}
+
+	private:
+		const unsigned char* bytes = nullptr;
+		size_t length = 0;
+
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#endif
+	};
+
+} // namespace cyclone
+
+#endif // CYCLONE_MAPPED_FILE_H
@@ -0,0 +1,195 @@
+#ifndef CYCLONE_PARALLEL_H
+#define CYCLONE_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* a fixed set of worker threads that run parallel loops
+	* the calling thread always takes part in its own loop, so a loop can be
+	* started from inside another loop without deadlocking the pool
+	*/
+	class ThreadPool {
+	public:
+		/*
+		* body of a parallel loop, called with a [begin, end) chunk of indices
+		*/
+		using RangeFunction = std::function<void(unsigned begin, unsigned end)>;
+
+		/*
+		* workers: number of extra threads, 0 picks hardware concurrency - 1
+		*/
+		explicit ThreadPool(unsigned workers = 0);
+
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/*
+		* number of threads that take part in a loop (workers + caller)
+		*/
+		unsigned getThreadCount() const;
+
+		/*
+		* splits [0, count) into chunks of grain indices and runs them on the pool
+		* returns once every chunk has finished. chunk boundaries only depend on
+		* count and grain, never on the number of threads
+		*/
+		void parallelFor(unsigned count, unsigned grain, const RangeFunction& body);
+
+		/*
+		* reduces [0, count): map(begin, end) returns the partial result of a
+		* chunk and the partials are combined in chunk order on the caller.
+		* chunks only depend on count and grain, so the result (including its
+		* floating point rounding) is the same for any number of threads
+		*/
+		template <typename T, typename Map, typename Combine>
+		T parallelReduce(unsigned count, unsigned grain, const T& initial, const Map& map, const Combine& combine) {
+			if (grain == 0) grain = 1;
+
+			std::vector<T> partials((count + grain - 1) / grain, initial);
+			parallelFor(count, grain, [&](unsigned begin, unsigned end) {
+				partials[begin / grain] = map(begin, end);
+			});
+
+			T result = initial;
+			for (const T& partial : partials) result = combine(result, partial);
+			return result;
+		}
+
+		/*
+		* runs chunks of a loop that is waiting for help, if there is one
+		* lets a thread that is waiting on something else make itself useful
+		* returns false if there was nothing to run
+		*/
+		bool runPending();
+
+		/*
+		* lets a thread with nothing to do sleep until there may be work.
+		* read the epoch, look for work, and if there is none wait with the
+		* epoch read. it changes whenever a loop or task is queued and on
+		* notifyWork, so nothing queued after the read is missed
+		*/
+		unsigned getWorkEpoch() const;
+		void waitForWork(unsigned epoch);
+
+		/*
+		* wakes the threads in waitForWork, for work the pool does not know
+		* about (e.g. a task graph making a task ready)
+		*/
+		void notifyWork();
+
+		/*
+		* the pool shared by the engine
+		*/
+		static ThreadPool& global();
+
+	private:
+		struct Job {
+			const RangeFunction* body;
+			unsigned count;
+			unsigned grain;
+			unsigned chunks;
+			std::atomic<unsigned> nextChunk;
+			std::atomic<unsigned> finishedChunks;
+			std::atomic<unsigned> users;
+		};
+
+	public:
+		/*
+		* work started with start that runs on a worker while the caller
+		* carries on. it may start parallel loops of its own. the task must
+		* outlive the work, wait before starting it again or destroying it
+		*/
+		class AsyncTask {
+		public:
+			AsyncTask() = default;
+			AsyncTask(const AsyncTask&) = delete;
+			AsyncTask& operator=(const AsyncTask&) = delete;
+
+			~AsyncTask() {
+				wait();
+			}
+
+			bool isRunning() const {
+				return pool != nullptr;
+			}
+
+			/*
+			* blocks until the work is done, running it on the caller if no
+			* worker has picked it up yet
+			*/
+			void wait();
+
+		private:
+			friend class ThreadPool;
+
+			std::function<void()> work;
+			RangeFunction body;
+			Job job;
+			ThreadPool* pool = nullptr;
+		};
+
+		/*
+		* queues work on the pool and returns straight away, with no workers
+		* it runs on the caller before returning
+		*/
+		void start(AsyncTask& task, std::function<void()> work);
+
+	private:
+		/*
+		* takes a finished job off the list and waits for workers to let go
+		*/
+		void retire(Job* job);
+
+		/*
+		* claims and runs chunks of the job until none are left
+		*/
+		static void runChunks(Job* job);
+
+		/*
+		* drops a thread's use of a job, waking retire after the last one
+		*/
+		void release(Job* job);
+
+		/*
+		* returns once every chunk of the job has finished, spinning for a
+		* short while and then sleeping until the last chunk wakes it
+		*/
+		static void waitForChunks(Job* job);
+
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+
+		/*
+		* jobs that still have unclaimed chunks, guarded by mutex
+		*/
+		std::vector<Job*> jobs;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping;
+
+		// signalled when the last user lets go of a job, for retire
+		std::condition_variable released;
+
+		std::atomic<unsigned> workEpoch{ 0 };
+	};
+
+	/*
+	* runs a loop on the pool, or on the caller in one chunk when the pool
+	* is null. the classes with a setThreadPool run their passes through it,
+	* so a null pool keeps them single threaded
+	*/
+	void parallelFor(ThreadPool* pool, unsigned count, unsigned grain, const ThreadPool::RangeFunction& body);
+}
+
+#endif // !CYCLONE_PARALLEL_H
@@ -2,6 +2,7 @@
 #define CYCLONE_PARTICLE_H
 
 #include "core.h"
+#include "integration.h"
 
 #include <cfloat>
 
@@ -20,6 +21,12 @@ namespace cyclone {
 		*/
 		Vector3 forceAccum;
 
+		/*
+		* the total accelaration of the last step, velocity verlet uses it to
+		* finish the previous step's velocity once the new forces are known
+		*/
+		Vector3 lastFrameAccelaration;
+
 		/*
 		* Holds the amount of damping applied to linear motion
 		* required to remove energy added through numerical instability
@@ -36,7 +43,7 @@ namespace cyclone {
 		real inverseMass;
 
 		//default constructor
-		Particle() : position(), velocity(), accelaration(), forceAccum(), damping(0.995), inverseMass(1.0) {}
+		Particle() : position(), velocity(), accelaration(), forceAccum(), lastFrameAccelaration(), damping(0.995), inverseMass(1.0) {}
 
 		//constructor with parameters
 		// use setter to set the mass to ensure inverse mass is calculated correctly
@@ -59,6 +66,18 @@ namespace cyclone {
 		//integrate the particle forward in time by the given duration
 		void integrate(real duration);
 
+		//integrate over the context's step with its scheme, reusing its cached damping factor
+		void integrate(IntegrationContext& context);
+
+		/*
+		* integrates many particles over the context's step
+		* picks the scheme once for the whole batch instead of per particle
+		* previousDurations, when given, holds each particle's own previous
+		* step length for the verlet schemes instead of the context's
+		*/
+		static void integrateAll(Particle* const* particles, unsigned count, IntegrationContext& context,
+			const real* previousDurations = nullptr);
+
 		//setter for mass that also calculates the inverse mass
 		void setmass(real mass) {
 			if (mass > 0.0) {
@@ -72,6 +91,10 @@ namespace cyclone {
 		[[nodiscard]] real getmass() const {
 			return inverseMass == 0.0 ? DBL_MAX : 1.0 / inverseMass;
 		}
+
+	private:
+		//the step itself, with damping^duration already worked out
+		void integrateDamped(real duration, real dampingFactor);
 	};
 }
 
@@ -0,0 +1,170 @@
+#ifndef CYCLONE_PCONSTRAINTS_H
+#define CYCLONE_PCONSTRAINTS_H
+
+#include "particle.h"
+#include "parallel.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* extended position based dynamics (XPBD) for particle constraints
+	* runs after integration: positions are moved straight onto the constraints
+	* and velocities pick up the same correction divided by the step, so stiff
+	* links and springs stay stable at large steps without contact iterations.
+	* each constraint has a compliance (inverse stiffness), 0 is rigid.
+	* constraints are kept in one contiguous array
+	*/
+	class ParticleConstraintSolver {
+	public:
+		enum ConstraintType : unsigned char {
+			// keeps two particles at a fixed distance, pushes and pulls
+			CONSTRAINT_ROD,
+
+			// only pulls, once two particles are further apart than the rest length
+			CONSTRAINT_CABLE,
+
+			/*
+			* keeps the middle particle of three at a fixed distance from their
+			* centroid, resists folding of ropes and cloth
+			*/
+			CONSTRAINT_BENDING
+		};
+
+		enum SolveMode : unsigned char {
+			// one constraint after the other, converges fastest, single threaded
+			SOLVE_GAUSS_SEIDEL,
+
+			/*
+			* every constraint reads the positions of the last sweep and the
+			* corrections to each particle are averaged, fully parallel
+			*/
+			SOLVE_JACOBI,
+
+			/*
+			* constraints are split into colours that share no particle, each
+			* colour is solved gauss-seidel style in parallel
+			*/
+			SOLVE_COLOURED
+		};
+
+		struct Constraint {
+			// the third particle is only used by bending constraints
+			Particle* particles[3];
+
+			// length for rods and cables, centroid distance for bending
+			real rest;
+
+			// inverse stiffness, in m/N for rods and cables
+			real compliance;
+
+			// the multiplier accumulated over the iterations of a step
+			real lambda;
+
+			ConstraintType type;
+		};
+
+		explicit ParticleConstraintSolver(unsigned iterations = 4);
+
+		/*
+		* the add functions return the index of the new constraint
+		*/
+		unsigned addRod(Particle* one, Particle* two, real length, real compliance = 0);
+		unsigned addCable(Particle* one, Particle* two, real maxLength, real compliance = 0);
+
+		/*
+		* a compliant rod, behaves like ParticleSpring with the given constant
+		* but stays stable at any stiffness
+		*/
+		unsigned addSpring(Particle* one, Particle* two, real restLength, real springConstant);
+
+		/*
+		* the rest shape is taken from the current positions
+		*/
+		unsigned addBending(Particle* one, Particle* middle, Particle* two, real compliance);
+
+		Constraint& getConstraint(unsigned index) {
+			return constraints[index];
+		}
+
+		unsigned size() const {
+			return (unsigned)constraints.size();
+		}
+
+		void clear();
+
+		void setIterations(unsigned iterations);
+
+		void setMode(SolveMode mode);
+		SolveMode getMode() const;
+
+		/*
+		* how much of the averaged jacobi correction is applied, 1 is plain
+		* averaging, up to about 1.5 speeds up convergence
+		*/
+		void setRelaxation(real relaxation);
+
+		/*
+		* pool for the jacobi and coloured modes
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		/*
+		* number of colours the constraints were split into
+		*/
+		unsigned getColourCount();
+
+		/*
+		* projects the integrated particles onto the constraints
+		*/
+		void solve(real duration);
+
+	private:
+		/*
+		* particle slots, per particle constraint lists and colours
+		* rebuilt when constraints are added
+		*/
+		void prepare();
+
+		/*
+		* the change of lambda for one constraint, also fills the gradients
+		* scaled by inverse mass (the position change per unit of lambda)
+		*/
+		real solveConstraint(unsigned index, real alphaScale, Vector3* moves) const;
+
+		// adds the change of lambda and moves the particles by it
+		void apply(unsigned index, real deltaLambda, const Vector3* moves);
+
+		void sweepGaussSeidel(real alphaScale);
+		void sweepJacobi(real alphaScale);
+		void sweepColoured(real alphaScale);
+
+		std::vector<Constraint> constraints;
+
+		// slot of each constraint particle, 3 per constraint
+		std::vector<unsigned> constraintSlots;
+
+		// every particle any constraint touches, and its position before solving
+		std::vector<Particle*> particles;
+		std::vector<Vector3> startPositions;
+
+		// jacobi: correction of each constraint to each of its particles and
+		// the constraint entries touching each particle, as slot ranges
+		std::vector<Vector3> corrections;
+		std::vector<unsigned> particleStart;
+		std::vector<unsigned> particleEntries;
+
+		// coloured: constraint indices grouped by colour
+		std::vector<unsigned> colourOrder;
+		std::vector<unsigned> colourStart;
+
+		unsigned iterations;
+		SolveMode mode = SOLVE_GAUSS_SEIDEL;
+		real relaxation = 1;
+		ThreadPool* pool = nullptr;
+		bool prepared = false;
+	};
+}
+
+#endif // !CYCLONE_PCONSTRAINTS_H
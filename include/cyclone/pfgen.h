@@ -17,6 +17,16 @@ namespace cyclone {
 		*/
 		virtual void updateForce(Particle* particle, real duration) = 0;
 	};
+
+	/*
+	* a generator that updates a whole set of particles in one call,
+	* for forces between the particles themselves (e.g. mutual gravitation)
+	*/
+	class ParticleForceBatch {
+	public:
+		virtual void updateForces(real duration) = 0;
+	};
+
 	class ParticleForceRegister {
 	protected:
 		
@@ -32,6 +42,8 @@ namespace cyclone {
 
 		Registry registrations;
 
+		std::vector<ParticleForceBatch*> batches;
+
 	public:
 		/*
 		* registers the given particle to be updated by the given force generator
@@ -44,6 +56,24 @@ namespace cyclone {
 		*/
 		void remove(Particle* particle, ParticleForceGenerator* fg);
 
+		/*
+		* removes every registration of the particle
+		*/
+		void remove(Particle* particle);
+
+		/*
+		* removes every registration of the particles in one pass over the
+		* registrations, the list has to be sorted
+		*/
+		void remove(const std::vector<Particle*>& sortedParticles);
+
+		/*
+		* registers a batch generator, it is updated after the per particle ones
+		*/
+		void addBatch(ParticleForceBatch* batch);
+
+		void removeBatch(ParticleForceBatch* batch);
+
 		/*
 		* clears all registrations
 		*/
@@ -0,0 +1,116 @@
+#ifndef CYCLONE_PFLUID_H
+#define CYCLONE_PFLUID_H
+
+#include "pfgen.h"
+#include "parallel.h"
+#include "collide_fine.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* smoothed particle hydrodynamics over a list of particles (e.g. the world's)
+	* each update sorts the particles into a hashed grid of cells one smoothing
+	* radius wide, so neighbours are found in the 27 surrounding cells and
+	* particles of the same cell sit next to each other in memory. then a
+	* density pass and a pressure + viscosity pass add the fluid forces.
+	* kernels are poly6 for density, spiky for pressure and the viscosity
+	* laplacian (Muller et al. 2003). register it as a batch with the world's
+	* force registry
+	*/
+	class ParticleFluid : public ParticleForceBatch {
+	public:
+		/*
+		* smoothingRadius: kernel support h, about twice the particle spacing
+		* restDensity: density at which the pressure is zero
+		*/
+		ParticleFluid(const std::vector<Particle*>& particles, real smoothingRadius, real restDensity);
+
+		/*
+		* pressure = stiffness * (density - restDensity), never negative
+		* so the fluid does not clump
+		*/
+		void setStiffness(real stiffness);
+
+		void setViscosity(real viscosity);
+
+		/*
+		* planes the fluid is kept on the positive side of
+		*/
+		void addBoundary(const CollisionPlane& plane);
+		void clearBoundaries();
+
+		/*
+		* stiffness of the push from a boundary once a particle is closer than
+		* half a smoothing radius, 0 leaves only enforceBoundaries
+		*/
+		void setBoundaryStiffness(real stiffness);
+
+		/*
+		* pool to split the density, force and bounds passes across
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		virtual void updateForces(real duration);
+
+		/*
+		* moves particles that crossed a boundary back onto it and removes
+		* their velocity into it, scaled by restitution. call after integration
+		*/
+		void enforceBoundaries(real restitution = 0);
+
+		/*
+		* density of a particle at the last update
+		*/
+		real getDensity(unsigned index) const;
+
+	private:
+		void sortIntoCells();
+
+		void computeDensities(unsigned begin, unsigned end);
+
+		void computeForces(unsigned begin, unsigned end);
+
+		/*
+		* calls visit(j) for every sorted particle in the cells around a point
+		*/
+		template <typename Visitor>
+		void forNeighbours(real x, real y, real z, Visitor&& visit) const;
+
+		unsigned cellHash(int x, int y, int z) const;
+
+		const std::vector<Particle*>& particles;
+
+		real smoothingRadius;
+		real restDensity;
+		real stiffness = 1000;
+		real viscosity = 0.1;
+		real boundaryStiffness = 0;
+		ThreadPool* pool = nullptr;
+
+		std::vector<CollisionPlane> boundaries;
+
+		// kernel constants for the current radius
+		real poly6, spikyGradient, viscosityLaplacian;
+
+		// hashed grid: sorted particles of bucket b are [cellStart[b], cellStart[b + 1])
+		unsigned tableMask = 0;
+		std::vector<unsigned> cellStart;
+		std::vector<unsigned> cellOf;
+
+		// scratch kept between updates so a steady update does not allocate
+		std::vector<unsigned> movable, fill;
+
+		// particle state in cell order, order maps back to the particle list
+		std::vector<unsigned> order;
+		std::vector<real> positionX, positionY, positionZ;
+		std::vector<real> velocityX, velocityY, velocityZ;
+		std::vector<real> mass, density, pressure;
+
+		// density by particle list index, for getDensity
+		std::vector<real> densityOf;
+	};
+}
+
+#endif // !CYCLONE_PFLUID_H
@@ -0,0 +1,96 @@
+#ifndef CYCLONE_PGRAVITY_H
+#define CYCLONE_PGRAVITY_H
+
+#include "pfgen.h"
+#include "parallel.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* mutual gravitation between all particles of a list (e.g. the world's)
+	* each update builds an octree over the particles and every particle
+	* walks it with the Barnes-Hut approximation: a cell whose size over its
+	* distance is below theta acts as one body at its centre of mass.
+	* O(n log n) instead of O(n^2). particles with infinite mass neither
+	* attract nor are attracted
+	*/
+	class ParticleGravitation : public ParticleForceBatch {
+	public:
+		/*
+		* gravitationalConstant: G in the units of the scene
+		*/
+		ParticleGravitation(const std::vector<Particle*>& particles, real gravitationalConstant);
+
+		/*
+		* 0 makes every cell open up, which is the exact O(n^2) sum
+		* 0.5 is the usual trade off
+		*/
+		void setTheta(real theta);
+		real getTheta() const;
+
+		/*
+		* the force uses r^2 + softening^2, which keeps close encounters finite
+		*/
+		void setSoftening(real softening);
+		real getSoftening() const;
+
+		/*
+		* pool to split the force pass across
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		virtual void updateForces(real duration);
+
+		/*
+		* the accelaration a body at position would feel from the tree of the
+		* last update
+		*/
+		Vector3 accelarationAt(const Vector3& position) const;
+
+	private:
+		/*
+		* stored depth first, the first child of an inner node follows it
+		* and skip is the index after its subtree, so walks need no stack
+		*/
+		struct Node {
+			Vector3 centreOfMass;
+			real mass;
+
+			// edge length of the cube
+			real size;
+
+			// range of the node's bodies in the sorted arrays
+			unsigned begin, end;
+
+			unsigned skip;
+			bool leaf;
+		};
+
+		// bodies at which a cell stops splitting
+		static const unsigned leafSize = 8;
+		static const unsigned maxDepth = 32;
+
+		void build();
+
+		unsigned buildNode(unsigned begin, unsigned end, const Vector3& centre, real half, unsigned depth);
+
+		const std::vector<Particle*>& particles;
+
+		real gravitationalConstant;
+		real theta = 0.5;
+		real softening = 0;
+		ThreadPool* pool = nullptr;
+
+		std::vector<Node> nodes;
+
+		// bodies in tree order
+		std::vector<unsigned> order;
+		std::vector<real> bodyX, bodyY, bodyZ, bodyMass;
+
+		std::vector<unsigned> scratch;
+	};
+}
+
+#endif // !CYCLONE_PGRAVITY_H
@@ -3,6 +3,8 @@
 
 #include "cyclone/pcontacts.h"
 
+#include <vector>
+
 namespace cyclone {
 
 	class ParticleContactGenerator {
@@ -43,6 +45,55 @@ namespace cyclone {
 
 		virtual unsigned addContact(ParticleContact* contact, unsigned limit) const;
 	};
+
+	/*
+	* many cables and rods in one generator, stored as structure of arrays
+	* links name their particles by index into a particle list (e.g. the
+	* world's). lengths are compared squared in blocks, so slack links cost
+	* no sqrt and no virtual call, only violated links produce contacts.
+	* the indices are not updated when particles leave the list, removing
+	* a particle moves the ones after it, so the set has to be cleared and
+	* filled again afterwards. debug builds assert that indices are in range
+	*/
+	class ParticleLinkSet : public ParticleContactGenerator {
+	public:
+		explicit ParticleLinkSet(const std::vector<Particle*>& particles);
+
+		/*
+		* the add functions return the index of the new link
+		*/
+		unsigned addCable(unsigned one, unsigned two, real maxLength, real restitution);
+
+		// a rod keeps its length, pushing as well as pulling, once it is
+		// more than rodTolerance too long or too short
+		unsigned addRod(unsigned one, unsigned two, real length);
+
+		unsigned size() const {
+			return (unsigned)first.size();
+		}
+
+		void reserve(unsigned count);
+
+		void clear();
+
+		virtual unsigned addContact(ParticleContact* contact, unsigned limit) const;
+
+	private:
+		// links tested per block, sized so the block buffers stay on the stack
+		static const unsigned blockSize = 256;
+
+		// length error a rod accepts before it makes a contact
+		static constexpr real rodTolerance = (real)0.0001;
+
+		const std::vector<Particle*>& particles;
+
+		std::vector<unsigned> first, second;
+		std::vector<real> length, lengthSquared;
+		std::vector<real> restitution;
+
+		// 1 for rods, 0 for cables
+		std::vector<unsigned char> rod;
+	};
 }
 
 
@@ -0,0 +1,249 @@
+#ifndef CYCLONE_POOL_H
+#define CYCLONE_POOL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* engine owned storage for objects that come and go during play
+	* (particles, bodies, primitives, links, force generators...)
+	* slots are allocated in blocks that never move, so pointers stay valid
+	* while the object lives, and freed slots are reused before a new block
+	* is allocated. once the pool has grown to the peak count, creating and
+	* destroying objects does not touch the global allocator
+	*/
+	template <typename T, unsigned BlockSize = 256>
+	class ObjectPool {
+	public:
+		/*
+		* refers to an object of the pool. the generation changes when the
+		* slot is freed, so a handle to a destroyed object resolves to null
+		* instead of to whatever was created in its slot afterwards
+		*/
+		struct Handle {
+			unsigned index = ~0u;
+			unsigned generation = 0;
+
+			bool operator==(const Handle& other) const {
+				return index == other.index && generation == other.generation;
+			}
+			bool operator!=(const Handle& other) const {
+				return !(*this == other);
+			}
+		};
+
+		ObjectPool() = default;
+
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+
+		~ObjectPool() {
+			for (unsigned i = 0; i < capacity(); i++) {
+				Slot& entry = slot(i);
+				if (entry.alive) object(entry)->~T();
+			}
+		}
+
+		/*
+		* grows the pool to hold at least count objects
+		*/
+		void reserve(unsigned count) {
+			while (capacity() < count) grow();
+		}
+
+		/*
+		* constructs an object in a free slot
+		*/
+		template <typename... Args>
+		Handle create(Args&&... args) {
+			if (firstFree == ~0u) grow();
+
+			unsigned index = firstFree;
+			Slot& entry = slot(index);
+			new (entry.storage) T(std::forward<Args>(args)...);
+			firstFree = entry.next;
+			entry.alive = true;
+			live++;
+
+			Handle handle;
+			handle.index = index;
+			handle.generation = entry.generation;
+			return handle;
+		}
+
+		/*
+		* destroys the object and frees its slot, stale handles are ignored
+		*/
+		void destroy(Handle handle) {
+			T* target = get(handle);
+			if (!target) return;
+
+			Slot& entry = slot(handle.index);
+			target->~T();
+			entry.alive = false;
+			entry.generation++;
+			entry.next = firstFree;
+			firstFree = handle.index;
+			live--;
+		}
+
+		/*
+		* the object, or null if the handle is stale
+		*/
+		T* get(Handle handle) {
+			if (handle.index >= capacity()) return nullptr;
+			Slot& entry = slot(handle.index);
+			if (!entry.alive || entry.generation != handle.generation) return nullptr;
+			return object(entry);
+		}
+
+		const T* get(Handle handle) const {
+			return const_cast<ObjectPool*>(this)->get(handle);
+		}
+
+		unsigned size() const {
+			return live;
+		}
+
+		unsigned capacity() const {
+			return (unsigned)blocks.size() * BlockSize;
+		}
+
+	private:
+		struct Slot {
+			alignas(T) unsigned char storage[sizeof(T)];
+			unsigned generation = 1;
+			unsigned next = ~0u;
+			bool alive = false;
+		};
+
+		Slot& slot(unsigned index) const {
+			return blocks[index / BlockSize][index % BlockSize];
+		}
+
+		static T* object(Slot& entry) {
+			return std::launder(reinterpret_cast<T*>(entry.storage));
+		}
+
+		/*
+		* adds a block, its slots go on the free list lowest index first
+		*/
+		void grow() {
+			unsigned start = capacity();
+			blocks.emplace_back(new Slot[BlockSize]);
+			for (unsigned i = BlockSize; i-- > 0;) {
+				blocks.back()[i].next = firstFree;
+				firstFree = start + i;
+			}
+		}
+
+		std::vector<std::unique_ptr<Slot[]>> blocks;
+		unsigned firstFree = ~0u;
+		unsigned live = 0;
+	};
+
+	/*
+	* linear allocator for data that only lives for one frame (contact
+	* lists, pair lists, island buffers...). allocation bumps an offset and
+	* reset frees everything at once. a frame that overflows the buffer is
+	* served from extra blocks, and the next reset replaces the buffer by one
+	* big enough for that frame, so a steady state frame does not allocate
+	*/
+	class FrameArena {
+	public:
+		explicit FrameArena(size_t capacity = 64 * 1024) : buffer(allocateBlock(capacity)), bufferSize(capacity) {}
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+
+		~FrameArena() {
+			releaseOverflow();
+			std::free(buffer);
+		}
+
+		/*
+		* uninitialised memory, valid until the next reset
+		*/
+		void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t)) {
+			size_t base = (size_t)buffer;
+			size_t start = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+			if (start + bytes <= bufferSize) {
+				offset = start + bytes;
+				peak = offset > peak ? offset : peak;
+				return buffer + start;
+			}
+
+			// served on the side, counted so the next buffer holds it
+			void* block = allocateBlock(bytes + alignment);
+			overflow.push_back(block);
+			overflowBytes += bytes + alignment;
+			size_t address = ((size_t)block + alignment - 1) & ~(alignment - 1);
+			return (void*)address;
+		}
+
+		/*
+		* count default constructed objects, which are never destroyed, so
+		* T must be trivially destructible
+		*/
+		template <typename T>
+		T* allocate(size_t count) {
+			static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+			T* result = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+			for (size_t i = 0; i < count; i++) new (result + i) T();
+			return result;
+		}
+
+		/*
+		* frees everything allocated since the last reset
+		*/
+		void reset() {
+			if (!overflow.empty()) {
+				size_t needed = peak + overflowBytes;
+				releaseOverflow();
+				std::free(buffer);
+				buffer = allocateBlock(needed);
+				bufferSize = needed;
+			}
+			offset = 0;
+			peak = 0;
+		}
+
+		size_t used() const {
+			return offset + overflowBytes;
+		}
+
+		size_t capacity() const {
+			return bufferSize;
+		}
+
+	private:
+		static unsigned char* allocateBlock(size_t bytes) {
+			void* block = std::malloc(bytes > 0 ? bytes : 1);
+			if (!block) throw std::bad_alloc();
+			return static_cast<unsigned char*>(block);
+		}
+
+		void releaseOverflow() {
+			for (void* block : overflow) std::free(block);
+			overflow.clear();
+			overflowBytes = 0;
+		}
+
+		unsigned char* buffer;
+		size_t bufferSize;
+		size_t offset = 0;
+		size_t peak = 0;
+
+		std::vector<void*> overflow;
+		size_t overflowBytes = 0;
+	};
+}
+
+#endif // !CYCLONE_POOL_H
@@ -0,0 +1,155 @@
+#ifndef CYCLONE_PREGIONS_H
+#define CYCLONE_PREGIONS_H
+
+#include "pworld.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* splits a very large particle world into cubic regions and keeps only
+	* the ones around points of interest (focuses) in the world
+	* regions within a focus radius are active and simulated, regions next
+	* to an active one are loaded as a frozen halo (infinite mass) so
+	* particles at the edge of the active area still collide with what is
+	* across the boundary, and every other region is paged out into a
+	* compact binary page, kept in memory or written to a page directory and
+	* memory mapped back in. memory and step cost follow the active area
+	*
+	* particles of loaded regions are created with the world's createParticle,
+	* so handles stay valid only while their region is loaded. index based
+	* generators do not survive the list changing, contact generators
+	* should walk the world's particle list
+	*/
+	class ParticleRegions {
+	public:
+		ParticleRegions(ParticleWorld& world, real regionSize);
+
+		/*
+		* adds a particle to the region it is in, loaded or not
+		*/
+		void add(const Particle& particle);
+
+		/*
+		* force generators applied to every particle while it is in the world
+		* add them before adding particles
+		*/
+		void addForceGenerator(ParticleForceGenerator* generator);
+
+		/*
+		* points of interest, regions overlapping the sphere are active
+		*/
+		unsigned addFocus(const Vector3& position, real radius);
+		void moveFocus(unsigned focus, const Vector3& position);
+
+		/*
+		* pages go to files in this directory when set, and are memory mapped
+		* back in. an empty path keeps them in memory
+		*/
+		void setPageDirectory(const std::string& directory);
+
+		/*
+		* writes every page still held in memory to the page directory, e.g.
+		* after adding the particles of a map
+		*/
+		void flushPages();
+
+		/*
+		* moves particles that crossed into another region and loads, freezes
+		* or pages out regions after the focuses moved. call between frames
+		*/
+		void update();
+
+		unsigned getRegionCount() const {
+			return (unsigned)regions.size();
+		}
+
+		unsigned getLoadedRegionCount() const {
+			return (unsigned)loaded.size();
+		}
+
+		unsigned getActiveRegionCount() const;
+
+		/*
+		* bytes of pages held in memory
+		*/
+		size_t getPagedBytes() const {
+			return pagedBytes;
+		}
+
+	private:
+		enum RegionState { REGION_PAGED, REGION_HALO, REGION_ACTIVE };
+
+		struct Region {
+			int x, y, z;
+			RegionState state = REGION_PAGED;
+
+			// particles in the world while loaded
+			std::vector<ParticleWorld::ParticleHandle> particles;
+
+			// inverse masses of the particles while frozen in a halo
+			std::vector<real> frozenInverseMass;
+
+			// the particles while paged out, in memory or in the page file
+			std::vector<unsigned char> page;
+			unsigned pagedCount = 0;
+			bool onDisk = false;
+
+			// whether some loaded state is wanted, worked out by update
+			RegionState wanted = REGION_PAGED;
+		};
+
+		struct Focus {
+			Vector3 position;
+			real radius;
+		};
+
+		static uint64_t key(int x, int y, int z);
+		void cellOf(const Vector3& position, int* x, int* y, int* z) const;
+		Region& regionAt(int x, int y, int z);
+
+		/*
+		* adds a particle to a loaded region's world particles, returns the
+		* world's copy
+		*/
+		Particle* enter(Region& region, const Particle& particle);
+
+		/*
+		* forgets the particles of the region that were destroyed through the
+		* world, keeping the frozen masses in step with the handles
+		*/
+		void dropDestroyed(Region& region);
+
+		/*
+		* takes world particles out of the world, all in one go
+		*/
+		void leave(const std::vector<ParticleWorld::ParticleHandle>& handles);
+
+		void setState(Region& region, RegionState state);
+		void freeze(Region& region);
+		void unfreeze(Region& region);
+
+		void pageIn(Region& region);
+		void pageOut(Region& region);
+		void appendToPage(Region& region, const Particle& particle);
+		void writePage(Region& region);
+		void readFromDisk(Region& region);
+		std::string pagePath(const Region& region) const;
+
+		ParticleWorld& world;
+		real regionSize;
+		std::string pageDirectory;
+
+		std::unordered_map<uint64_t, Region> regions;
+		std::vector<uint64_t> loaded;
+		std::vector<Focus> focuses;
+		std::vector<ParticleForceGenerator*> generators;
+		size_t pagedBytes = 0;
+	};
+}
+
+#endif // !CYCLONE_PREGIONS_H
@@ -0,0 +1,90 @@
+#ifndef CYCLONE_PSPRINGS_H
+#define CYCLONE_PSPRINGS_H
+
+#include "pfgen.h"
+#include "parallel.h"
+
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* many springs between particles of a list (e.g. the world's), kept as an
+	* edge list in structure of arrays. each spring is evaluated once per
+	* update and its force written per edge, then every particle sums the
+	* edges that touch it through a compressed (CSR) adjacency list. both
+	* passes only write their own entries, so they run in parallel without
+	* locks. register it as a batch with the world's force registry
+	*/
+	class ParticleSpringNetwork : public ParticleForceBatch {
+	public:
+		explicit ParticleSpringNetwork(const std::vector<Particle*>& particles);
+
+		/*
+		* damping resists the two ends moving apart or together, along the spring
+		* returns the index of the new spring
+		*/
+		unsigned addSpring(unsigned one, unsigned two, real springConstant, real restLength, real damping = 0);
+
+		/*
+		* the same, with the rest length taken from the current positions
+		*/
+		unsigned addSpring(unsigned one, unsigned two, real springConstant);
+
+		/*
+		* places columns * rows particles starting at first on a grid, row major,
+		* and connects them. structural springs join neighbours, shear springs
+		* diagonals and bend springs every second particle
+		*/
+		void buildCloth(unsigned first, unsigned columns, unsigned rows,
+			const Vector3& origin, const Vector3& across, const Vector3& down,
+			real springConstant, real damping = 0, bool shear = true, bool bend = true);
+
+		/*
+		* places particles starting at first on the vertices and springs along
+		* every edge of the tetrahedra (4 vertex indices each), shared edges once
+		*/
+		void buildTetrahedra(unsigned first, const Vector3* vertices, unsigned vertexCount,
+			const unsigned* tetrahedra, unsigned tetrahedronCount,
+			real springConstant, real damping = 0);
+
+		unsigned size() const {
+			return (unsigned)first.size();
+		}
+
+		void clear();
+
+		/*
+		* pool to split the spring and gather passes across
+		*/
+		void setThreadPool(ThreadPool* pool);
+
+		virtual void updateForces(real duration);
+
+	private:
+		/*
+		* the per particle lists of springs, rebuilt when springs are added
+		*/
+		void prepare();
+
+		const std::vector<Particle*>& particles;
+
+		std::vector<unsigned> first, second;
+		std::vector<real> springConstant, restLength, damping;
+
+		// force on the first end of each spring, the second gets the opposite
+		std::vector<real> forceX, forceY, forceZ;
+
+		/*
+		* springs touching each particle as edge * 2 + end, for particle p in
+		* [adjacencyStart[p], adjacencyStart[p + 1])
+		*/
+		std::vector<unsigned> adjacencyStart;
+		std::vector<unsigned> adjacency;
+
+		ThreadPool* pool = nullptr;
+		bool prepared = false;
+	};
+}
+
+#endif // !CYCLONE_PSPRINGS_H
@@ -3,6 +3,13 @@
 
 #include <cyclone/plinks.h>
 #include <cyclone/pfgen.h>
+#include <cyclone/pconstraints.h>
+#include <cyclone/determinism.h>
+#include <cyclone/pool.h>
+#include <cyclone/contact_buffer.h>
+#include <cyclone/snapshot.h>
+#include <cyclone/parallel.h>
+#include <cyclone/task_graph.h>
 #include <vector>
 
 using namespace std;
@@ -18,9 +25,12 @@ namespace cyclone {
 
 		using ContactGenerators = vector<ParticleContactGenerator*>;
 
+		using ParticleHandle = ObjectPool<Particle>::Handle;
+
 		/*
 		* creates the new world simulation
-		* max contactsL: maximum number of contacts that can be handled / frame
+		* max contactsL: maximum number of contacts that can be handled / frame,
+		* the starting capacity if the contact buffer is made growable
 		* iterations: number of iterations to give to the contact resolver
 		*/
 		ParticleWorld(unsigned maxContacts, unsigned iterations = 0);
@@ -46,11 +56,87 @@ namespace cyclone {
 		*/
 		void runPhysics(real duration);
 
+		/*
+		* adds a frame (startFrame and runPhysics) to a step graph as phases
+		* over the particle resources, so other subsystems' phases can run
+		* alongside. commands are not applied
+		*/
+		void addStepTasks(TaskGraph& graph);
+
 		/*
 		* initializes the world for a frame. clears forces accumulators
 		*/
 		void startFrame();
 
+		/*
+		* starts a frame: clears the accumulators and applies the queued
+		* commands on the caller, then runs runPhysics on the pool and returns
+		* while it runs. until endStep the caller must not
+		* touch the world's particles or generators except through the queue
+		* functions below, read state from a snapshot buffer instead
+		*/
+		void beginStep(real duration, ThreadPool& pool);
+
+		/*
+		* waits for the step started by beginStep, does nothing if none is
+		*/
+		void endStep();
+
+		bool isStepping() const;
+
+		/*
+		* command buffer, filled from one thread at any time and applied in
+		* queue order by the next beginStep, right after the accumulators are
+		* cleared, or by applyCommands. creating touches only the pool and
+		* the queue, which the step never does, so it is safe during a step.
+		* a queued particle's handle can be used straight away, but it only
+		* joins the world when the commands are applied
+		*/
+		ParticleHandle queueCreateParticle(const Particle& particle);
+		void queueDestroyParticle(ParticleHandle handle);
+		void queueForce(ParticleHandle handle, const Vector3& force);
+
+		/*
+		* applies the queued commands, for frames run with runPhysics
+		* call it between startFrame and runPhysics
+		*/
+		void applyCommands();
+
+		/*
+		* creates a particle in the world's own pool and adds it to the list
+		*/
+		ParticleHandle createParticle();
+
+		/*
+		* removes a particle created by the world from the list and the force
+		* registry and frees its slot. later particles move down one place in
+		* the list, which index based generators should be told about
+		*/
+		void destroyParticle(ParticleHandle handle);
+
+		/*
+		* destroys many particles at once, with one pass over the list and
+		* the force registry instead of one per particle. the particles left
+		* keep their order
+		*/
+		void destroyParticles(const ParticleHandle* handles, unsigned count);
+
+		/*
+		* the particle, or null once it has been destroyed
+		*/
+		Particle* getParticle(ParticleHandle handle);
+
+		/*
+		* grows the particle pool and list so creating up to count particles
+		* does not allocate
+		*/
+		void reserveParticles(unsigned count);
+
+		/*
+		* scratch memory for the current step, reset when runPhysics starts
+		*/
+		FrameArena& getFrameArena();
+
 		/*
 		* returns the list of particles in the world
 		*/
@@ -67,6 +153,73 @@ namespace cyclone {
 
 		ParticleForceRegister& getForceRegistry();
 
+		/*
+		* returns the integration context, e.g. to pick its damping mode
+		*/
+		IntegrationContext& getIntegrationContext();
+
+		/*
+		* returns the position based constraint solver, run after integration
+		* and before the contact generators
+		*/
+		ParticleConstraintSolver& getConstraintSolver();
+
+		/*
+		* the contacts of a frame, make it growable or read its stats here
+		*/
+		ContactBuffer<ParticleContact>& getContactBuffer();
+
+		/*
+		* buffer that runPhysics publishes every particle's state to, in list
+		* order, at the end of each frame. null stops publishing
+		*/
+		void setSnapshotBuffer(SnapshotBuffer* buffer);
+
+		/*
+		* level of detail. particles farther than distance from every
+		* observer are integrated every interval frames with the time that
+		* built up and the average of the forces applied over it, interval 0
+		* freezes them. tiers are kept sorted by
+		* distance, with none or no observers every particle runs at full rate
+		*/
+		void addLodTier(real distance, unsigned interval);
+		void clearLodTiers();
+
+		unsigned addObserver(const Vector3& position);
+		void moveObserver(unsigned observer, const Vector3& position);
+		void clearObservers();
+
+		/*
+		* moving out to a farther tier needs distance * (1 + hysteresis), so
+		* particles on a boundary do not flip between tiers every frame
+		*/
+		void setLodHysteresis(real hysteresis);
+
+		/*
+		* a reduced particle touching a full rate one runs at full rate for
+		* this many frames
+		*/
+		void setLodWakeFrames(unsigned frames);
+
+		/*
+		* particles integrated in the last frame
+		*/
+		unsigned getIntegratedCount() const;
+
+		/*
+		* in deterministic mode the contacts of a frame are sorted by the
+		* indices of their particles in the world before they are resolved,
+		* so the result does not depend on the order generators were added
+		*/
+		void setDeterministic(bool deterministic);
+		bool isDeterministic() const;
+
+		/*
+		* hash of every particle's state in list order, compare between
+		* lockstep peers after each frame to detect a desync
+		*/
+		uint64_t stateHash() const;
+
 
 	protected:
 		Particles particles;
@@ -79,8 +232,19 @@ namespace cyclone {
 
 		ParticleForceRegister forceRegistry;
 
+		/*
+		* caches damping factors across the particles and steps
+		*/
+		IntegrationContext integrationContext;
+
+		ParticleConstraintSolver constraintSolver;
+
 		ParticleContactResolver resolver;
 
+		ObjectPool<Particle> particlePool;
+
+		FrameArena frameArena;
+
 		/*
 		* holds the list of contact generators
 		* like rosds, cables...
@@ -90,12 +254,96 @@ namespace cyclone {
 		/*
 		* holds the list of contacts needed
 		*/
-		ParticleContact* contacts;
+		ContactBuffer<ParticleContact> contactBuffer;
+
+		bool deterministic = false;
+
+		SnapshotBuffer* snapshots = nullptr;
+		uint64_t frames = 0;
+
+		struct Command {
+			enum Type { CREATE, DESTROY, FORCE };
+
+			Type type;
+			ParticleHandle handle;
+			Vector3 force;
+		};
+		vector<Command> commands;
+
+		ThreadPool::AsyncTask stepTask;
+
+		struct LodTier {
+			real distance;
+			unsigned interval;
+		};
+
+		struct LodState {
+			unsigned char tier = 0;
+
+			// frames since the particle was last integrated
+			unsigned short pending = 0;
+
+			// frames until it is integrated next
+			unsigned short countdown = 1;
+
+			// frames left at full rate after a contact
+			unsigned short wake = 0;
+
+			// frames the last integration covered, the verlet schemes' previous step
+			unsigned short lastFrames = 1;
+
+			// forces of the frames built up since the last integration
+			Vector3 forceSum;
+		};
+
+		vector<LodTier> lodTiers;
+		vector<Vector3> observers;
+		vector<LodState> lodStates;
+		real lodHysteresis = 0.1;
+		unsigned lodWakeFrames = 30;
+		unsigned integratedCount = 0;
+
+		// contexts for steps of several frames, by frame count
+		vector<IntegrationContext> lodContexts;
+
+		std::pair<const Particle*, unsigned>* particleIndex = nullptr;
+
+		/*
+		* generates, sorts and resolves the frame's contacts
+		*/
+		void resolveFrameContacts(real duration);
+
+		/*
+		* counts the frame and publishes it to the snapshot buffer
+		*/
+		void publishFrame();
+
+		/*
+		* integrates the particles that are due under their lod tier
+		*/
+		void integrateLod(real duration);
+
+		/*
+		* the tier a particle should be in, from its observer distance
+		*/
+		unsigned lodTierOf(unsigned index, unsigned current) const;
+
+		/*
+		* reduced particles in contact with full rate ones run at full rate
+		*/
+		void wakeContacts(unsigned count);
+
+		/*
+		* a table of the particles by address in the frame arena, so contacts
+		* can find their particles' indices
+		*/
+		void buildParticleIndex();
+		unsigned indexOf(const Particle* particle) const;
 
 		/*
-		* size of the array of particle contacts
+		* sorts the frame's contacts for deterministic mode
 		*/
-		unsigned maxContacts;
+		void sortContacts(unsigned count);
 	};
 }
 
@@ -0,0 +1,111 @@
+#ifndef CYCLONE_SNAPSHOT_H
+#define CYCLONE_SNAPSHOT_H
+
+#include "core.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* the published state of one body or particle
+	* particles have the identity orientation and no rotation
+	*/
+	struct TransformState {
+		Vector3 position;
+		Quaternion orientation;
+		Vector3 velocity;
+		Vector3 rotation;
+	};
+
+	/*
+	* hands the state of a world from the simulation thread to any number
+	* of reader threads (render, replication, ai...) without locks
+	* the writer fills a spare buffer and publishes it with one atomic
+	* pointer swap, readers pin the published buffer with a reference count.
+	* there are three buffers, so the writer normally finds one that is
+	* neither published nor read. if readers still hold both spares the
+	* publish is skipped rather than waiting for them, so the simulation
+	* never blocks and readers never see a buffer that is being written
+	*/
+	class SnapshotBuffer {
+	private:
+		struct Slot {
+			std::vector<TransformState> states;
+			uint64_t frame = 0;
+			std::atomic<unsigned> readers{ 0 };
+		};
+
+	public:
+		/*
+		* a pinned snapshot, immutable while the view lives
+		* empty if nothing has been published yet
+		*/
+		class View {
+		public:
+			View() = default;
+			View(View&& other) noexcept;
+			View& operator=(View&& other) noexcept;
+			View(const View&) = delete;
+			View& operator=(const View&) = delete;
+			~View();
+
+			const TransformState* data() const;
+			unsigned size() const;
+			uint64_t frame() const;
+
+			bool empty() const {
+				return size() == 0;
+			}
+
+			const TransformState& operator[](unsigned index) const {
+				return data()[index];
+			}
+
+		private:
+			friend class SnapshotBuffer;
+			explicit View(Slot* slot) : slot(slot) {}
+
+			Slot* slot = nullptr;
+		};
+
+		SnapshotBuffer() = default;
+		SnapshotBuffer(const SnapshotBuffer&) = delete;
+		SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+		/*
+		* writer side, from one thread. returns count states to fill, or null
+		* when every spare buffer is being read and this frame is skipped
+		*/
+		TransformState* beginPublish(unsigned count);
+
+		/*
+		* makes the buffer from beginPublish the current snapshot
+		*/
+		void endPublish(uint64_t frame);
+
+		/*
+		* reader side, from any thread. pins the latest snapshot
+		*/
+		View read() const;
+
+		/*
+		* frames skipped because readers held every spare buffer
+		*/
+		unsigned getSkipped() const {
+			return skipped;
+		}
+
+	private:
+		Slot slots[3];
+		mutable std::atomic<Slot*> published{ nullptr };
+
+		// the slot between beginPublish and endPublish
+		Slot* writing = nullptr;
+		unsigned skipped = 0;
+	};
+}
+
+#endif // !CYCLONE_SNAPSHOT_H
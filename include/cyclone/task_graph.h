@@ -0,0 +1,115 @@
+#ifndef CYCLONE_TASK_GRAPH_H
+#define CYCLONE_TASK_GRAPH_H
+
+#include "core.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* data a step phase can read or write, one bit each. custom data can
+	* use the bits from RESOURCE_USER up
+	*/
+	enum StepResource : uint64_t {
+		RESOURCE_PARTICLES = 1ull << 0,
+		RESOURCE_PARTICLE_FORCES = 1ull << 1,
+		RESOURCE_PARTICLE_CONTACTS = 1ull << 2,
+		RESOURCE_BODIES = 1ull << 3,
+		RESOURCE_BODY_FORCES = 1ull << 4,
+		RESOURCE_PRIMITIVES = 1ull << 5,
+		RESOURCE_BROADPHASE = 1ull << 6,
+		RESOURCE_CONTACTS = 1ull << 7,
+		RESOURCE_USER = 1ull << 16
+	};
+
+	/*
+	* the phases of a step as a dependency graph
+	* each task declares the resources it reads and writes. a task waits for
+	* every earlier task that writes what it touches or reads what it writes,
+	* so the graph gives the same result as running the tasks in the order
+	* they were added. independent tasks run at the same time, the one with
+	* the longest chain of work behind it first, and threads with no task
+	* to start help with the parallel loops of running ones
+	*/
+	class TaskGraph {
+	public:
+		using Work = std::function<void(real duration)>;
+
+		/*
+		* cost is an estimate of the task's run time in any unit, used to find
+		* the critical path. returns the index of the task
+		*/
+		unsigned add(const Work& work, uint64_t reads, uint64_t writes, real cost = 1);
+
+		/*
+		* makes after wait for before on top of the resource dependencies
+		*/
+		void precede(unsigned before, unsigned after);
+
+		unsigned size() const {
+			return (unsigned)tasks.size();
+		}
+
+		void clear();
+
+		/*
+		* runs every task once on the pool and returns when all are done
+		*/
+		void run(real duration, ThreadPool& pool);
+
+		/*
+		* the same on the caller, in the order the tasks were added
+		*/
+		void run(real duration);
+
+	private:
+		struct Task {
+			Work work;
+			uint64_t reads;
+			uint64_t writes;
+			real cost;
+
+			// longest chain of cost from this task to the end of the graph
+			real priority = 0;
+			std::vector<unsigned> successors;
+			unsigned predecessorCount = 0;
+
+			// predecessors still running this frame
+			std::atomic<unsigned> waiting{ 0 };
+		};
+
+		/*
+		* works out the edges and priorities after the graph changed
+		*/
+		void prepare();
+
+		bool lessUrgent(unsigned a, unsigned b) const;
+
+		void makeReady(unsigned task, ThreadPool* pool);
+
+		/*
+		* what a thread does during run: take the most urgent ready task,
+		* otherwise help with a parallel loop, otherwise sleep until one of
+		* them may have appeared, until every task has finished
+		*/
+		void runLane(real duration, ThreadPool& pool);
+
+		std::vector<std::unique_ptr<Task>> tasks;
+		std::vector<std::pair<unsigned, unsigned>> explicitEdges;
+		bool prepared = false;
+
+		// heap of ready tasks ordered by priority, guarded by mutex
+		std::vector<unsigned> ready;
+		std::mutex mutex;
+		std::atomic<unsigned> remaining{ 0 };
+	};
+}
+
+#endif // !CYCLONE_TASK_GRAPH_H
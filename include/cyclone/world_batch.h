@@ -0,0 +1,132 @@
+#ifndef CYCLONE_WORLD_BATCH_H
+#define CYCLONE_WORLD_BATCH_H
+
+#include "pworld.h"
+#include "body_set.h"
+
+#include <memory>
+#include <vector>
+
+namespace cyclone {
+
+	/*
+	* many small independent worlds stepped together
+	* the particles of every world live in one arena, each world owning a
+	* contiguous slice, the rigid bodies in one RigidBodySet and the contacts
+	* in one shared array, so nothing is allocated per world per step and a
+	* step of all worlds is one pass over contiguous memory. worlds are
+	* stepped in parallel, each on a single thread, so a world gives the same
+	* result however many threads the pool has
+	*/
+	class WorldBatch {
+	public:
+		/*
+		* particleCapacity and contactCapacity bound the total over all worlds,
+		* the arenas are allocated once so particle pointers stay valid
+		*/
+		WorldBatch(unsigned particleCapacity, unsigned contactCapacity);
+
+		// returned by createWorld and clone when the arenas are full
+		static const unsigned noWorld = ~0u;
+
+		/*
+		* adds a world with its own particles, contact slots and bodies
+		* returns its index, or noWorld if the arenas have no room left
+		*/
+		unsigned createWorld(unsigned particleCount, unsigned maxContacts, unsigned bodyCount = 0);
+
+		/*
+		* adds a world with a copy of another's particles, bodies and reset
+		* state. force generators and contact generators hold particle
+		* pointers of the original, so they are not copied. noWorld if the
+		* arenas have no room left
+		*/
+		unsigned clone(unsigned world);
+
+		/*
+		* remembers the current state of a world for reset
+		*/
+		void saveResetState(unsigned world);
+
+		/*
+		* puts a world back into the state saved by saveResetState, or the
+		* state it was created with
+		*/
+		void reset(unsigned world);
+
+		unsigned size() const {
+			return (unsigned)worlds.size();
+		}
+
+		/*
+		* the world's particles, usable as the particle list of index based
+		* generators such as ParticleLinkSet or ParticleSpringNetwork. the
+		* list stays where it is when more worlds are added
+		*/
+		std::vector<Particle*>& getParticles(unsigned world);
+
+		ParticleForceRegister& getForceRegistry(unsigned world);
+
+		std::vector<ParticleContactGenerator*>& getContactGenerators(unsigned world);
+
+		/*
+		* index in getBodies() of one of the world's bodies
+		*/
+		unsigned getBody(unsigned world, unsigned body) const;
+
+		unsigned getBodyCount(unsigned world) const;
+
+		RigidBodySet& getBodies() {
+			return bodies;
+		}
+
+		/*
+		* steps every world forward in time
+		*/
+		void stepAll(real duration);
+
+		/*
+		* the same, split across the pool
+		*/
+		void stepAll(real duration, ThreadPool& pool);
+
+		/*
+		* hash of one world's particles and bodies, see StateHash
+		*/
+		uint64_t stateHash(unsigned world) const;
+
+	private:
+		struct World {
+			unsigned particleStart;
+			unsigned contactStart;
+			unsigned maxContacts;
+
+			std::vector<Particle*> particles;
+			std::vector<unsigned> bodies;
+
+			ParticleForceRegister forceRegistry;
+			std::vector<ParticleContactGenerator*> contactGenerators;
+			IntegrationContext integrationContext;
+
+			std::vector<Particle> resetParticles;
+			std::vector<RigidBody> resetBodies;
+		};
+
+		/*
+		* forces, integration and contacts of one world's particles
+		*/
+		void stepParticles(World& world, real duration);
+
+		std::vector<Particle> particleArena;
+		std::vector<ParticleContact> contactArena;
+		unsigned particlesUsed = 0;
+		unsigned contactsUsed = 0;
+
+		RigidBodySet bodies;
+
+		// each world on its own, so references into it survive new worlds
+		std::vector<std::unique_ptr<World>> worlds;
+	};
+}
+
+#endif // !CYCLONE_WORLD_BATCH_H
@@ -1,5 +1,7 @@
 #include <cyclone/body.h>
 #include <memory.h>
+#include <cfloat>
+#include <cmath>
 #include <assert.h>
 
 using namespace cyclone;
@@ -7,7 +9,10 @@ using namespace cyclone;
 RigidBody::RigidBody() :
 	inverseMass(1.0),
 	linearDamping(0.99),
-	angularDamping(0.8) {
+	angularDamping(0.8),
+	continuous(false),
+	bodyType(BODY_DYNAMIC),
+	hasTarget(false) {
 	position = Vector3(0, 0, 0);
 	orientation = Quaternion(1, 0, 0, 0);
 	velocity = Vector3(0, 0, 0);
@@ -25,6 +30,12 @@ void RigidBody::calculateDerivedData() {
 	Matrix3 rot;
 	rot.setOrientation(orientation);
 
+	// only dynamic bodies turn under contacts
+	if (bodyType != BODY_DYNAMIC) {
+		inverseInertiaTensorWorld = Matrix3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+		return;
+	}
+
 	Matrix3 iitWorld = rot * inverseInertiaTensor;
 
 
@@ -46,29 +57,127 @@ void RigidBody::calculateDerivedData() {
 }
 
 void RigidBody::integrate(real duration) {
-	if (inverseMass <= 0.0)
-		return; // imovable object
+	if (integrateFixed(duration)) return;
+
+	integrateLinear(duration, std::pow(linearDamping, duration));
+	integrateAngular(duration, std::pow(angularDamping, duration));
+
+	orientation.addScaledVector(rotation, duration);
+
+	calculateDerivedData();
+
+	clearAccumulators();
+}
+
+void RigidBody::integrate(IntegrationContext& context) {
+	real duration = context.getDuration();
+	if (integrateFixed(duration)) return;
+
+	real linearFactor = context.dampingFactor(linearDamping);
+
+	Vector3 resultingAcc = accelaration;
+	resultingAcc += forceAccum * inverseMass;
+
+	switch (context.getScheme()) {
+	case IntegrationContext::INTEGRATE_DEFAULT:
+	case IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER:
+		integrateLinear(duration, linearFactor);
+		break;
+
+	case IntegrationContext::INTEGRATE_EXPLICIT_EULER:
+		position += velocity * duration;
+		velocity += resultingAcc * duration;
+		velocity *= linearFactor;
+		lastFrameAccelaration = resultingAcc;
+		break;
+
+	case IntegrationContext::INTEGRATE_POSITION_VERLET:
+		velocity += resultingAcc * ((duration + context.getPreviousDuration()) * 0.5);
+		velocity *= linearFactor;
+		position += velocity * duration;
+		lastFrameAccelaration = resultingAcc;
+		break;
+
+	case IntegrationContext::INTEGRATE_VELOCITY_VERLET:
+		// finish the last step's velocity with the accelaration at its end
+		velocity += (resultingAcc - lastFrameAccelaration) * (context.getPreviousDuration() * 0.5);
+		position += velocity * duration;
+		position += resultingAcc * (duration * duration * 0.5);
+		velocity += resultingAcc * duration;
+		velocity *= linearFactor;
+		lastFrameAccelaration = resultingAcc;
+		break;
+	}
+
+	// rotation is always advanced velocity first, the context picks how
+	// the orientation follows it
+	integrateAngular(duration, context.dampingFactor(angularDamping));
+
+	context.rotate(&orientation, rotation);
+
+	calculateDerivedData();
+
+	clearAccumulators();
+}
 
+bool RigidBody::integrateFixed(real duration) {
+	if (bodyType == BODY_KINEMATIC) {
+		integrateKinematic(duration);
+		return true;
+	}
+
+	// imovable object
+	return bodyType == BODY_STATIC || inverseMass <= 0.0;
+}
+
+void RigidBody::integrateKinematic(real duration) {
+	if (hasTarget && duration > 0) {
+		velocity = (targetPosition - position) * (1 / duration);
+
+		// the turn from the current orientation to the target, the short way round
+		Quaternion turn = targetOrientation;
+		turn *= Quaternion(orientation.r, -orientation.i, -orientation.j, -orientation.k);
+		if (turn.r < 0) turn = Quaternion(-turn.r, -turn.i, -turn.j, -turn.k);
+
+		Vector3 axis(turn.i, turn.j, turn.k);
+		real sine = axis.magnitude();
+		real angle = 2 * std::atan2(sine, turn.r);
+		rotation = axis * (sine > 0 ? angle / (sine * duration) : 2 / duration);
+
+		position = targetPosition;
+		orientation = targetOrientation;
+		hasTarget = false;
+	}
+	else {
+		position += velocity * duration;
+		orientation.addScaledVector(rotation, duration);
+	}
+
+	// forces do not move a kinematic body
+	lastFrameAccelaration = Vector3(0, 0, 0);
+
+	calculateDerivedData();
+
+	clearAccumulators();
+}
+
+void RigidBody::integrateLinear(real duration, real linearFactor) {
 	lastFrameAccelaration = accelaration;
 	lastFrameAccelaration += forceAccum * inverseMass;
 
 	velocity += lastFrameAccelaration * duration;
 
-	velocity *= std::pow(linearDamping, duration);
+	velocity *= linearFactor;
 
 	position += velocity * duration;
+}
 
+void RigidBody::integrateAngular(real duration, real angularFactor) {
 	Vector3 angularAcceleration = inverseInertiaTensorWorld * torqueAccum;
 
 	rotation += angularAcceleration * duration;
 
-	rotation *= std::pow(angularDamping, duration);
-
-	orientation.addScaledVector(rotation, duration);
-
-	calculateDerivedData();
-
-	clearAccumulators();
+	rotation *= angularFactor;
 }
 
 void RigidBody::addForce(const Vector3& force) {
@@ -93,6 +202,11 @@ void RigidBody::addForceAtBodyPoint(const Vector3& force, const Vector3& point)
     addForceAtPoint(force, pt);
 }
 
+void RigidBody::addTorque(const Vector3& torque)
+{
+    torqueAccum += torque;
+}
+
 void RigidBody::clearAccumulators()
 {
     forceAccum = Vector3(0, 0, 0);
@@ -111,7 +225,7 @@ void RigidBody::setMass(real mass) {
 }
 
 real RigidBody::getMass() const {
-    if (inverseMass == 0) return DBL_MAX; // Represent infinite mass
+    if (inverseMass == 0 || bodyType != BODY_DYNAMIC) return DBL_MAX; // Represent infinite mass
     return 1.0f / inverseMass;
 }
 
@@ -120,11 +234,37 @@ void RigidBody::setInverseMass(real inverseMass) {
 }
 
 real RigidBody::getInverseMass() const {
-    return inverseMass;
+    // Kinematic and static bodies are not moved by impulses
+    return bodyType == BODY_DYNAMIC ? inverseMass : 0;
 }
 
 bool RigidBody::hasFiniteMass() const {
-    return inverseMass >= 0.0f;
+    return bodyType == BODY_DYNAMIC && inverseMass > 0.0f;
+}
+
+void RigidBody::setBodyType(BodyType type) {
+    bodyType = type;
+    hasTarget = false;
+    if (type != BODY_DYNAMIC) {
+        lastFrameAccelaration = Vector3(0, 0, 0);
+        clearAccumulators();
+    }
+    if (type == BODY_STATIC) {
+        velocity = Vector3(0, 0, 0);
+        rotation = Vector3(0, 0, 0);
+    }
+    calculateDerivedData();
+}
+
+RigidBody::BodyType RigidBody::getBodyType() const {
+    return bodyType;
+}
+
+void RigidBody::setKinematicTarget(const Vector3& position, const Quaternion& orientation) {
+    targetPosition = position;
+    targetOrientation = orientation;
+    targetOrientation.normalize();
+    hasTarget = true;
 }
 
 void RigidBody::setInertiaTensor(const Matrix3& inertiaTensor) {
@@ -147,6 +287,14 @@ void RigidBody::setDamping(real linearDamping, real angularDamping) {
     RigidBody::angularDamping = angularDamping;
 }
 
+real RigidBody::getLinearDamping() const {
+    return linearDamping;
+}
+
+real RigidBody::getAngularDamping() const {
+    return angularDamping;
+}
+
 void RigidBody::setPosition(const Vector3& position) {
     RigidBody::position = position;
 }
@@ -242,6 +390,34 @@ void RigidBody::addVelocity(const Vector3& deltaVelocity) {
     velocity += deltaVelocity;
 }
 
+void RigidBody::setAccelaration(const Vector3& accelaration) {
+    RigidBody::accelaration = accelaration;
+}
+
+Vector3 RigidBody::getAccelaration() const {
+    return accelaration;
+}
+
+Vector3 RigidBody::getLastFrameAccelaration() const {
+    return lastFrameAccelaration;
+}
+
+void RigidBody::hashState(StateHash* hash) const {
+    hash->add(position);
+    hash->add(orientation);
+    hash->add(velocity);
+    hash->add(rotation);
+    hash->add(lastFrameAccelaration);
+}
+
+void RigidBody::setContinuous(bool continuous) {
+    RigidBody::continuous = continuous;
+}
+
+bool RigidBody::isContinuous() const {
+    return continuous;
+}
+
 void RigidBody::setRotation(const Vector3& rotation) {
     RigidBody::rotation = rotation;
 }
@@ -0,0 +1,499 @@
+#include <cyclone/body_set.h>
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+using namespace cyclone;
+
+unsigned RigidBodySet::add() {
+	return add(RigidBody());
+}
+
+unsigned RigidBodySet::add(const RigidBody& body) {
+	unsigned index = size();
+
+	positionX.push_back(0); positionY.push_back(0); positionZ.push_back(0);
+	velocityX.push_back(0); velocityY.push_back(0); velocityZ.push_back(0);
+	rotationX.push_back(0); rotationY.push_back(0); rotationZ.push_back(0);
+	orientationR.push_back(1); orientationI.push_back(0); orientationJ.push_back(0); orientationK.push_back(0);
+	forceX.push_back(0); forceY.push_back(0); forceZ.push_back(0);
+	torqueX.push_back(0); torqueY.push_back(0); torqueZ.push_back(0);
+	accelarationX.push_back(0); accelarationY.push_back(0); accelarationZ.push_back(0);
+	inverseMass.push_back(0);
+	for (auto& entry : inertiaWorld) entry.push_back(0);
+	linearDamping.push_back(0); angularDamping.push_back(0);
+	linearFactor.push_back(0); angularFactor.push_back(0);
+	inverseInertiaTensor.emplace_back();
+	transform.emplace_back();
+	lastFrameAccelaration.emplace_back();
+
+	load(index, body);
+	return index;
+}
+
+void RigidBodySet::load(unsigned index, const RigidBody& body) {
+	setInverseMass(index, body.getInverseMass());
+	setPosition(index, body.getPosition());
+	setOrientation(index, body.getOrientation());
+	setVelocity(index, body.getVelocity());
+	setRotation(index, body.getRotation());
+	setAccelaration(index, body.getAccelaration());
+	setDamping(index, body.getLinearDamping(), body.getAngularDamping());
+
+	Matrix3 tensor;
+	body.getInertiaTensor(&tensor);
+	setInertiaTensor(index, tensor);
+
+	forceX[index] = forceY[index] = forceZ[index] = 0;
+	torqueX[index] = torqueY[index] = torqueZ[index] = 0;
+	lastFrameAccelaration[index] = body.getLastFrameAccelaration();
+
+	calculateDerivedRange(index, index + 1);
+}
+
+void RigidBodySet::store(unsigned index, RigidBody* body) const {
+	body->setInverseMass(inverseMass[index]);
+	body->setPosition(getPosition(index));
+	body->setOrientation(getOrientation(index));
+	body->setVelocity(getVelocity(index));
+	body->setRotation(getRotation(index));
+	body->setAccelaration(Vector3(accelarationX[index], accelarationY[index], accelarationZ[index]));
+	body->setDamping(linearDamping[index], angularDamping[index]);
+	body->setInertiaTensor(inverseInertiaTensor[index]);
+	body->calculateDerivedData();
+}
+
+void RigidBodySet::reserve(unsigned count) {
+	for (auto* array : {
+		&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ,
+		&rotationX, &rotationY, &rotationZ, &orientationR, &orientationI, &orientationJ, &orientationK,
+		&forceX, &forceY, &forceZ, &torqueX, &torqueY, &torqueZ,
+		&accelarationX, &accelarationY, &accelarationZ, &inverseMass,
+		&linearDamping, &angularDamping, &linearFactor, &angularFactor }) {
+		array->reserve(count);
+	}
+	for (auto& entry : inertiaWorld) entry.reserve(count);
+	inverseInertiaTensor.reserve(count);
+	transform.reserve(count);
+	lastFrameAccelaration.reserve(count);
+}
+
+void RigidBodySet::clear() {
+	for (auto* array : {
+		&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ,
+		&rotationX, &rotationY, &rotationZ, &orientationR, &orientationI, &orientationJ, &orientationK,
+		&forceX, &forceY, &forceZ, &torqueX, &torqueY, &torqueZ,
+		&accelarationX, &accelarationY, &accelarationZ, &inverseMass,
+		&linearDamping, &angularDamping, &linearFactor, &angularFactor }) {
+		array->clear();
+	}
+	for (auto& entry : inertiaWorld) entry.clear();
+	inverseInertiaTensor.clear();
+	transform.clear();
+	lastFrameAccelaration.clear();
+	dampingChanged = true;
+}
+
+void RigidBodySet::prepareDamping(real duration) {
+	integrationContext.beginStep(duration);
+	if (duration == dampingDuration && !dampingChanged) return;
+
+	for (unsigned i = 0; i < size(); i++) {
+		linearFactor[i] = integrationContext.dampingFactor(linearDamping[i]);
+		angularFactor[i] = integrationContext.dampingFactor(angularDamping[i]);
+	}
+	dampingDuration = duration;
+	dampingChanged = false;
+}
+
+void RigidBodySet::integrate(real duration) {
+	prepareDamping(duration);
+	integrateRange(0, size(), duration);
+	calculateDerivedRange(0, size());
+	steps++;
+
+	if (!snapshots) return;
+	TransformState* states = snapshots->beginPublish(size());
+	if (states) publishRange(states, 0, size());
+	snapshots->endPublish(steps);
+}
+
+void RigidBodySet::integrate(real duration, ThreadPool& pool) {
+	prepareDamping(duration);
+
+	// the passes only touch their own bodies, so chunks are independent
+	TransformState* states = snapshots ? snapshots->beginPublish(size()) : nullptr;
+	pool.parallelFor(size(), 1024, [this, duration, states](unsigned begin, unsigned end) {
+		integrateRange(begin, end, duration);
+		calculateDerivedRange(begin, end);
+		if (states) publishRange(states, begin, end);
+	});
+	steps++;
+
+	if (snapshots) snapshots->endPublish(steps);
+}
+
+void RigidBodySet::setSnapshotBuffer(SnapshotBuffer* buffer) {
+	snapshots = buffer;
+}
+
+void RigidBodySet::publishRange(TransformState* states, unsigned begin, unsigned end) const {
+	for (unsigned i = begin; i < end; i++) {
+		TransformState& state = states[i];
+		state.position = Vector3(positionX[i], positionY[i], positionZ[i]);
+		state.orientation = Quaternion(orientationR[i], orientationI[i], orientationJ[i], orientationK[i]);
+		state.velocity = Vector3(velocityX[i], velocityY[i], velocityZ[i]);
+		state.rotation = Vector3(rotationX[i], rotationY[i], rotationZ[i]);
+	}
+}
+
+namespace {
+	using Scheme = IntegrationContext::IntegrationScheme;
+
+	/*
+	* one component of a linear step, see IntegrationContext::IntegrationScheme
+	* lastAcc is only read by velocity verlet
+	*/
+	template <Scheme scheme>
+	inline void advanceLinear(real& position, real& velocity, real acc, real lastAcc, real duration, real previousDuration, real factor) {
+		switch (scheme) {
+		case IntegrationContext::INTEGRATE_DEFAULT:
+		case IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER:
+			velocity = (velocity + acc * duration) * factor;
+			position += velocity * duration;
+			break;
+
+		case IntegrationContext::INTEGRATE_EXPLICIT_EULER:
+			position += velocity * duration;
+			velocity = (velocity + acc * duration) * factor;
+			break;
+
+		case IntegrationContext::INTEGRATE_POSITION_VERLET:
+			velocity = (velocity + acc * ((duration + previousDuration) * 0.5)) * factor;
+			position += velocity * duration;
+			break;
+
+		case IntegrationContext::INTEGRATE_VELOCITY_VERLET:
+			velocity += (acc - lastAcc) * (previousDuration * 0.5);
+			position += velocity * duration + acc * (duration * duration * 0.5);
+			velocity = (velocity + acc * duration) * factor;
+			break;
+		}
+	}
+}
+
+void RigidBodySet::integrateRange(unsigned begin, unsigned end, real duration) {
+	switch (integrationContext.getScheme()) {
+	case IntegrationContext::INTEGRATE_DEFAULT:
+		integrateLinear<IntegrationContext::INTEGRATE_DEFAULT>(begin, end, duration);
+		break;
+	case IntegrationContext::INTEGRATE_EXPLICIT_EULER:
+		integrateLinear<IntegrationContext::INTEGRATE_EXPLICIT_EULER>(begin, end, duration);
+		break;
+	case IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER:
+		integrateLinear<IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER>(begin, end, duration);
+		break;
+	case IntegrationContext::INTEGRATE_POSITION_VERLET:
+		integrateLinear<IntegrationContext::INTEGRATE_POSITION_VERLET>(begin, end, duration);
+		break;
+	case IntegrationContext::INTEGRATE_VELOCITY_VERLET:
+		integrateLinear<IntegrationContext::INTEGRATE_VELOCITY_VERLET>(begin, end, duration);
+		break;
+	}
+
+	integrateAngular(begin, end, duration);
+
+	// the acceleration the resolver sees, then clear the accumulators
+	const real* im = inverseMass.data();
+	for (unsigned i = begin; i < end; i++) {
+		if (im[i] > 0) {
+			lastFrameAccelaration[i] = Vector3(accelarationX[i] + forceX[i] * im[i], accelarationY[i] + forceY[i] * im[i], accelarationZ[i] + forceZ[i] * im[i]);
+		}
+		forceX[i] = forceY[i] = forceZ[i] = 0;
+		torqueX[i] = torqueY[i] = torqueZ[i] = 0;
+	}
+}
+
+template <IntegrationContext::IntegrationScheme scheme>
+void RigidBodySet::integrateLinear(unsigned begin, unsigned end, real duration) {
+	real* __restrict px = positionX.data();
+	real* __restrict py = positionY.data();
+	real* __restrict pz = positionZ.data();
+	real* __restrict vx = velocityX.data();
+	real* __restrict vy = velocityY.data();
+	real* __restrict vz = velocityZ.data();
+	const real* __restrict fx = forceX.data();
+	const real* __restrict fy = forceY.data();
+	const real* __restrict fz = forceZ.data();
+	const real* __restrict ax = accelarationX.data();
+	const real* __restrict ay = accelarationY.data();
+	const real* __restrict az = accelarationZ.data();
+	const real* __restrict im = inverseMass.data();
+	const real* __restrict linear = linearFactor.data();
+	const Vector3* last = lastFrameAccelaration.data();
+	real previousDuration = integrationContext.getPreviousDuration();
+
+	// immovable bodies keep their state
+	for (unsigned i = begin; i < end; i++) {
+		bool moving = im[i] > 0;
+
+		real accX = ax[i] + fx[i] * im[i];
+		real accY = ay[i] + fy[i] * im[i];
+		real accZ = az[i] + fz[i] * im[i];
+
+		real newPX = px[i], newPY = py[i], newPZ = pz[i];
+		real newVX = vx[i], newVY = vy[i], newVZ = vz[i];
+		real lastX = 0, lastY = 0, lastZ = 0;
+		if (scheme == IntegrationContext::INTEGRATE_VELOCITY_VERLET) {
+			lastX = last[i].x;
+			lastY = last[i].y;
+			lastZ = last[i].z;
+		}
+
+		advanceLinear<scheme>(newPX, newVX, accX, lastX, duration, previousDuration, linear[i]);
+		advanceLinear<scheme>(newPY, newVY, accY, lastY, duration, previousDuration, linear[i]);
+		advanceLinear<scheme>(newPZ, newVZ, accZ, lastZ, duration, previousDuration, linear[i]);
+
+		vx[i] = moving ? newVX : vx[i];
+		vy[i] = moving ? newVY : vy[i];
+		vz[i] = moving ? newVZ : vz[i];
+		px[i] = moving ? newPX : px[i];
+		py[i] = moving ? newPY : py[i];
+		pz[i] = moving ? newPZ : pz[i];
+	}
+}
+
+void RigidBodySet::integrateAngular(unsigned begin, unsigned end, real duration) {
+	real* __restrict wx = rotationX.data();
+	real* __restrict wy = rotationY.data();
+	real* __restrict wz = rotationZ.data();
+	real* __restrict qr = orientationR.data();
+	real* __restrict qi = orientationI.data();
+	real* __restrict qj = orientationJ.data();
+	real* __restrict qk = orientationK.data();
+	const real* __restrict tx = torqueX.data();
+	const real* __restrict ty = torqueY.data();
+	const real* __restrict tz = torqueZ.data();
+	const real* __restrict im = inverseMass.data();
+	const real* __restrict angular = angularFactor.data();
+	const real* __restrict m0 = inertiaWorld[0].data();
+	const real* __restrict m1 = inertiaWorld[1].data();
+	const real* __restrict m2 = inertiaWorld[2].data();
+	const real* __restrict m3 = inertiaWorld[3].data();
+	const real* __restrict m4 = inertiaWorld[4].data();
+	const real* __restrict m5 = inertiaWorld[5].data();
+	const real* __restrict m6 = inertiaWorld[6].data();
+	const real* __restrict m7 = inertiaWorld[7].data();
+	const real* __restrict m8 = inertiaWorld[8].data();
+	bool exact = integrationContext.getRotationScheme() == IntegrationContext::ROTATE_EXACT;
+
+	for (unsigned i = begin; i < end; i++) {
+		bool moving = im[i] > 0;
+
+		real alphaX = m0[i] * tx[i] + m1[i] * ty[i] + m2[i] * tz[i];
+		real alphaY = m3[i] * tx[i] + m4[i] * ty[i] + m5[i] * tz[i];
+		real alphaZ = m6[i] * tx[i] + m7[i] * ty[i] + m8[i] * tz[i];
+
+		real newWX = (wx[i] + alphaX * duration) * angular[i];
+		real newWY = (wy[i] + alphaY * duration) * angular[i];
+		real newWZ = (wz[i] + alphaZ * duration) * angular[i];
+
+		// linear: q += 0.5 * (0, w * duration) * q
+		// exact: q = (cos(a / 2), sin(a / 2) * w / |w|) * q with a = |w| * duration
+		real sr = 0, scale = duration * 0.5;
+		if (exact) {
+			real speed = std::sqrt(newWX * newWX + newWY * newWY + newWZ * newWZ);
+			real halfAngle = speed * duration * 0.5;
+			sr = std::cos(halfAngle) - 1;
+			scale = speed > 0 ? std::sin(halfAngle) / speed : scale;
+		}
+
+		real sx = newWX * scale, sy = newWY * scale, sz = newWZ * scale;
+		real r = qr[i], qI = qi[i], qJ = qj[i], qK = qk[i];
+		real dr = sr * r - sx * qI - sy * qJ - sz * qK;
+		real di = sr * qI + sx * r + sy * qK - sz * qJ;
+		real dj = sr * qJ + sy * r + sz * qI - sx * qK;
+		real dk = sr * qK + sz * r + sx * qJ - sy * qI;
+
+		wx[i] = moving ? newWX : wx[i];
+		wy[i] = moving ? newWY : wy[i];
+		wz[i] = moving ? newWZ : wz[i];
+		qr[i] = moving ? r + dr : r;
+		qi[i] = moving ? qI + di : qI;
+		qj[i] = moving ? qJ + dj : qJ;
+		qk[i] = moving ? qK + dk : qK;
+	}
+}
+
+void RigidBodySet::calculateDerivedData() {
+	calculateDerivedRange(0, size());
+}
+
+void RigidBodySet::calculateDerivedRange(unsigned begin, unsigned end) {
+	real* __restrict qr = orientationR.data();
+	real* __restrict qi = orientationI.data();
+	real* __restrict qj = orientationJ.data();
+	real* __restrict qk = orientationK.data();
+
+	for (unsigned i = begin; i < end; i++) {
+		real d = qr[i] * qr[i] + qi[i] * qi[i] + qj[i] * qj[i] + qk[i] * qk[i];
+		if (d == 0) {
+			qr[i] = 1;
+			continue;
+		}
+		d = 1.0 / std::sqrt(d);
+		qr[i] *= d; qi[i] *= d; qj[i] *= d; qk[i] *= d;
+	}
+
+	for (unsigned i = begin; i < end; i++) {
+		real r = qr[i], x = qi[i], y = qj[i], z = qk[i];
+		real rot[9] = {
+			1 - (2 * y * y + 2 * z * z), 2 * x * y - 2 * z * r, 2 * x * z + 2 * y * r,
+			2 * x * y + 2 * z * r, 1 - (2 * x * x + 2 * z * z), 2 * y * z - 2 * x * r,
+			2 * x * z - 2 * y * r, 2 * y * z + 2 * x * r, 1 - (2 * x * x + 2 * y * y)
+		};
+
+		Matrix4& t = transform[i];
+		t.data[0] = rot[0]; t.data[1] = rot[1]; t.data[2] = rot[2]; t.data[3] = positionX[i];
+		t.data[4] = rot[3]; t.data[5] = rot[4]; t.data[6] = rot[5]; t.data[7] = positionY[i];
+		t.data[8] = rot[6]; t.data[9] = rot[7]; t.data[10] = rot[8]; t.data[11] = positionZ[i];
+
+		// world tensor = rot * local tensor * rot transposed
+		const real* local = inverseInertiaTensor[i].data;
+		real m[9];
+		for (unsigned row = 0; row < 3; row++) {
+			for (unsigned col = 0; col < 3; col++) {
+				m[row * 3 + col] = rot[row * 3] * local[col] + rot[row * 3 + 1] * local[3 + col] + rot[row * 3 + 2] * local[6 + col];
+			}
+		}
+		for (unsigned row = 0; row < 3; row++) {
+			for (unsigned col = 0; col < 3; col++) {
+				inertiaWorld[row * 3 + col][i] = m[row * 3] * rot[col * 3] + m[row * 3 + 1] * rot[col * 3 + 1] + m[row * 3 + 2] * rot[col * 3 + 2];
+			}
+		}
+	}
+}
+
+void RigidBodySet::clearAccumulators() {
+	std::fill(forceX.begin(), forceX.end(), 0);
+	std::fill(forceY.begin(), forceY.end(), 0);
+	std::fill(forceZ.begin(), forceZ.end(), 0);
+	std::fill(torqueX.begin(), torqueX.end(), 0);
+	std::fill(torqueY.begin(), torqueY.end(), 0);
+	std::fill(torqueZ.begin(), torqueZ.end(), 0);
+}
+
+/*
+ * ============================================================================
+ * ACCESSORS (GETTERS/SETTERS)
+ * ============================================================================
+ */
+
+void RigidBodySet::addForce(unsigned index, const Vector3& force) {
+	forceX[index] += force.x;
+	forceY[index] += force.y;
+	forceZ[index] += force.z;
+}
+
+void RigidBodySet::addForceAtPoint(unsigned index, const Vector3& force, const Vector3& point) {
+	addForce(index, force);
+	addTorque(index, (point - getPosition(index)) ^ force);
+}
+
+void RigidBodySet::addTorque(unsigned index, const Vector3& torque) {
+	torqueX[index] += torque.x;
+	torqueY[index] += torque.y;
+	torqueZ[index] += torque.z;
+}
+
+void RigidBodySet::setMass(unsigned index, real mass) {
+	assert(mass != 0);
+	inverseMass[index] = 1.0 / mass;
+}
+
+void RigidBodySet::setInverseMass(unsigned index, real value) {
+	inverseMass[index] = value;
+}
+
+real RigidBodySet::getInverseMass(unsigned index) const {
+	return inverseMass[index];
+}
+
+void RigidBodySet::setInertiaTensor(unsigned index, const Matrix3& tensor) {
+	inverseInertiaTensor[index] = tensor;
+}
+
+void RigidBodySet::getInertiaTensorWorld(unsigned index, Matrix3* tensor) const {
+	for (unsigned i = 0; i < 9; i++) tensor->data[i] = inertiaWorld[i][index];
+}
+
+void RigidBodySet::setDamping(unsigned index, real linear, real angular) {
+	linearDamping[index] = linear;
+	angularDamping[index] = angular;
+	dampingChanged = true;
+}
+
+void RigidBodySet::setPosition(unsigned index, const Vector3& position) {
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+}
+
+Vector3 RigidBodySet::getPosition(unsigned index) const {
+	return Vector3(positionX[index], positionY[index], positionZ[index]);
+}
+
+void RigidBodySet::setOrientation(unsigned index, const Quaternion& orientation) {
+	Quaternion q = orientation;
+	q.normalize();
+	orientationR[index] = q.r;
+	orientationI[index] = q.i;
+	orientationJ[index] = q.j;
+	orientationK[index] = q.k;
+}
+
+Quaternion RigidBodySet::getOrientation(unsigned index) const {
+	return Quaternion(orientationR[index], orientationI[index], orientationJ[index], orientationK[index]);
+}
+
+void RigidBodySet::setVelocity(unsigned index, const Vector3& velocity) {
+	velocityX[index] = velocity.x;
+	velocityY[index] = velocity.y;
+	velocityZ[index] = velocity.z;
+}
+
+Vector3 RigidBodySet::getVelocity(unsigned index) const {
+	return Vector3(velocityX[index], velocityY[index], velocityZ[index]);
+}
+
+void RigidBodySet::setRotation(unsigned index, const Vector3& rotation) {
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+}
+
+Vector3 RigidBodySet::getRotation(unsigned index) const {
+	return Vector3(rotationX[index], rotationY[index], rotationZ[index]);
+}
+
+void RigidBodySet::setAccelaration(unsigned index, const Vector3& accelaration) {
+	accelarationX[index] = accelaration.x;
+	accelarationY[index] = accelaration.y;
+	accelarationZ[index] = accelaration.z;
+}
+
+Vector3 RigidBodySet::getLastFrameAccelaration(unsigned index) const {
+	return lastFrameAccelaration[index];
+}
+
+uint64_t RigidBodySet::stateHash() const {
+	StateHash hash;
+	for (unsigned i = 0; i < size(); i++) {
+		hash.add(Vector3(positionX[i], positionY[i], positionZ[i]));
+		hash.add(Quaternion(orientationR[i], orientationI[i], orientationJ[i], orientationK[i]));
+		hash.add(Vector3(velocityX[i], velocityY[i], velocityZ[i]));
+		hash.add(Vector3(rotationX[i], rotationY[i], rotationZ[i]));
+		hash.add(lastFrameAccelaration[i]);
+	}
+	return hash.get();
+}
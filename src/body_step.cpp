@@ -0,0 +1,90 @@
+#include <cyclone/body_step.h>
+
+using namespace cyclone;
+
+RigidBodyStep::RigidBodyStep(std::vector<RigidBody*>& bodies, std::vector<CollisionPrimitive*>& primitives,
+	ForceRegistry& forces, CollisionBroadPhase& broadPhase, ContactResolver& resolver, unsigned maxContacts) :
+	bodies(bodies), primitives(primitives), forces(forces), broadPhase(broadPhase), resolver(resolver),
+	dispatcher(&CollisionDispatcher::standard()), contactBuffer(maxContacts) {
+	contactBuffer.setGrowable(true);
+	data.friction = (real)0.5;
+	data.restitution = 0;
+}
+
+void RigidBodyStep::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+void RigidBodyStep::setDispatcher(const CollisionDispatcher* dispatcher) {
+	this->dispatcher = dispatcher;
+}
+
+void RigidBodyStep::setContactMaterial(real friction, real restitution) {
+	data.friction = friction;
+	data.restitution = restitution;
+}
+
+ContactBuffer<Contact>& RigidBodyStep::getContactBuffer() {
+	return contactBuffer;
+}
+
+unsigned RigidBodyStep::getContactCount() const {
+	return contactCount;
+}
+
+void RigidBodyStep::updatePrimitives() {
+	parallelFor(pool, (unsigned)primitives.size(), 256, [this](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) primitives[i]->calculateInternals();
+	});
+}
+
+void RigidBodyStep::findPairs(real duration) {
+	broadPhase.findPairs(pairs, duration);
+}
+
+void RigidBodyStep::resolveContacts(real duration) {
+	data.reset(&contactBuffer);
+	dispatcher->collide(pairs.data(), (unsigned)pairs.size(), duration, &data);
+	contactCount = data.contactCount;
+
+	if (contactCount > 0) resolver.resolveContacts(data.contactArray, contactCount, duration);
+	contactBuffer.endFrame(contactCount);
+}
+
+void RigidBodyStep::integrate(real duration) {
+	// each body only touches its own state
+	parallelFor(pool, (unsigned)bodies.size(), 256, [this, duration](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) bodies[i]->integrate(duration);
+	});
+}
+
+void RigidBodyStep::step(real duration) {
+	forces.updateForces(duration);
+	updatePrimitives();
+	findPairs(duration);
+	resolveContacts(duration);
+	integrate(duration);
+}
+
+void RigidBodyStep::addStepTasks(TaskGraph& graph) {
+	graph.add([this](real duration) { forces.updateForces(duration); },
+		RESOURCE_BODIES, RESOURCE_BODY_FORCES);
+
+	graph.add([this](real) { updatePrimitives(); },
+		RESOURCE_BODIES, RESOURCE_PRIMITIVES);
+
+	graph.add([this](real duration) { findPairs(duration); },
+		RESOURCE_PRIMITIVES | RESOURCE_BODIES, RESOURCE_BROADPHASE);
+
+	graph.add([this](real duration) { resolveContacts(duration); },
+		RESOURCE_PRIMITIVES | RESOURCE_BROADPHASE, RESOURCE_BODIES | RESOURCE_CONTACTS);
+
+	graph.add([this](real duration) { integrate(duration); },
+		RESOURCE_BODY_FORCES, RESOURCE_BODIES | RESOURCE_BODY_FORCES);
+}
+
+uint64_t RigidBodyStep::stateHash() const {
+	StateHash hash;
+	for (const RigidBody* body : bodies) body->hashState(&hash);
+	return hash.get();
+}
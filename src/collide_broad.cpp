@@ -0,0 +1,120 @@
+#include <cyclone/collide_broad.h>
+#include <algorithm>
+
+using namespace cyclone;
+
+void CollisionBroadPhase::addStatic(const CollisionSphere* sphere) {
+    addStatic(sphere, BoundingBox::of(*sphere));
+}
+
+void CollisionBroadPhase::addStatic(const CollisionBox* box) {
+    addStatic(box, BoundingBox::of(*box));
+}
+
+void CollisionBroadPhase::addStatic(const CollisionPrimitive* primitive, const BoundingBox& bounds) {
+    statics.push_back(primitive);
+    staticBounds.push_back(bounds);
+    staticsBuilt = false;
+}
+
+void CollisionBroadPhase::addMoving(const CollisionSphere* sphere) {
+    moving.push_back(Shape{ sphere, SPHERE });
+}
+
+void CollisionBroadPhase::addMoving(const CollisionBox* box) {
+    moving.push_back(Shape{ box, BOX });
+}
+
+void CollisionBroadPhase::clear() {
+    statics.clear();
+    staticBounds.clear();
+    staticTree.clear();
+    staticsBuilt = false;
+
+    moving.clear();
+    movingBounds.clear();
+    sweepOrder.clear();
+}
+
+void CollisionBroadPhase::setMargin(real margin) {
+    this->margin = margin;
+}
+
+void CollisionBroadPhase::updateMovingBounds(real duration) {
+    unsigned count = (unsigned)moving.size();
+    movingBounds.resize(count);
+
+    Vector3 grow(margin, margin, margin);
+    for (unsigned i = 0; i < count; i++) {
+        const Shape& shape = moving[i];
+        BoundingBox box = shape.kind == SPHERE
+            ? BoundingBox::of(*static_cast<const CollisionSphere*>(shape.primitive))
+            : BoundingBox::of(*static_cast<const CollisionBox*>(shape.primitive));
+        box.min -= grow;
+        box.max += grow;
+
+        // cover the path of a continuous body over the step
+        const RigidBody* body = shape.primitive->body;
+        if (duration > 0 && body && body->isContinuous()) {
+            Vector3 motion = body->getVelocity() * duration;
+            Vector3 back(std::min(motion.x, (real)0), std::min(motion.y, (real)0), std::min(motion.z, (real)0));
+            box.min += back;
+            box.max += motion - back;
+        }
+        movingBounds[i] = box;
+    }
+}
+
+unsigned CollisionBroadPhase::findPairs(std::vector<PrimitivePair>& pairs, real duration) {
+    pairs.clear();
+
+    // the static tree is only built when the level geometry changed
+    if (!staticsBuilt) {
+        staticTree.clear();
+        if (!statics.empty()) staticTree.build(staticBounds.data(), (unsigned)statics.size());
+        staticsBuilt = true;
+    }
+
+    updateMovingBounds(duration);
+    unsigned count = (unsigned)moving.size();
+
+    // dynamic against static, kinematic bodies pass through level geometry
+    for (unsigned i = 0; i < count; i++) {
+        const CollisionPrimitive* primitive = moving[i].primitive;
+        if (!primitive->isDynamic()) continue;
+
+        staticTree.overlap(movingBounds[i], [&](unsigned item) {
+            const CollisionPrimitive* other = statics[item];
+            if (primitive->canCollideWith(*other)) pairs.push_back(PrimitivePair{ primitive, other });
+        });
+    }
+
+    // moving against moving, sorted by minimum x and swept
+    sweepOrder.resize(count);
+    for (unsigned i = 0; i < count; i++) sweepOrder[i] = i;
+    std::sort(sweepOrder.begin(), sweepOrder.end(), [this](unsigned a, unsigned b) {
+        real ax = movingBounds[a].min.x;
+        real bx = movingBounds[b].min.x;
+        return ax < bx || (ax == bx && a < b);
+    });
+
+    for (unsigned i = 0; i < count; i++) {
+        const BoundingBox& box = movingBounds[sweepOrder[i]];
+        const CollisionPrimitive* one = moving[sweepOrder[i]].primitive;
+
+        for (unsigned j = i + 1; j < count; j++) {
+            const BoundingBox& otherBox = movingBounds[sweepOrder[j]];
+            if (otherBox.min.x > box.max.x) break;
+
+            const CollisionPrimitive* two = moving[sweepOrder[j]].primitive;
+            if (one->body == two->body) continue;
+            if (!one->isDynamic() && !two->isDynamic()) continue;
+            if (!box.overlaps(otherBox) || !one->canCollideWith(*two)) continue;
+
+            if (one->isDynamic()) pairs.push_back(PrimitivePair{ one, two });
+            else pairs.push_back(PrimitivePair{ two, one });
+        }
+    }
+
+    return (unsigned)pairs.size();
+}
@@ -0,0 +1,392 @@
+#include <cyclone/collide_ccd.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace cyclone;
+
+/*
+* gap at which conservative advancement reports the shapes as touching
+* and the cap on its iterations (grazing motion converges slowly)
+*/
+static const real sweepTolerance = (real)0.001;
+static const unsigned maxAdvancementSteps = 32;
+
+static inline Vector3 primitivePosition(const CollisionPrimitive& primitive) {
+    return Vector3(primitive.getTransform().data[3], primitive.getTransform().data[7], primitive.getTransform().data[11]);
+}
+
+/*
+* rotates a vector about a unit axis (rodrigues formula)
+*/
+static inline Vector3 rotateAbout(const Vector3& v, const Vector3& axis, real angle) {
+    real c = std::cos(angle);
+    real s = std::sin(angle);
+    return v * c + (axis ^ v) * s + axis * ((axis * v) * (1 - c));
+}
+
+/*
+* a box frozen at some point along its motion
+* the sweeps work on these instead of rebuilding CollisionBox transforms
+*/
+struct BoxPose {
+    Vector3 centre;
+    Vector3 axis[3];
+    Vector3 halfSize;
+
+    real projectOnto(const Vector3& direction) const {
+        return halfSize.x * std::abs(direction * axis[0]) +
+            halfSize.y * std::abs(direction * axis[1]) +
+            halfSize.z * std::abs(direction * axis[2]);
+    }
+
+    // the vertex furthest along the given direction
+    Vector3 support(const Vector3& direction) const {
+        Vector3 result = centre;
+        result.addScaledVector(axis[0], (axis[0] * direction) > 0 ? halfSize.x : -halfSize.x);
+        result.addScaledVector(axis[1], (axis[1] * direction) > 0 ? halfSize.y : -halfSize.y);
+        result.addScaledVector(axis[2], (axis[2] * direction) > 0 ? halfSize.z : -halfSize.z);
+        return result;
+    }
+};
+
+/*
+* describes how a box moves over the step, and the fastest any of
+* its points can move towards something (used to bound the advancement)
+*/
+struct BoxMotion {
+    const CollisionBox* box;
+    Vector3 pivot;
+    Vector3 motion;
+    Vector3 rotationAxis;
+    real angle;
+    real radius;
+
+    BoxMotion(const CollisionBox& box, const Vector3& motion, const Vector3& rotation)
+        : box(&box), motion(motion), rotationAxis(rotation) {
+        pivot = box.body ? box.body->getPosition() : primitivePosition(box);
+        angle = rotationAxis.magnitude();
+        if (angle > 0) rotationAxis *= (1 / angle);
+        radius = (primitivePosition(box) - pivot).magnitude() + box.halfSize.magnitude();
+    }
+
+    BoxPose at(real t) const {
+        BoxPose pose;
+        pose.halfSize = box->halfSize;
+        Vector3 arm = primitivePosition(*box) - pivot;
+        if (angle > 0) {
+            real a = angle * t;
+            pose.centre = pivot + motion * t + rotateAbout(arm, rotationAxis, a);
+            for (unsigned i = 0; i < 3; i++) pose.axis[i] = rotateAbout(box->getAxis(i), rotationAxis, a);
+        }
+        else {
+            pose.centre = pivot + motion * t + arm;
+            for (unsigned i = 0; i < 3; i++) pose.axis[i] = box->getAxis(i);
+        }
+        return pose;
+    }
+
+    // upper bound on the distance any point of the box travels over the whole motion
+    real sweepBound() const {
+        return motion.magnitude() + angle * radius;
+    }
+};
+
+/*
+* lower bound on the distance between two boxes: the largest gap along
+* any of the 15 separating axes; negative when they overlap.
+* normal is the axis with that gap, pointing from two towards one
+*/
+static real boxSeparation(const BoxPose& one, const BoxPose& two, Vector3* normal) {
+    Vector3 toCentre = two.centre - one.centre;
+    real best = -DBL_MAX;
+
+    auto tryAxis = [&](Vector3 axis) {
+        if (axis.squareMagnitude() < 0.0001) return;
+        axis.normalize();
+        real gap = std::abs(toCentre * axis) - one.projectOnto(axis) - two.projectOnto(axis);
+        if (gap > best) {
+            best = gap;
+            *normal = (axis * toCentre) > 0 ? axis * -1 : axis;
+        }
+    };
+
+    for (unsigned i = 0; i < 3; i++) tryAxis(one.axis[i]);
+    for (unsigned i = 0; i < 3; i++) tryAxis(two.axis[i]);
+    for (unsigned i = 0; i < 3; i++) {
+        for (unsigned j = 0; j < 3; j++) tryAxis(one.axis[i] ^ two.axis[j]);
+    }
+    return best;
+}
+
+bool SweepTests::sphereAndHalfSpace(const CollisionSphere& sphere, const Vector3& motion,
+    const CollisionPlane& plane, SweepHit* hit) {
+    Vector3 centre = primitivePosition(sphere);
+
+    real distance = plane.direction * centre - plane.offset - sphere.radius;
+    real approach = plane.direction * motion;
+
+    real t;
+    if (distance <= 0) t = 0;
+    else if (approach >= 0 || distance > -approach) return false;
+    else t = distance / -approach;
+
+    hit->time = t;
+    hit->distance = std::max(distance, (real)0);
+    hit->normal = plane.direction;
+    hit->point = centre + motion * t - plane.direction * sphere.radius;
+    return true;
+}
+
+bool SweepTests::sphereAndSphere(const CollisionSphere& one, const Vector3& motionOne,
+    const CollisionSphere& two, const Vector3& motionTwo, SweepHit* hit) {
+    Vector3 centreOne = primitivePosition(one);
+    Vector3 centreTwo = primitivePosition(two);
+
+    // solve |s + m t| = r for the relative motion
+    Vector3 s = centreOne - centreTwo;
+    Vector3 m = motionOne - motionTwo;
+    real radius = one.radius + two.radius;
+
+    real a = m * m;
+    real b = s * m;
+    real c = s * s - radius * radius;
+
+    real t;
+    if (c <= 0) t = 0;
+    else {
+        if (b >= 0 || a <= 0) return false;
+        real discriminant = b * b - a * c;
+        if (discriminant < 0) return false;
+        t = (-b - std::sqrt(discriminant)) / a;
+        if (t > 1) return false;
+    }
+
+    Vector3 atOne = centreOne + motionOne * t;
+    Vector3 atTwo = centreTwo + motionTwo * t;
+    Vector3 normal = atOne - atTwo;
+    if (normal.squareMagnitude() <= 0) normal = m * -1;
+    normal.normalize();
+
+    hit->time = t;
+    hit->distance = std::max(s.magnitude() - radius, (real)0);
+    hit->normal = normal;
+    hit->point = atTwo + normal * two.radius;
+    return true;
+}
+
+bool SweepTests::sphereAndBox(const CollisionSphere& sphere, const Vector3& motion,
+    const CollisionBox& box, const Vector3& boxMotion, SweepHit* hit) {
+    const Matrix4& transform = box.getTransform();
+    const Vector3& h = box.halfSize;
+    real r = sphere.radius;
+
+    // relative motion in box coordinates, the box is held fixed
+    Vector3 start = transform.transformInverse(primitivePosition(sphere));
+    Vector3 m = transform.transformInverseDirection(motion - boxMotion);
+
+    auto gapAt = [&](real t, Vector3* closest, Vector3* centre) {
+        *centre = start + m * t;
+        *closest = Vector3(
+            std::clamp(centre->x, -h.x, h.x),
+            std::clamp(centre->y, -h.y, h.y),
+            std::clamp(centre->z, -h.z, h.z));
+        return (*centre - *closest).magnitude() - r;
+    };
+
+    Vector3 closest, centre;
+    real distance = gapAt(0, &closest, &centre);
+
+    real t = 0;
+    if (distance > sweepTolerance) {
+        // slab test against the box grown by the radius, it contains the rounded box
+        real entry = 0, exit = 1;
+        const real startAxis[3] = { start.x, start.y, start.z };
+        const real motionAxis[3] = { m.x, m.y, m.z };
+        const real halfAxis[3] = { h.x + r, h.y + r, h.z + r };
+        for (unsigned i = 0; i < 3; i++) {
+            if (std::abs(motionAxis[i]) < 1e-12) {
+                if (std::abs(startAxis[i]) > halfAxis[i]) return false;
+                continue;
+            }
+            real inverse = 1 / motionAxis[i];
+            real t0 = (-halfAxis[i] - startAxis[i]) * inverse;
+            real t1 = (halfAxis[i] - startAxis[i]) * inverse;
+            if (t0 > t1) std::swap(t0, t1);
+            entry = std::max(entry, t0);
+            exit = std::min(exit, t1);
+            if (entry > exit) return false;
+        }
+
+        // the corners are rounded, advance from the slab entry to the true surface
+        real speed = m.magnitude();
+        t = entry;
+        unsigned steps = 0;
+        real gap = gapAt(t, &closest, &centre);
+        while (gap > sweepTolerance) {
+            if (++steps > maxAdvancementSteps) return false;
+            t += gap / speed;
+            if (t > exit) return false;
+            gap = gapAt(t, &closest, &centre);
+        }
+    }
+
+    Vector3 localNormal = centre - closest;
+    if (localNormal.squareMagnitude() <= 0) localNormal = m * -1;
+    localNormal.normalize();
+
+    Vector3 boxOffset = boxMotion * t;
+    hit->time = t;
+    hit->distance = std::max(distance, (real)0);
+    hit->normal = transform.transformDirection(localNormal);
+    hit->point = transform.transform(closest) + boxOffset;
+    return true;
+}
+
+bool SweepTests::boxAndHalfSpace(const CollisionBox& box, const Vector3& motion, const Vector3& rotation,
+    const CollisionPlane& plane, SweepHit* hit) {
+    BoxMotion sweep(box, motion, rotation);
+
+    auto gapAt = [&](real t, BoxPose* pose) {
+        *pose = sweep.at(t);
+        return plane.direction * pose->centre - plane.offset - pose->projectOnto(plane.direction);
+    };
+
+    BoxPose pose;
+    real distance = gapAt(0, &pose);
+
+    /*
+    * conservative advancement: the gap can close no faster than the
+    * linear speed along the normal plus the spin times the box radius
+    */
+    real bound = std::abs(plane.direction * motion) + sweep.angle * sweep.radius;
+    real t = 0;
+    real gap = distance;
+    unsigned steps = 0;
+    while (gap > sweepTolerance) {
+        if (bound <= 0 || ++steps > maxAdvancementSteps) return false;
+        t += gap / bound;
+        if (t > 1) return false;
+        gap = gapAt(t, &pose);
+    }
+
+    hit->time = t;
+    hit->distance = std::max(distance, (real)0);
+    hit->normal = plane.direction;
+    hit->point = pose.support(plane.direction * -1);
+    return true;
+}
+
+bool SweepTests::boxAndBox(const CollisionBox& one, const Vector3& motionOne, const Vector3& rotationOne,
+    const CollisionBox& two, const Vector3& motionTwo, const Vector3& rotationTwo, SweepHit* hit) {
+    BoxMotion sweepOne(one, motionOne, rotationOne);
+    BoxMotion sweepTwo(two, motionTwo, rotationTwo);
+
+    // as the separation is only a lower bound, advancing by it never overshoots
+    real bound = (motionOne - motionTwo).magnitude() +
+        sweepOne.angle * sweepOne.radius + sweepTwo.angle * sweepTwo.radius;
+
+    Vector3 normal;
+    BoxPose poseOne = sweepOne.at(0), poseTwo = sweepTwo.at(0);
+    real distance = boxSeparation(poseOne, poseTwo, &normal);
+
+    real t = 0;
+    real gap = distance;
+    unsigned steps = 0;
+    while (gap > sweepTolerance) {
+        if (bound <= 0 || ++steps > maxAdvancementSteps) return false;
+        t += gap / bound;
+        if (t > 1) return false;
+        poseOne = sweepOne.at(t);
+        poseTwo = sweepTwo.at(t);
+        gap = boxSeparation(poseOne, poseTwo, &normal);
+    }
+
+    hit->time = t;
+    hit->distance = std::max(distance, (real)0);
+    hit->normal = normal;
+    hit->point = poseOne.support(normal * -1);
+    return true;
+}
+
+/*
+* continuous detection
+*/
+
+static inline bool isFast(const CollisionPrimitive& primitive) {
+    return primitive.body && primitive.body->isContinuous();
+}
+
+static inline Vector3 predictedMotion(const CollisionPrimitive& primitive, real duration) {
+    return primitive.body ? primitive.body->getVelocity() * duration : Vector3();
+}
+
+static inline Vector3 predictedRotation(const CollisionPrimitive& primitive, real duration) {
+    return primitive.body ? primitive.body->getRotation() * duration : Vector3();
+}
+
+/*
+* writes a speculative contact for the hit, penetration is minus the gap
+*/
+static unsigned addSpeculativeContact(const SweepHit& hit, const Vector3& normal,
+    RigidBody* one, RigidBody* two, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    Contact* contact = data->contacts;
+    contact->contactNormal = normal;
+    contact->contactPoint = hit.point;
+    contact->penetration = -hit.distance;
+    contact->setBodyData(one, two, data->friction, data->restitution);
+
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned ContinuousDetector::sphereAndHalfSpace(const CollisionSphere& sphere, const CollisionPlane& plane, real duration, CollisionData* data) {
+    unsigned found = CollisionDetector::sphereAndHalfSpace(sphere, plane, data);
+    if (found || !isFast(sphere)) return found;
+
+    SweepHit hit;
+    if (!SweepTests::sphereAndHalfSpace(sphere, predictedMotion(sphere, duration), plane, &hit)) return 0;
+    return addSpeculativeContact(hit, hit.normal, sphere.body, nullptr, data);
+}
+
+unsigned ContinuousDetector::sphereAndSphere(const CollisionSphere& one, const CollisionSphere& two, real duration, CollisionData* data) {
+    unsigned found = CollisionDetector::sphereAndSphere(one, two, data);
+    if (found || !(isFast(one) || isFast(two))) return found;
+
+    SweepHit hit;
+    if (!SweepTests::sphereAndSphere(one, predictedMotion(one, duration), two, predictedMotion(two, duration), &hit)) return 0;
+    return addSpeculativeContact(hit, hit.normal, one.body, two.body, data);
+}
+
+unsigned ContinuousDetector::boxAndHalfSpace(const CollisionBox& box, const CollisionPlane& plane, real duration, CollisionData* data) {
+    unsigned found = CollisionDetector::boxAndHalfSpace(box, plane, data);
+    if (found || !isFast(box)) return found;
+
+    SweepHit hit;
+    if (!SweepTests::boxAndHalfSpace(box, predictedMotion(box, duration), predictedRotation(box, duration), plane, &hit)) return 0;
+    return addSpeculativeContact(hit, hit.normal, box.body, nullptr, data);
+}
+
+unsigned ContinuousDetector::boxAndBox(const CollisionBox& one, const CollisionBox& two, real duration, CollisionData* data) {
+    unsigned found = CollisionDetector::boxAndBox(one, two, data);
+    if (found || !(isFast(one) || isFast(two))) return found;
+
+    SweepHit hit;
+    if (!SweepTests::boxAndBox(
+        one, predictedMotion(one, duration), predictedRotation(one, duration),
+        two, predictedMotion(two, duration), predictedRotation(two, duration), &hit)) return 0;
+    return addSpeculativeContact(hit, hit.normal, one.body, two.body, data);
+}
+
+unsigned ContinuousDetector::boxAndSphere(const CollisionBox& box, const CollisionSphere& sphere, real duration, CollisionData* data) {
+    unsigned found = CollisionDetector::boxAndSphere(box, sphere, data);
+    if (found || !(isFast(box) || isFast(sphere))) return found;
+
+    SweepHit hit;
+    if (!SweepTests::sphereAndBox(sphere, predictedMotion(sphere, duration), box, predictedMotion(box, duration), &hit)) return 0;
+
+    // the discrete test has the box first, its normal points from the sphere to the box
+    return addSpeculativeContact(hit, hit.normal * -1, box.body, sphere.body, data);
+}
@@ -0,0 +1,145 @@
+#include <cyclone/collide_coarse.h>
+#include <algorithm>
+
+using namespace cyclone;
+
+BoundingBox BoundingBox::of(const CollisionSphere& sphere) {
+    const Matrix4& transform = sphere.getTransform();
+    Vector3 centre(transform.data[3], transform.data[7], transform.data[11]);
+    Vector3 extent(sphere.radius, sphere.radius, sphere.radius);
+
+    BoundingBox box;
+    box.min = centre - extent;
+    box.max = centre + extent;
+    return box;
+}
+
+BoundingBox BoundingBox::of(const CollisionBox& collisionBox) {
+    const Matrix4& t = collisionBox.getTransform();
+    const Vector3& h = collisionBox.halfSize;
+    Vector3 centre(t.data[3], t.data[7], t.data[11]);
+
+    // project the oriented half sizes onto the world axes
+    Vector3 extent(
+        std::abs(t.data[0]) * h.x + std::abs(t.data[1]) * h.y + std::abs(t.data[2]) * h.z,
+        std::abs(t.data[4]) * h.x + std::abs(t.data[5]) * h.y + std::abs(t.data[6]) * h.z,
+        std::abs(t.data[8]) * h.x + std::abs(t.data[9]) * h.y + std::abs(t.data[10]) * h.z
+    );
+
+    BoundingBox box;
+    box.min = centre - extent;
+    box.max = centre + extent;
+    return box;
+}
+
+void BoundingVolumeTree::clear() {
+    nodes.clear();
+    leaves.clear();
+    items.clear();
+}
+
+void BoundingVolumeTree::setChildBounds(Node& node, unsigned slot, const BoundingBox& box) {
+    node.minX[slot] = box.min.x; node.minY[slot] = box.min.y; node.minZ[slot] = box.min.z;
+    node.maxX[slot] = box.max.x; node.maxY[slot] = box.max.y; node.maxZ[slot] = box.max.z;
+}
+
+BoundingBox BoundingVolumeTree::childBounds(const Node& node, unsigned slot) const {
+    BoundingBox box;
+    box.min = Vector3(node.minX[slot], node.minY[slot], node.minZ[slot]);
+    box.max = Vector3(node.maxX[slot], node.maxY[slot], node.maxZ[slot]);
+    return box;
+}
+
+BoundingBox BoundingVolumeTree::getBounds() const {
+    BoundingBox box = BoundingBox::empty();
+    if (nodes.empty()) return box;
+
+    box.enclose(childBounds(nodes[0], 0));
+    box.enclose(childBounds(nodes[0], 1));
+    return box;
+}
+
+void BoundingVolumeTree::build(const BoundingBox* bounds, unsigned count) {
+    clear();
+    if (count == 0) return;
+
+    items.resize(count);
+    centres.resize(count);
+    for (unsigned i = 0; i < count; i++) {
+        items[i] = i;
+        centres[i] = bounds[i].getCentre();
+    }
+
+    // a median split gives about count / maxLeafSize * 2 nodes
+    nodes.reserve(2 * (count / maxLeafSize + 1));
+    leaves.reserve(2 * (count / maxLeafSize + 1));
+
+    if (count <= maxLeafSize) {
+        // the root is always a node, the second slot holds an empty leaf
+        nodes.emplace_back();
+        leaves.push_back(Leaf{ 0, count });
+        leaves.push_back(Leaf{ count, 0 });
+        nodes[0].child[0] = ~0;
+        nodes[0].child[1] = ~1;
+        setChildBounds(nodes[0], 1, BoundingBox::empty());
+    }
+    else {
+        buildRange(bounds, 0, count, 0);
+    }
+
+    refit(bounds);
+}
+
+int BoundingVolumeTree::buildRange(const BoundingBox* bounds, unsigned first, unsigned count, unsigned depth) {
+    if (count <= maxLeafSize || depth + 1 >= maxDepth) {
+        leaves.push_back(Leaf{ first, count });
+        return ~(int)(leaves.size() - 1);
+    }
+
+    // children always come after their parent, refit relies on this
+    int index = (int)nodes.size();
+    nodes.emplace_back();
+
+    BoundingBox centreBounds = BoundingBox::empty();
+    for (unsigned i = first; i < first + count; i++) centreBounds.enclose(centres[items[i]]);
+
+    Vector3 extent = centreBounds.max - centreBounds.min;
+    unsigned axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > (axis == 0 ? extent.x : extent.y)) axis = 2;
+
+    auto key = [this, axis](unsigned item) {
+        const Vector3& c = centres[item];
+        return axis == 0 ? c.x : axis == 1 ? c.y : c.z;
+    };
+
+    unsigned half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+        [&key](unsigned a, unsigned b) { return key(a) < key(b); });
+
+    int left = buildRange(bounds, first, half, depth + 1);
+    int right = buildRange(bounds, first + half, count - half, depth + 1);
+    nodes[index].child[0] = left;
+    nodes[index].child[1] = right;
+    return index;
+}
+
+void BoundingVolumeTree::refit(const BoundingBox* bounds) {
+    // children are stored after their parents, so a reverse sweep is bottom up
+    for (size_t n = nodes.size(); n-- > 0;) {
+        Node& node = nodes[n];
+        for (unsigned slot = 0; slot < 2; slot++) {
+            int child = node.child[slot];
+            BoundingBox box = BoundingBox::empty();
+            if (child < 0) {
+                const Leaf& leaf = leaves[~child];
+                for (unsigned i = 0; i < leaf.count; i++) box.enclose(bounds[items[leaf.first + i]]);
+            }
+            else {
+                box.enclose(childBounds(nodes[child], 0));
+                box.enclose(childBounds(nodes[child], 1));
+            }
+            setChildBounds(node, slot, box);
+        }
+    }
+}
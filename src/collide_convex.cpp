@@ -0,0 +1,713 @@
+#include <cyclone/collide_convex.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace cyclone;
+
+static const unsigned maxGjkIterations = 64;
+static const unsigned maxEpaIterations = 64;
+static const real gjkTolerance = (real)1e-10;
+static const real epaTolerance = (real)1e-6;
+
+/*
+* polytope faces, shared by hull building and EPA
+* faces are wound so the normal points out of the polytope
+*/
+struct PolytopeFace {
+    unsigned index[3];
+    Vector3 normal;
+    real offset;
+    bool alive;
+};
+
+static PolytopeFace makeFace(const std::vector<Vector3>& points, unsigned a, unsigned b, unsigned c) {
+    PolytopeFace face;
+    face.index[0] = a;
+    face.index[1] = b;
+    face.index[2] = c;
+    face.normal = (points[b] - points[a]) ^ (points[c] - points[a]);
+    face.normal.normalize();
+    face.offset = face.normal * points[a];
+    face.alive = true;
+    return face;
+}
+
+/*
+* builds the starting tetrahedron, wound outwards from its centroid
+*/
+static void makeTetrahedron(const std::vector<Vector3>& points, const unsigned corner[4], std::vector<PolytopeFace>& faces) {
+    Vector3 centroid = (points[corner[0]] + points[corner[1]] + points[corner[2]] + points[corner[3]]) * 0.25;
+    static const unsigned faceCorners[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 1, 3, 2 }, { 2, 3, 0 } };
+
+    faces.clear();
+    for (auto& f : faceCorners) {
+        PolytopeFace face = makeFace(points, corner[f[0]], corner[f[1]], corner[f[2]]);
+        if (face.normal * centroid - face.offset > 0) {
+            face = makeFace(points, corner[f[0]], corner[f[2]], corner[f[1]]);
+        }
+        faces.push_back(face);
+    }
+}
+
+/*
+* adds a point outside the polytope: removes the faces it can see and
+* fans new faces from the horizon to it. returns false if nothing was visible
+*/
+static bool expandPolytope(const std::vector<Vector3>& points, unsigned point, real epsilon,
+    std::vector<PolytopeFace>& faces, std::vector<std::pair<unsigned, unsigned>>& edges) {
+    const Vector3& p = points[point];
+
+    edges.clear();
+    for (auto& face : faces) {
+        if (!face.alive || face.normal * p - face.offset <= epsilon) continue;
+        face.alive = false;
+        for (unsigned e = 0; e < 3; e++) {
+            edges.emplace_back(face.index[e], face.index[(e + 1) % 3]);
+        }
+    }
+    if (edges.empty()) return false;
+
+    // an edge shared by two visible faces appears once in each direction
+    size_t added = faces.size();
+    for (size_t i = 0; i < edges.size(); i++) {
+        bool shared = false;
+        for (size_t j = 0; j < edges.size(); j++) {
+            if (edges[j].first == edges[i].second && edges[j].second == edges[i].first) {
+                shared = true;
+                break;
+            }
+        }
+        if (!shared) faces.push_back(makeFace(points, edges[i].first, edges[i].second, point));
+    }
+
+    // compact dead faces once in a while so the lists stay short
+    if (faces.size() > 2 * added + 32) {
+        faces.erase(std::remove_if(faces.begin(), faces.end(), [](const PolytopeFace& f) { return !f.alive; }), faces.end());
+    }
+    return true;
+}
+
+void CollisionConvex::setVertices(const Vector3* points, unsigned count) {
+    vertices.assign(points, points + count);
+    neighbourStart.clear();
+    neighbours.clear();
+
+    boundingRadius = 0;
+    for (const Vector3& v : vertices) boundingRadius = std::max(boundingRadius, v.magnitude());
+
+    if (count < 4) return;
+
+    // initial tetrahedron from extreme points
+    unsigned corner[4] = { 0, 0, 0, 0 };
+    for (unsigned i = 1; i < count; i++) {
+        if (points[i].x < points[corner[0]].x) corner[0] = i;
+    }
+
+    real best = 0;
+    for (unsigned i = 0; i < count; i++) {
+        real d = (points[i] - points[corner[0]]).squareMagnitude();
+        if (d > best) { best = d; corner[1] = i; }
+    }
+    real scale = std::sqrt(best);
+    real epsilon = scale * (real)1e-9;
+
+    Vector3 line = points[corner[1]] - points[corner[0]];
+    best = 0;
+    for (unsigned i = 0; i < count; i++) {
+        real d = (line ^ (points[i] - points[corner[0]])).squareMagnitude();
+        if (d > best) { best = d; corner[2] = i; }
+    }
+
+    Vector3 planeNormal = line ^ (points[corner[2]] - points[corner[0]]);
+    planeNormal.normalize();
+    best = 0;
+    for (unsigned i = 0; i < count; i++) {
+        real d = std::abs(planeNormal * (points[i] - points[corner[0]]));
+        if (d > best) { best = d; corner[3] = i; }
+    }
+
+    // flat point sets have no volume to climb over, support falls back to a scan
+    if (scale <= 0 || best <= scale * (real)1e-6) return;
+
+    std::vector<PolytopeFace> faces;
+    std::vector<std::pair<unsigned, unsigned>> edges;
+    makeTetrahedron(vertices, corner, faces);
+
+    for (unsigned i = 0; i < count; i++) {
+        if (i == corner[0] || i == corner[1] || i == corner[2] || i == corner[3]) continue;
+        expandPolytope(vertices, i, epsilon, faces, edges);
+    }
+
+    // keep only the points on the hull, renumbered
+    std::vector<unsigned> remap(count, ~0u);
+    std::vector<Vector3> hull;
+    for (auto& face : faces) {
+        if (!face.alive) continue;
+        for (unsigned& index : face.index) {
+            if (remap[index] == ~0u) {
+                remap[index] = (unsigned)hull.size();
+                hull.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+
+    // unique undirected edges, then compressed rows of neighbours
+    edges.clear();
+    for (auto& face : faces) {
+        if (!face.alive) continue;
+        for (unsigned e = 0; e < 3; e++) {
+            unsigned a = face.index[e], b = face.index[(e + 1) % 3];
+            edges.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    unsigned hullCount = (unsigned)hull.size();
+    neighbourStart.assign(hullCount + 1, 0);
+    for (auto& edge : edges) {
+        neighbourStart[edge.first + 1]++;
+        neighbourStart[edge.second + 1]++;
+    }
+    for (unsigned i = 0; i < hullCount; i++) neighbourStart[i + 1] += neighbourStart[i];
+
+    neighbours.resize(neighbourStart[hullCount]);
+    std::vector<unsigned> fill(neighbourStart.begin(), neighbourStart.end() - 1);
+    for (auto& edge : edges) {
+        neighbours[fill[edge.first]++] = edge.second;
+        neighbours[fill[edge.second]++] = edge.first;
+    }
+
+    vertices.swap(hull);
+}
+
+unsigned CollisionConvex::supportIndex(const Vector3& direction, unsigned start) const {
+    unsigned count = (unsigned)vertices.size();
+    if (count == 0) return 0;
+
+    if (neighbours.empty()) {
+        unsigned bestIndex = 0;
+        real best = vertices[0] * direction;
+        for (unsigned i = 1; i < count; i++) {
+            real d = vertices[i] * direction;
+            if (d > best) { best = d; bestIndex = i; }
+        }
+        return bestIndex;
+    }
+
+    unsigned current = start < count ? start : 0;
+    real best = vertices[current] * direction;
+    for (;;) {
+        unsigned next = current;
+        for (unsigned n = neighbourStart[current]; n < neighbourStart[current + 1]; n++) {
+            real d = vertices[neighbours[n]] * direction;
+            if (d > best) { best = d; next = neighbours[n]; }
+        }
+        if (next == current) return current;
+        current = next;
+    }
+}
+
+Vector3 CollisionConvex::support(const Vector3& direction) const {
+    unsigned index = supportIndex(transform.transformInverseDirection(direction));
+    return transform.transform(vertices[index]);
+}
+
+/*
+* convex shape adapter
+*/
+
+ConvexShape::ConvexShape(const CollisionSphere& sphere) : primitive(&sphere), margin(sphere.radius), kind(POINT) {}
+
+ConvexShape::ConvexShape(const CollisionBox& box) : primitive(&box), margin(0), kind(BOX) {}
+
+ConvexShape::ConvexShape(const CollisionConvex& convex) : primitive(&convex), margin(0), kind(HULL) {}
+
+Vector3 ConvexShape::getCentre() const {
+    const Matrix4& t = primitive->getTransform();
+    return Vector3(t.data[3], t.data[7], t.data[11]);
+}
+
+Vector3 ConvexShape::vertex(unsigned index) const {
+    const Matrix4& t = primitive->getTransform();
+    switch (kind) {
+    case BOX: {
+        const Vector3& h = static_cast<const CollisionBox*>(primitive)->halfSize;
+        return t.transform(Vector3(index & 1 ? h.x : -h.x, index & 2 ? h.y : -h.y, index & 4 ? h.z : -h.z));
+    }
+    case HULL:
+        return t.transform(static_cast<const CollisionConvex*>(primitive)->getVertex(index));
+    default:
+        return getCentre();
+    }
+}
+
+Vector3 ConvexShape::support(const Vector3& direction, unsigned* index) const {
+    const Matrix4& t = primitive->getTransform();
+    switch (kind) {
+    case BOX: {
+        Vector3 local = t.transformInverseDirection(direction);
+        *index = (local.x > 0 ? 1 : 0) | (local.y > 0 ? 2 : 0) | (local.z > 0 ? 4 : 0);
+        return vertex(*index);
+    }
+    case HULL: {
+        const CollisionConvex* convex = static_cast<const CollisionConvex*>(primitive);
+        *index = convex->supportIndex(t.transformInverseDirection(direction), *index);
+        return t.transform(convex->getVertex(*index));
+    }
+    default:
+        *index = 0;
+        return getCentre();
+    }
+}
+
+/*
+* gjk simplex on the minkowski difference (one - two)
+*/
+struct SimplexVertex {
+    Vector3 w;
+    Vector3 a;
+    Vector3 b;
+    unsigned indexA;
+    unsigned indexB;
+};
+
+struct Simplex {
+    SimplexVertex vertex[4];
+    real weight[4];
+    unsigned count;
+
+    void keep(std::initializer_list<unsigned> which, std::initializer_list<real> weights) {
+        SimplexVertex kept[4];
+        unsigned n = 0;
+        for (unsigned i : which) kept[n++] = vertex[i];
+        n = 0;
+        for (real w : weights) weight[n++] = w;
+        for (unsigned i = 0; i < n; i++) vertex[i] = kept[i];
+        count = n;
+    }
+
+    Vector3 point() const {
+        Vector3 result;
+        for (unsigned i = 0; i < count; i++) result.addScaledVector(vertex[i].w, weight[i]);
+        return result;
+    }
+
+    void closestPoints(Vector3* pointA, Vector3* pointB) const {
+        *pointA = Vector3();
+        *pointB = Vector3();
+        for (unsigned i = 0; i < count; i++) {
+            pointA->addScaledVector(vertex[i].a, weight[i]);
+            pointB->addScaledVector(vertex[i].b, weight[i]);
+        }
+    }
+};
+
+/*
+* reduces the simplex to the feature closest to the origin
+* (region tests from Ericson, Real-Time Collision Detection)
+*/
+static void closestOnSegment(Simplex& s, unsigned i0, unsigned i1) {
+    Vector3 a = s.vertex[i0].w, b = s.vertex[i1].w;
+    Vector3 ab = b - a;
+    real length = ab * ab;
+    real t = length > 0 ? -(a * ab) / length : 0;
+    if (t <= 0) s.keep({ i0 }, { 1 });
+    else if (t >= 1) s.keep({ i1 }, { 1 });
+    else s.keep({ i0, i1 }, { 1 - t, t });
+}
+
+static void closestOnTriangle(Simplex& s, unsigned i0, unsigned i1, unsigned i2) {
+    Vector3 a = s.vertex[i0].w, b = s.vertex[i1].w, c = s.vertex[i2].w;
+    Vector3 ab = b - a, ac = c - a;
+
+    real d1 = -(ab * a), d2 = -(ac * a);
+    if (d1 <= 0 && d2 <= 0) { s.keep({ i0 }, { 1 }); return; }
+
+    real d3 = -(ab * b), d4 = -(ac * b);
+    if (d3 >= 0 && d4 <= d3) { s.keep({ i1 }, { 1 }); return; }
+
+    real vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        real v = d1 / (d1 - d3);
+        s.keep({ i0, i1 }, { 1 - v, v });
+        return;
+    }
+
+    real d5 = -(ab * c), d6 = -(ac * c);
+    if (d6 >= 0 && d5 <= d6) { s.keep({ i2 }, { 1 }); return; }
+
+    real vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        real w = d2 / (d2 - d6);
+        s.keep({ i0, i2 }, { 1 - w, w });
+        return;
+    }
+
+    real va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        real w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        s.keep({ i1, i2 }, { 1 - w, w });
+        return;
+    }
+
+    real total = va + vb + vc;
+    if (total <= 0) {
+        // degenerate triangle, settle for its longest edge
+        Vector3 bc = c - b;
+        if (ab.squareMagnitude() >= ac.squareMagnitude() && ab.squareMagnitude() >= bc.squareMagnitude()) closestOnSegment(s, i0, i1);
+        else if (ac.squareMagnitude() >= bc.squareMagnitude()) closestOnSegment(s, i0, i2);
+        else closestOnSegment(s, i1, i2);
+        return;
+    }
+    real v = vb / total, w = vc / total;
+    s.keep({ i0, i1, i2 }, { 1 - v - w, v, w });
+}
+
+/*
+* returns true if the origin is inside the tetrahedron
+*/
+static bool closestOnTetrahedron(Simplex& s) {
+    static const unsigned faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+
+    Vector3 p[4] = { s.vertex[0].w, s.vertex[1].w, s.vertex[2].w, s.vertex[3].w };
+    real volume = ((p[1] - p[0]) ^ (p[2] - p[0])) * (p[3] - p[0]);
+    bool flat = std::abs(volume) <= gjkTolerance * (p[1] - p[0]).squareMagnitude() * std::sqrt((p[2] - p[0]).squareMagnitude());
+
+    real bestDistance = DBL_MAX;
+    Simplex best = s;
+    bool outside = false;
+    for (auto& f : faces) {
+        Vector3 normal = (p[f[1]] - p[f[0]]) ^ (p[f[2]] - p[f[0]]);
+        real originSide = -(normal * p[f[0]]);
+        real oppositeSide = normal * (p[f[3]] - p[f[0]]);
+        if (!flat && originSide * oppositeSide >= 0) continue;
+
+        outside = true;
+        Simplex candidate = s;
+        closestOnTriangle(candidate, f[0], f[1], f[2]);
+        real distance = candidate.point().squareMagnitude();
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = candidate;
+        }
+    }
+
+    if (!outside) return true;
+    s = best;
+    return false;
+}
+
+/*
+* runs gjk on the core shapes. returns the distance between them
+* (zero when they overlap, in which case the simplex encloses the origin
+* or touches it)
+*/
+static real runGjk(const ConvexShape& one, const ConvexShape& two, GjkCache* cache, Simplex& simplex) {
+    unsigned hintA = 0, hintB = 0;
+    simplex.count = 0;
+
+    // rebuild last frame's simplex at the current poses
+    if (cache && cache->count > 0) {
+        for (unsigned i = 0; i < cache->count; i++) {
+            SimplexVertex& v = simplex.vertex[simplex.count];
+            v.indexA = cache->indexA[i];
+            v.indexB = cache->indexB[i];
+            v.a = one.vertex(v.indexA);
+            v.b = two.vertex(v.indexB);
+            v.w = v.a - v.b;
+
+            bool duplicate = false;
+            for (unsigned j = 0; j < simplex.count; j++) {
+                if ((simplex.vertex[j].w - v.w).squareMagnitude() <= gjkTolerance) duplicate = true;
+            }
+            if (!duplicate) simplex.count++;
+        }
+        hintA = cache->indexA[0];
+        hintB = cache->indexB[0];
+    }
+
+    if (simplex.count == 0) {
+        Vector3 direction = one.getCentre() - two.getCentre();
+        if (direction.squareMagnitude() <= 0) direction = Vector3(1, 0, 0);
+
+        SimplexVertex& v = simplex.vertex[0];
+        v.indexA = hintA; v.indexB = hintB;
+        v.a = one.support(direction * -1, &v.indexA);
+        v.b = two.support(direction, &v.indexB);
+        v.w = v.a - v.b;
+        simplex.count = 1;
+    }
+    for (unsigned i = 0; i < simplex.count; i++) simplex.weight[i] = simplex.count == 1 ? 1 : 0;
+
+    bool inside = false;
+    real distance = 0;
+    for (unsigned iteration = 0; iteration < maxGjkIterations; iteration++) {
+        switch (simplex.count) {
+        case 1: simplex.weight[0] = 1; break;
+        case 2: closestOnSegment(simplex, 0, 1); break;
+        case 3: closestOnTriangle(simplex, 0, 1, 2); break;
+        default: inside = closestOnTetrahedron(simplex); break;
+        }
+        if (inside) break;
+
+        Vector3 v = simplex.point();
+        real vv = v.squareMagnitude();
+        if (vv <= gjkTolerance * gjkTolerance) {
+            inside = true;
+            break;
+        }
+
+        // support of the difference in the direction of the origin
+        SimplexVertex w;
+        w.indexA = simplex.vertex[0].indexA;
+        w.indexB = simplex.vertex[0].indexB;
+        w.a = one.support(v * -1, &w.indexA);
+        w.b = two.support(v, &w.indexB);
+        w.w = w.a - w.b;
+
+        // no progress towards the origin, v is the closest point
+        bool duplicate = false;
+        for (unsigned i = 0; i < simplex.count; i++) {
+            if ((simplex.vertex[i].w - w.w).squareMagnitude() <= gjkTolerance * std::max(vv, (real)1)) duplicate = true;
+        }
+        if (duplicate || vv - v * w.w <= gjkTolerance * std::max(vv, (real)1)) {
+            distance = std::sqrt(vv);
+            break;
+        }
+
+        simplex.vertex[simplex.count++] = w;
+        distance = std::sqrt(vv);
+    }
+
+    if (cache) {
+        cache->count = simplex.count;
+        for (unsigned i = 0; i < simplex.count; i++) {
+            cache->indexA[i] = simplex.vertex[i].indexA;
+            cache->indexB[i] = simplex.vertex[i].indexB;
+        }
+    }
+    return inside ? 0 : distance;
+}
+
+/*
+* expanding polytope algorithm, run when the cores overlap
+* finds the smallest translation of one that separates it from two
+*/
+static bool runEpa(const ConvexShape& one, const ConvexShape& two, const Simplex& start,
+    Vector3* normal, real* depth, Vector3* pointA, Vector3* pointB) {
+    std::vector<Vector3> points;
+    std::vector<SimplexVertex> support;
+    points.reserve(64);
+    support.reserve(64);
+
+    auto addSupport = [&](const Vector3& direction) {
+        SimplexVertex v;
+        v.indexA = support.empty() ? 0 : support.back().indexA;
+        v.indexB = support.empty() ? 0 : support.back().indexB;
+        v.a = one.support(direction, &v.indexA);
+        v.b = two.support(direction * -1, &v.indexB);
+        v.w = v.a - v.b;
+        for (const Vector3& p : points) {
+            if ((p - v.w).squareMagnitude() <= gjkTolerance) return false;
+        }
+        support.push_back(v);
+        points.push_back(v.w);
+        return true;
+    };
+
+    for (unsigned i = 0; i < start.count; i++) {
+        support.push_back(start.vertex[i]);
+        points.push_back(start.vertex[i].w);
+    }
+
+    // grow a touching simplex into a tetrahedron around the origin
+    static const Vector3 axes[6] = {
+        Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0), Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+    };
+    if (points.size() == 1) {
+        for (const Vector3& axis : axes) if (addSupport(axis)) break;
+    }
+    if (points.size() == 2) {
+        Vector3 line = points[1] - points[0];
+        for (const Vector3& axis : axes) {
+            Vector3 side = line ^ axis;
+            if (side.squareMagnitude() > gjkTolerance && (addSupport(side) || addSupport(side * -1))) break;
+        }
+    }
+    if (points.size() == 3) {
+        Vector3 faceNormal = (points[1] - points[0]) ^ (points[2] - points[0]);
+        if (!addSupport(faceNormal)) addSupport(faceNormal * -1);
+    }
+    if (points.size() < 4) return false;
+
+    unsigned corner[4] = { 0, 1, 2, 3 };
+    real volume = ((points[1] - points[0]) ^ (points[2] - points[0])) * (points[3] - points[0]);
+    if (std::abs(volume) <= gjkTolerance) return false;
+
+    std::vector<PolytopeFace> faces;
+    std::vector<std::pair<unsigned, unsigned>> edges;
+    makeTetrahedron(points, corner, faces);
+
+    PolytopeFace* closest = nullptr;
+    for (unsigned iteration = 0; iteration < maxEpaIterations; iteration++) {
+        closest = nullptr;
+        for (auto& face : faces) {
+            if (face.alive && (!closest || face.offset < closest->offset)) closest = &face;
+        }
+        if (!closest) return false;
+
+        PolytopeFace best = *closest;
+        if (!addSupport(best.normal)) break;
+
+        // converged when the new support barely moves the face
+        if (points.back() * best.normal - best.offset <= epaTolerance) break;
+
+        if (!expandPolytope(points, (unsigned)points.size() - 1, 0, faces, edges)) break;
+        closest = nullptr;
+    }
+    if (!closest) {
+        for (auto& face : faces) {
+            if (face.alive && (!closest || face.offset < closest->offset)) closest = &face;
+        }
+        if (!closest) return false;
+    }
+
+    // barycentric coordinates of the origin's projection onto the face
+    const PolytopeFace& face = *closest;
+    Vector3 projected = face.normal * face.offset;
+    Vector3 a = points[face.index[0]], b = points[face.index[1]], c = points[face.index[2]];
+    Vector3 v0 = b - a, v1 = c - a, v2 = projected - a;
+    real d00 = v0 * v0, d01 = v0 * v1, d11 = v1 * v1, d20 = v2 * v0, d21 = v2 * v1;
+    real denominator = d00 * d11 - d01 * d01;
+    real v = 0, w = 0;
+    if (std::abs(denominator) > 0) {
+        v = (d11 * d20 - d01 * d21) / denominator;
+        w = (d00 * d21 - d01 * d20) / denominator;
+    }
+    real u = 1 - v - w;
+
+    *pointA = support[face.index[0]].a * u + support[face.index[1]].a * v + support[face.index[2]].a * w;
+    *pointB = support[face.index[0]].b * u + support[face.index[1]].b * v + support[face.index[2]].b * w;
+    *normal = face.normal;
+    *depth = face.offset;
+    return true;
+}
+
+real ConvexDetector::distance(const ConvexShape& one, const ConvexShape& two,
+    Vector3* pointOne, Vector3* pointTwo, GjkCache* cache) {
+    Simplex simplex;
+    real coreDistance = runGjk(one, two, cache, simplex);
+    real margin = one.margin + two.margin;
+    if (coreDistance <= margin) return 0;
+
+    Vector3 a, b;
+    simplex.closestPoints(&a, &b);
+    Vector3 direction = (b - a) * (1 / coreDistance);
+    *pointOne = a + direction * one.margin;
+    *pointTwo = b - direction * two.margin;
+    return coreDistance - margin;
+}
+
+unsigned ConvexDetector::collide(const ConvexShape& one, const ConvexShape& two,
+    CollisionData* data, GjkCache* cache) {
+    if (data->contactsLeft <= 0) return 0;
+
+    Simplex simplex;
+    real coreDistance = runGjk(one, two, cache, simplex);
+    real margin = one.margin + two.margin;
+    if (coreDistance > margin) return 0;
+
+    Vector3 normal, pointA, pointB;
+    real penetration;
+    if (coreDistance > 0) {
+        // cores apart, only the margins overlap
+        simplex.closestPoints(&pointA, &pointB);
+        normal = (pointA - pointB) * (1 / coreDistance);
+        penetration = margin - coreDistance;
+    }
+    else {
+        Vector3 epaNormal;
+        real depth;
+        if (!runEpa(one, two, simplex, &epaNormal, &depth, &pointA, &pointB)) {
+            // exactly touching or degenerate, push apart along the centres
+            normal = one.getCentre() - two.getCentre();
+            if (normal.squareMagnitude() <= 0) normal = Vector3(0, 1, 0);
+            normal.normalize();
+            depth = 0;
+            simplex.closestPoints(&pointA, &pointB);
+        }
+        else {
+            // the face normal points out of one - two, one moves against it
+            normal = epaNormal * -1;
+        }
+        penetration = depth + margin;
+    }
+
+    Contact* contact = data->contacts;
+    contact->contactNormal = normal;
+    contact->penetration = penetration;
+
+    // halfway between the two surface points
+    Vector3 surfaceA = pointA - normal * one.margin;
+    Vector3 surfaceB = pointB + normal * two.margin;
+    contact->contactPoint = (surfaceA + surfaceB) * 0.5;
+
+    contact->setBodyData(one.primitive->body, two.primitive->body, data->friction, data->restitution);
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned ConvexDetector::convexAndHalfSpace(const CollisionConvex& convex, const CollisionPlane& plane, CollisionData* data) {
+    if (data->contactsLeft <= 0 || convex.getVertexCount() == 0) return 0;
+
+    // the deepest vertex is the support point against the plane normal
+    Vector3 deepest = convex.support(plane.direction * -1);
+    real distance = plane.direction * deepest - plane.offset;
+    if (distance > 0) return 0;
+
+    Contact* contact = data->contacts;
+    contact->contactNormal = plane.direction;
+    contact->penetration = -distance;
+    contact->contactPoint = deepest;
+    contact->setBodyData(convex.body, nullptr, data->friction, data->restitution);
+
+    data->addContacts(1);
+    return 1;
+}
+
+unsigned ConvexDetector::convexAndSphere(const CollisionConvex& convex, const CollisionSphere& sphere,
+    CollisionData* data, GjkCache* cache) {
+    return collide(ConvexShape(convex), ConvexShape(sphere), data, cache);
+}
+
+unsigned ConvexDetector::convexAndBox(const CollisionConvex& convex, const CollisionBox& box,
+    CollisionData* data, GjkCache* cache) {
+    return collide(ConvexShape(convex), ConvexShape(box), data, cache);
+}
+
+unsigned ConvexDetector::convexAndConvex(const CollisionConvex& one, const CollisionConvex& two,
+    CollisionData* data, GjkCache* cache) {
+    return collide(ConvexShape(one), ConvexShape(two), data, cache);
+}
+
+GjkCache* GjkCacheTable::find(const CollisionPrimitive* one, const CollisionPrimitive* two) {
+    Entry& entry = entries[{ one, two }];
+    entry.lastFrame = frame;
+    return &entry.cache;
+}
+
+void GjkCacheTable::endFrame() {
+    // forget pairs that were not looked up since the last call
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.lastFrame != frame) it = entries.erase(it);
+        else ++it;
+    }
+    frame++;
+}
+
+void GjkCacheTable::clear() {
+    entries.clear();
+}
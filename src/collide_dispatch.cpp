@@ -0,0 +1,170 @@
+#include <cyclone/collide_dispatch.h>
+#include <cyclone/collide_ccd.h>
+#include <cyclone/collide_convex.h>
+#include <cyclone/collide_mesh.h>
+
+using namespace cyclone;
+
+CollisionDispatcher::CollisionDispatcher() {
+    for (auto& row : table) {
+        for (auto& entry : row) entry = Entry{ nullptr, nullptr, false, false };
+    }
+    for (auto& function : planeTable) function = nullptr;
+    for (auto& function : continuousPlaneTable) function = nullptr;
+
+    setFunction(PRIMITIVE_SPHERE, PRIMITIVE_SPHERE, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return CollisionDetector::sphereAndSphere(static_cast<const CollisionSphere&>(one), static_cast<const CollisionSphere&>(two), data);
+    });
+    setFunction(PRIMITIVE_BOX, PRIMITIVE_SPHERE, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return CollisionDetector::boxAndSphere(static_cast<const CollisionBox&>(one), static_cast<const CollisionSphere&>(two), data);
+    });
+    setFunction(PRIMITIVE_BOX, PRIMITIVE_BOX, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return CollisionDetector::boxAndBox(static_cast<const CollisionBox&>(one), static_cast<const CollisionBox&>(two), data);
+    });
+
+    setFunction(PRIMITIVE_CONVEX, PRIMITIVE_SPHERE, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return ConvexDetector::convexAndSphere(static_cast<const CollisionConvex&>(one), static_cast<const CollisionSphere&>(two), data);
+    });
+    setFunction(PRIMITIVE_CONVEX, PRIMITIVE_BOX, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return ConvexDetector::convexAndBox(static_cast<const CollisionConvex&>(one), static_cast<const CollisionBox&>(two), data);
+    });
+    setFunction(PRIMITIVE_CONVEX, PRIMITIVE_CONVEX, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return ConvexDetector::convexAndConvex(static_cast<const CollisionConvex&>(one), static_cast<const CollisionConvex&>(two), data);
+    });
+
+    setFunction(PRIMITIVE_SPHERE, PRIMITIVE_MESH, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return MeshDetector::sphereAndMesh(static_cast<const CollisionSphere&>(one), static_cast<const CollisionMesh&>(two), data);
+    });
+    setFunction(PRIMITIVE_BOX, PRIMITIVE_MESH, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return MeshDetector::boxAndMesh(static_cast<const CollisionBox&>(one), static_cast<const CollisionMesh&>(two), data);
+    });
+    setFunction(PRIMITIVE_SPHERE, PRIMITIVE_HEIGHTFIELD, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return MeshDetector::sphereAndHeightfield(static_cast<const CollisionSphere&>(one), static_cast<const CollisionHeightfield&>(two), data);
+    });
+    setFunction(PRIMITIVE_BOX, PRIMITIVE_HEIGHTFIELD, [](const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) {
+        return MeshDetector::boxAndHeightfield(static_cast<const CollisionBox&>(one), static_cast<const CollisionHeightfield&>(two), data);
+    });
+
+    setPlaneFunction(PRIMITIVE_SPHERE, [](const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data) {
+        return CollisionDetector::sphereAndHalfSpace(static_cast<const CollisionSphere&>(primitive), plane, data);
+    });
+    setPlaneFunction(PRIMITIVE_BOX, [](const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data) {
+        return CollisionDetector::boxAndHalfSpace(static_cast<const CollisionBox&>(primitive), plane, data);
+    });
+    setPlaneFunction(PRIMITIVE_CONVEX, [](const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data) {
+        return ConvexDetector::convexAndHalfSpace(static_cast<const CollisionConvex&>(primitive), plane, data);
+    });
+
+    setContinuousFunction(PRIMITIVE_SPHERE, PRIMITIVE_SPHERE, [](const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data) {
+        return ContinuousDetector::sphereAndSphere(static_cast<const CollisionSphere&>(one), static_cast<const CollisionSphere&>(two), duration, data);
+    });
+    setContinuousFunction(PRIMITIVE_BOX, PRIMITIVE_SPHERE, [](const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data) {
+        return ContinuousDetector::boxAndSphere(static_cast<const CollisionBox&>(one), static_cast<const CollisionSphere&>(two), duration, data);
+    });
+    setContinuousFunction(PRIMITIVE_BOX, PRIMITIVE_BOX, [](const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data) {
+        return ContinuousDetector::boxAndBox(static_cast<const CollisionBox&>(one), static_cast<const CollisionBox&>(two), duration, data);
+    });
+
+    setContinuousPlaneFunction(PRIMITIVE_SPHERE, [](const CollisionPrimitive& primitive, const CollisionPlane& plane, real duration, CollisionData* data) {
+        return ContinuousDetector::sphereAndHalfSpace(static_cast<const CollisionSphere&>(primitive), plane, duration, data);
+    });
+    setContinuousPlaneFunction(PRIMITIVE_BOX, [](const CollisionPrimitive& primitive, const CollisionPlane& plane, real duration, CollisionData* data) {
+        return ContinuousDetector::boxAndHalfSpace(static_cast<const CollisionBox&>(primitive), plane, duration, data);
+    });
+}
+
+void CollisionDispatcher::setFunction(PrimitiveType one, PrimitiveType two, PairFunction function) {
+    table[one][two].function = function;
+    table[one][two].swapped = false;
+    if (one != two) {
+        table[two][one].function = function;
+        table[two][one].swapped = true;
+    }
+}
+
+void CollisionDispatcher::setContinuousFunction(PrimitiveType one, PrimitiveType two, ContinuousPairFunction function) {
+    table[one][two].continuous = function;
+    table[one][two].continuousSwapped = false;
+    if (one != two) {
+        table[two][one].continuous = function;
+        table[two][one].continuousSwapped = true;
+    }
+}
+
+void CollisionDispatcher::setContinuousPlaneFunction(PrimitiveType type, ContinuousPlaneFunction function) {
+    continuousPlaneTable[type] = function;
+}
+
+void CollisionDispatcher::swapContacts(CollisionData* data, unsigned first, unsigned count) {
+    // by index, a growing buffer can move the array while they are added
+    for (unsigned i = 0; i < count; i++) data->contactArray[first + i].swapBodies();
+}
+
+void CollisionDispatcher::setPlaneFunction(PrimitiveType type, PlaneFunction function) {
+    planeTable[type] = function;
+}
+
+unsigned CollisionDispatcher::collide(const CollisionPrimitive& one, const CollisionPrimitive& two, CollisionData* data) const {
+    if (!one.isDynamic() && !two.isDynamic()) return 0;
+    if (!one.canCollideWith(two)) return 0;
+
+    const Entry& entry = table[one.getType()][two.getType()];
+    if (!entry.function) return 0;
+    if (!entry.swapped) return entry.function(one, two, data);
+
+    unsigned first = data->contactCount;
+    unsigned count = entry.function(two, one, data);
+    swapContacts(data, first, count);
+    return count;
+}
+
+unsigned CollisionDispatcher::collide(const CollisionPrimitive& one, const CollisionPrimitive& two, real duration, CollisionData* data) const {
+    const Entry& entry = table[one.getType()][two.getType()];
+    bool fast = (one.body && one.body->isContinuous()) || (two.body && two.body->isContinuous());
+    if (!fast || !entry.continuous) return collide(one, two, data);
+
+    if (!one.isDynamic() && !two.isDynamic()) return 0;
+    if (!one.canCollideWith(two)) return 0;
+    if (!entry.continuousSwapped) return entry.continuous(one, two, duration, data);
+
+    unsigned first = data->contactCount;
+    unsigned count = entry.continuous(two, one, duration, data);
+    swapContacts(data, first, count);
+    return count;
+}
+
+unsigned CollisionDispatcher::collide(const CollisionPrimitive& primitive, const CollisionPlane& plane, real duration, CollisionData* data) const {
+    ContinuousPlaneFunction function = continuousPlaneTable[primitive.getType()];
+    if (!function || !primitive.body || !primitive.body->isContinuous()) return collide(primitive, plane, data);
+    if (!primitive.isDynamic()) return 0;
+
+    return function(primitive, plane, duration, data);
+}
+
+unsigned CollisionDispatcher::collide(const PrimitivePair* pairs, unsigned count, real duration, CollisionData* data) const {
+    unsigned total = 0;
+    for (unsigned i = 0; i < count && data->hasMoreContacts(); i++) {
+        total += collide(*pairs[i].one, *pairs[i].two, duration, data);
+    }
+    return total;
+}
+
+unsigned CollisionDispatcher::collide(const CollisionPrimitive& primitive, const CollisionPlane& plane, CollisionData* data) const {
+    if (!primitive.isDynamic()) return 0;
+
+    PlaneFunction function = planeTable[primitive.getType()];
+    return function ? function(primitive, plane, data) : 0;
+}
+
+unsigned CollisionDispatcher::collide(const PrimitivePair* pairs, unsigned count, CollisionData* data) const {
+    unsigned total = 0;
+    for (unsigned i = 0; i < count && data->hasMoreContacts(); i++) {
+        total += collide(*pairs[i].one, *pairs[i].two, data);
+    }
+    return total;
+}
+
+const CollisionDispatcher& CollisionDispatcher::standard() {
+    static const CollisionDispatcher dispatcher;
+    return dispatcher;
+}
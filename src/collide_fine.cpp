@@ -1,5 +1,7 @@
 #include <cyclone/collide_fine.h>
 #include <assert.h>
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 
 using namespace cyclone;
@@ -11,6 +13,11 @@ void CollisionPrimitive::calculateInternals() {
     * calculate the transform matrix for this shape
     * it translates rotates the shape into the world space on the rigid body
     */
+    if (!body) {
+        // static geometry with no body is placed by its offset alone
+        transform = offset;
+        return;
+    }
 	Matrix4 bodyTransform = body->getTransform();
 
     transform.data[0] = bodyTransform.data[0] * offset.data[0] + bodyTransform.data[1] * offset.data[4] + bodyTransform.data[2] * offset.data[8];
@@ -326,4 +333,64 @@ unsigned CollisionDetector::boxAndBox(const CollisionBox& one, const CollisionBo
 
     data->addContacts(1);
     return 1;
-}
\ No newline at end of file
+}
+
+unsigned CollisionDetector::boxAndSphere(const CollisionBox& box, const CollisionSphere& sphere, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    // Work in the box's local coordinates
+    Vector3 centre(sphere.getTransform().data[3], sphere.getTransform().data[7], sphere.getTransform().data[11]);
+    Vector3 relCentre = box.getTransform().transformInverse(centre);
+
+    // Early out if the sphere is clearly outside one of the slabs
+    if (std::abs(relCentre.x) - sphere.radius > box.halfSize.x ||
+        std::abs(relCentre.y) - sphere.radius > box.halfSize.y ||
+        std::abs(relCentre.z) - sphere.radius > box.halfSize.z) {
+        return 0;
+    }
+
+    // Clamp the centre to the box to find the closest point
+    Vector3 closestPt(
+        std::clamp(relCentre.x, -box.halfSize.x, box.halfSize.x),
+        std::clamp(relCentre.y, -box.halfSize.y, box.halfSize.y),
+        std::clamp(relCentre.z, -box.halfSize.z, box.halfSize.z)
+    );
+
+    real dist = (closestPt - relCentre).squareMagnitude();
+    if (dist > sphere.radius * sphere.radius) return 0;
+
+    Contact* contact = data->contacts;
+
+    Vector3 closestPtWorld = box.getTransform().transform(closestPt);
+    if (dist > 0) {
+        // Normal points from the sphere towards the box (body one)
+        Vector3 normal = closestPtWorld - centre;
+        normal.normalize();
+        contact->contactNormal = normal;
+        contact->penetration = sphere.radius - std::sqrt(dist);
+    }
+    else {
+        // The centre is inside the box, push out through the nearest face
+        real faceDepth[3] = {
+            box.halfSize.x - std::abs(relCentre.x),
+            box.halfSize.y - std::abs(relCentre.y),
+            box.halfSize.z - std::abs(relCentre.z)
+        };
+        unsigned axis = 0;
+        if (faceDepth[1] < faceDepth[axis]) axis = 1;
+        if (faceDepth[2] < faceDepth[axis]) axis = 2;
+
+        real side = (axis == 0 ? relCentre.x : axis == 1 ? relCentre.y : relCentre.z) < 0 ? 1 : -1;
+        contact->contactNormal = box.getAxis(axis) * side;
+        contact->penetration = sphere.radius + faceDepth[axis];
+    }
+
+    contact->contactPoint = closestPtWorld;
+    contact->contact[0] = box.body;
+    contact->contact[1] = sphere.body;
+    contact->friction = data->friction;
+    contact->restitution = data->restitution;
+
+    data->addContacts(1);
+    return 1;
+}
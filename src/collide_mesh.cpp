@@ -0,0 +1,685 @@
+#include <cyclone/collide_mesh.h>
+#include <cstdio>
+#include <cstring>
+
+using namespace cyclone;
+
+/*
+* quantized tree
+*/
+
+void QuantizedTree::clear() {
+    storage.clear();
+    nodes = nullptr;
+    nodeCount = 0;
+}
+
+void QuantizedTree::attach(const Node* attached, unsigned count, const Vector3& quantizeOrigin, const Vector3& quantizeScale) {
+    storage.clear();
+    nodes = attached;
+    nodeCount = count;
+    origin = quantizeOrigin;
+    scale = quantizeScale;
+}
+
+bool QuantizedTree::validate(const Node* checked, unsigned count, unsigned itemCount) {
+    for (unsigned i = 0; i < count; i++) {
+        int64_t data = checked[i].data;
+        if (data >= 0) {
+            if (data >= itemCount) return false;
+        }
+        else if (-data < 3 || i + -data > count) {
+            // An inner node holds at least itself and two leaves
+            return false;
+        }
+    }
+    return true;
+}
+
+void QuantizedTree::quantize(const Vector3& point, uint16_t out[3], bool roundUp) const {
+    real local[3] = {
+        (point.x - origin.x) * scale.x,
+        (point.y - origin.y) * scale.y,
+        (point.z - origin.z) * scale.z
+    };
+    for (unsigned axis = 0; axis < 3; axis++) {
+        real value = roundUp ? std::ceil(local[axis]) : std::floor(local[axis]);
+        out[axis] = (uint16_t)std::clamp(value, (real)0, (real)65535);
+    }
+}
+
+void QuantizedTree::build(const BoundingBox* bounds, unsigned count) {
+    clear();
+    if (count == 0) return;
+
+    BoundingBox total = BoundingBox::empty();
+    std::vector<unsigned> items(count);
+    std::vector<Vector3> centres(count);
+    for (unsigned i = 0; i < count; i++) {
+        total.enclose(bounds[i]);
+        items[i] = i;
+        centres[i] = bounds[i].getCentre();
+    }
+
+    // flat axes quantize to a single value, which keeps the test conservative
+    Vector3 extent = total.max - total.min;
+    origin = total.min;
+    scale = Vector3(
+        extent.x > 0 ? 65535 / extent.x : 0,
+        extent.y > 0 ? 65535 / extent.y : 0,
+        extent.z > 0 ? 65535 / extent.z : 0
+    );
+
+    storage.reserve(2 * count - 1);
+    buildRange(bounds, items, centres, 0, count);
+
+    nodes = storage.data();
+    nodeCount = (unsigned)storage.size();
+}
+
+unsigned QuantizedTree::buildRange(const BoundingBox* bounds, std::vector<unsigned>& items,
+    const std::vector<Vector3>& centres, unsigned first, unsigned count) {
+    unsigned index = (unsigned)storage.size();
+    storage.emplace_back();
+
+    BoundingBox box = BoundingBox::empty();
+    BoundingBox centreBounds = BoundingBox::empty();
+    for (unsigned i = first; i < first + count; i++) {
+        box.enclose(bounds[items[i]]);
+        centreBounds.enclose(centres[items[i]]);
+    }
+    quantize(box.min, storage[index].min, false);
+    quantize(box.max, storage[index].max, true);
+
+    if (count == 1) {
+        storage[index].data = (int32_t)items[first];
+        return index;
+    }
+
+    Vector3 extent = centreBounds.max - centreBounds.min;
+    unsigned axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > (axis == 0 ? extent.x : extent.y)) axis = 2;
+
+    auto key = [&centres, axis](unsigned item) {
+        const Vector3& c = centres[item];
+        return axis == 0 ? c.x : axis == 1 ? c.y : c.z;
+    };
+
+    unsigned half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+        [&key](unsigned a, unsigned b) { return key(a) < key(b); });
+
+    buildRange(bounds, items, centres, first, half);
+    buildRange(bounds, items, centres, first + half, count - half);
+
+    // the escape distance: the subtree including this node
+    storage[index].data = -(int32_t)(storage.size() - index);
+    return index;
+}
+
+/*
+* file layout shared by meshes and heightfields
+* a header followed by sections, each starting on a sectionAlignment boundary
+*/
+
+static const uint32_t fileVersion = 1;
+static const size_t sectionAlignment = 32;
+
+struct GeometryFileHeader {
+    char magic[4];
+    uint32_t version;
+
+    // written by the saving build, a mismatch means the data can not be used in place
+    uint32_t realSize;
+    uint32_t vectorSize;
+
+    // mesh: vertices, triangles, nodes. heightfield: columns, rows, nodes
+    uint32_t counts[4];
+
+    real spacing;
+    real treeOrigin[3];
+    real treeScale[3];
+};
+
+static size_t alignSection(size_t offset) {
+    return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+}
+
+static bool writeSection(std::FILE* out, const void* data, size_t size, size_t& offset) {
+    static const unsigned char zeros[sectionAlignment] = {};
+    size_t padding = alignSection(offset) - offset;
+    if (padding > 0 && std::fwrite(zeros, 1, padding, out) != padding) return false;
+    if (size > 0 && std::fwrite(data, 1, size, out) != size) return false;
+    offset += padding + size;
+    return true;
+}
+
+static bool writeGeometryFile(const char* path, GeometryFileHeader& header, const QuantizedTree& tree,
+    const void* sections[2], const size_t sizes[2]) {
+    header.version = fileVersion;
+    header.realSize = sizeof(real);
+    header.vectorSize = sizeof(Vector3);
+    header.counts[2] = tree.getNodeCount();
+    header.treeOrigin[0] = tree.getOrigin().x; header.treeOrigin[1] = tree.getOrigin().y; header.treeOrigin[2] = tree.getOrigin().z;
+    header.treeScale[0] = tree.getScale().x; header.treeScale[1] = tree.getScale().y; header.treeScale[2] = tree.getScale().z;
+
+    std::FILE* out = std::fopen(path, "wb");
+    if (!out) return false;
+
+    size_t offset = 0;
+    bool written =
+        writeSection(out, &header, sizeof(header), offset) &&
+        writeSection(out, sections[0], sizes[0], offset) &&
+        writeSection(out, sections[1], sizes[1], offset) &&
+        writeSection(out, tree.getNodes(), tree.getNodeCount() * sizeof(QuantizedTree::Node), offset);
+
+    return std::fclose(out) == 0 && written;
+}
+
+/*
+* checks the header and finds the sections, returns null if the file does not fit
+*/
+static const GeometryFileHeader* readGeometryFile(const MappedFile& file, const char magic[4],
+    const size_t sizes[2], const unsigned char* sections[3]) {
+    if (file.size() < sizeof(GeometryFileHeader)) return nullptr;
+
+    const GeometryFileHeader* header = reinterpret_cast<const GeometryFileHeader*>(file.data());
+    if (std::memcmp(header->magic, magic, 4) != 0 || header->version != fileVersion ||
+        header->realSize != sizeof(real) || header->vectorSize != sizeof(Vector3)) return nullptr;
+
+    size_t sectionSizes[3] = { sizes[0], sizes[1], header->counts[2] * sizeof(QuantizedTree::Node) };
+    size_t offset = sizeof(GeometryFileHeader);
+    for (unsigned i = 0; i < 3; i++) {
+        offset = alignSection(offset);
+        if (offset + sectionSizes[i] > file.size()) return nullptr;
+        sections[i] = file.data() + offset;
+        offset += sectionSizes[i];
+    }
+    return header;
+}
+
+static void attachTree(QuantizedTree& tree, const GeometryFileHeader* header, const unsigned char* nodes) {
+    tree.attach(reinterpret_cast<const QuantizedTree::Node*>(nodes), header->counts[2],
+        Vector3(header->treeOrigin[0], header->treeOrigin[1], header->treeOrigin[2]),
+        Vector3(header->treeScale[0], header->treeScale[1], header->treeScale[2]));
+}
+
+/*
+* triangle mesh
+*/
+
+void CollisionMesh::build(const Vector3* meshVertices, unsigned meshVertexCount, const unsigned* meshIndices, unsigned meshTriangleCount) {
+    file.close();
+    vertexStorage.assign(meshVertices, meshVertices + meshVertexCount);
+    indexStorage.assign(meshIndices, meshIndices + 3 * meshTriangleCount);
+    vertices = vertexStorage.data();
+    indices = indexStorage.data();
+    vertexCount = meshVertexCount;
+    triangleCount = meshTriangleCount;
+
+    std::vector<BoundingBox> bounds(triangleCount);
+    for (unsigned i = 0; i < triangleCount; i++) {
+        Vector3 corners[3];
+        getTriangle(i, corners);
+        bounds[i] = BoundingBox::empty();
+        for (const Vector3& corner : corners) bounds[i].enclose(corner);
+    }
+    tree.build(bounds.data(), triangleCount);
+}
+
+bool CollisionMesh::save(const char* path) const {
+    GeometryFileHeader header = {};
+    std::memcpy(header.magic, "CYMS", 4);
+    header.counts[0] = vertexCount;
+    header.counts[1] = triangleCount;
+
+    const void* sections[2] = { vertices, indices };
+    size_t sizes[2] = { vertexCount * sizeof(Vector3), 3 * triangleCount * sizeof(unsigned) };
+    return writeGeometryFile(path, header, tree, sections, sizes);
+}
+
+bool CollisionMesh::load(const char* path) {
+    MappedFile mapped;
+    if (!mapped.open(path) || mapped.size() < sizeof(GeometryFileHeader)) return false;
+
+    const GeometryFileHeader* header = reinterpret_cast<const GeometryFileHeader*>(mapped.data());
+    size_t sizes[2] = { header->counts[0] * sizeof(Vector3), 3 * (size_t)header->counts[1] * sizeof(unsigned) };
+    const unsigned char* sections[3];
+    if (!readGeometryFile(mapped, "CYMS", sizes, sections)) return false;
+
+    // Every index is used unchecked by the queries, so check them once here
+    const unsigned* fileIndices = reinterpret_cast<const unsigned*>(sections[1]);
+    for (size_t i = 0; i < 3 * (size_t)header->counts[1]; i++) {
+        if (fileIndices[i] >= header->counts[0]) return false;
+    }
+    if (!QuantizedTree::validate(reinterpret_cast<const QuantizedTree::Node*>(sections[2]),
+        header->counts[2], header->counts[1])) return false;
+
+    vertexStorage.clear();
+    indexStorage.clear();
+    vertices = reinterpret_cast<const Vector3*>(sections[0]);
+    indices = reinterpret_cast<const unsigned*>(sections[1]);
+    vertexCount = header->counts[0];
+    triangleCount = header->counts[1];
+    attachTree(tree, header, sections[2]);
+
+    file = std::move(mapped);
+    return true;
+}
+
+/*
+* heightfield
+*/
+
+void CollisionHeightfield::build(const real* fieldHeights, unsigned fieldColumns, unsigned fieldRows, real fieldSpacing) {
+    file.close();
+    heightStorage.assign(fieldHeights, fieldHeights + (size_t)fieldColumns * fieldRows);
+    heights = heightStorage.data();
+    columns = fieldColumns;
+    rows = fieldRows;
+    spacing = fieldSpacing;
+
+    tree.clear();
+    tileColumns = 0;
+    if (columns < 2 || rows < 2) return;
+
+    tileColumns = (columns - 2) / tileSize + 1;
+    unsigned tileRows = (rows - 2) / tileSize + 1;
+
+    std::vector<BoundingBox> bounds(tileColumns * tileRows);
+    for (unsigned tileRow = 0; tileRow < tileRows; tileRow++) {
+        for (unsigned tileColumn = 0; tileColumn < tileColumns; tileColumn++) {
+            bounds[tileRow * tileColumns + tileColumn] = tileBounds(tileColumn, tileRow);
+        }
+    }
+    tree.build(bounds.data(), (unsigned)bounds.size());
+}
+
+BoundingBox CollisionHeightfield::tileBounds(unsigned tileColumn, unsigned tileRow) const {
+    unsigned firstColumn = tileColumn * tileSize, firstRow = tileRow * tileSize;
+    unsigned lastColumn = std::min(firstColumn + tileSize, columns - 1);
+    unsigned lastRow = std::min(firstRow + tileSize, rows - 1);
+
+    real low = DBL_MAX, high = -DBL_MAX;
+    for (unsigned row = firstRow; row <= lastRow; row++) {
+        for (unsigned column = firstColumn; column <= lastColumn; column++) {
+            low = std::min(low, getHeight(column, row));
+            high = std::max(high, getHeight(column, row));
+        }
+    }
+
+    BoundingBox box;
+    box.min = Vector3(firstColumn * spacing, low, firstRow * spacing);
+    box.max = Vector3(lastColumn * spacing, high, lastRow * spacing);
+    return box;
+}
+
+void CollisionHeightfield::getCellTriangles(unsigned column, unsigned row, Vector3 corners[6]) const {
+    real x0 = column * spacing, x1 = (column + 1) * spacing;
+    real z0 = row * spacing, z1 = (row + 1) * spacing;
+    Vector3 p00(x0, getHeight(column, row), z0);
+    Vector3 p10(x1, getHeight(column + 1, row), z0);
+    Vector3 p01(x0, getHeight(column, row + 1), z1);
+    Vector3 p11(x1, getHeight(column + 1, row + 1), z1);
+
+    // both wound to face +y
+    corners[0] = p00; corners[1] = p01; corners[2] = p10;
+    corners[3] = p10; corners[4] = p01; corners[5] = p11;
+}
+
+bool CollisionHeightfield::save(const char* path) const {
+    GeometryFileHeader header = {};
+    std::memcpy(header.magic, "CYHF", 4);
+    header.counts[0] = columns;
+    header.counts[1] = rows;
+    header.spacing = spacing;
+
+    const void* sections[2] = { heights, nullptr };
+    size_t sizes[2] = { (size_t)columns * rows * sizeof(real), 0 };
+    return writeGeometryFile(path, header, tree, sections, sizes);
+}
+
+bool CollisionHeightfield::load(const char* path) {
+    MappedFile mapped;
+    if (!mapped.open(path) || mapped.size() < sizeof(GeometryFileHeader)) return false;
+
+    const GeometryFileHeader* header = reinterpret_cast<const GeometryFileHeader*>(mapped.data());
+    if (header->counts[0] != 0 && header->counts[1] > SIZE_MAX / sizeof(real) / header->counts[0]) return false;
+    size_t sizes[2] = { (size_t)header->counts[0] * header->counts[1] * sizeof(real), 0 };
+    const unsigned char* sections[3];
+    if (!readGeometryFile(mapped, "CYHF", sizes, sections)) return false;
+
+    // The tree's items are the tiles, a grid under 2x2 has none
+    unsigned fileColumns = header->counts[0], fileRows = header->counts[1];
+    size_t tileCount = fileColumns < 2 || fileRows < 2 ? 0 :
+        (size_t)((fileColumns - 2) / tileSize + 1) * ((fileRows - 2) / tileSize + 1);
+    if (tileCount > UINT32_MAX) return false;
+    if (!QuantizedTree::validate(reinterpret_cast<const QuantizedTree::Node*>(sections[2]),
+        header->counts[2], (unsigned)tileCount)) return false;
+
+    heightStorage.clear();
+    heights = reinterpret_cast<const real*>(sections[0]);
+    columns = fileColumns;
+    rows = fileRows;
+    spacing = header->spacing;
+    tileColumns = columns < 2 ? 0 : (columns - 2) / tileSize + 1;
+    attachTree(tree, header, sections[2]);
+
+    file = std::move(mapped);
+    return true;
+}
+
+/*
+* contact generation
+*/
+
+/*
+* world bounds brought into a primitive's local space
+*/
+static BoundingBox localBounds(const Matrix4& transform, const BoundingBox& world) {
+    Vector3 centre = transform.transformInverse(world.getCentre());
+    Vector3 h = world.getHalfSize();
+    const real* m = transform.data;
+    Vector3 extent(
+        std::abs(m[0]) * h.x + std::abs(m[4]) * h.y + std::abs(m[8]) * h.z,
+        std::abs(m[1]) * h.x + std::abs(m[5]) * h.y + std::abs(m[9]) * h.z,
+        std::abs(m[2]) * h.x + std::abs(m[6]) * h.y + std::abs(m[10]) * h.z
+    );
+
+    BoundingBox box;
+    box.min = centre - extent;
+    box.max = centre + extent;
+    return box;
+}
+
+/*
+* closest point on a triangle (Ericson, Real-Time Collision Detection 5.1.5)
+*/
+static Vector3 closestPointOnTriangle(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c) {
+    Vector3 ab = b - a, ac = c - a, ap = p - a;
+    real d1 = ab * ap, d2 = ac * ap;
+    if (d1 <= 0 && d2 <= 0) return a;
+
+    Vector3 bp = p - b;
+    real d3 = ab * bp, d4 = ac * bp;
+    if (d3 >= 0 && d4 <= d3) return b;
+
+    real vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) return a + ab * (d1 / (d1 - d3));
+
+    Vector3 cp = p - c;
+    real d5 = ab * cp, d6 = ac * cp;
+    if (d6 >= 0 && d5 <= d6) return c;
+
+    real vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) return a + ac * (d2 / (d2 - d6));
+
+    real va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+    real denominator = 1 / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+/*
+* closest points between segments p1-q1 and p2-q2 (Ericson 5.1.9)
+*/
+static void closestPointsOnSegments(const Vector3& p1, const Vector3& q1, const Vector3& p2, const Vector3& q2,
+    Vector3* c1, Vector3* c2) {
+    Vector3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    real a = d1 * d1, e = d2 * d2, f = d2 * r;
+    real s = 0, t = 0;
+
+    if (a <= 0 && e <= 0) {
+        *c1 = p1;
+        *c2 = p2;
+        return;
+    }
+    if (a <= 0) {
+        t = std::clamp(f / e, (real)0, (real)1);
+    }
+    else {
+        real c = d1 * r;
+        if (e <= 0) {
+            s = std::clamp(-c / a, (real)0, (real)1);
+        }
+        else {
+            real b = d1 * d2;
+            real denominator = a * e - b * b;
+            if (denominator != 0) s = std::clamp((b * f - c * e) / denominator, (real)0, (real)1);
+            t = (b * s + f) / e;
+            if (t < 0) {
+                t = 0;
+                s = std::clamp(-c / a, (real)0, (real)1);
+            }
+            else if (t > 1) {
+                t = 1;
+                s = std::clamp((b - c) / a, (real)0, (real)1);
+            }
+        }
+    }
+    *c1 = p1 + d1 * s;
+    *c2 = p2 + d2 * t;
+}
+
+static void fillContact(CollisionData* data, const Vector3& point, const Vector3& normal, real penetration,
+    RigidBody* one, RigidBody* two) {
+    Contact* contact = data->contacts;
+    contact->contactPoint = point;
+    contact->contactNormal = normal;
+    contact->penetration = penetration;
+    contact->contact[0] = one;
+    contact->contact[1] = two;
+    contact->friction = data->friction;
+    contact->restitution = data->restitution;
+    data->addContacts(1);
+}
+
+unsigned MeshDetector::sphereAndTriangle(const CollisionSphere& sphere, const Vector3 triangle[3],
+    RigidBody* triangleBody, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    Vector3 normal = (triangle[1] - triangle[0]) ^ (triangle[2] - triangle[0]);
+    if (normal.squareMagnitude() <= 0) return 0;
+    normal.normalize();
+
+    Vector3 centre(sphere.getTransform().data[3], sphere.getTransform().data[7], sphere.getTransform().data[11]);
+    real height = normal * (centre - triangle[0]);
+    if (height >= sphere.radius || height <= -sphere.radius) return 0;
+
+    Vector3 closest = closestPointOnTriangle(centre, triangle[0], triangle[1], triangle[2]);
+    Vector3 toCentre = centre - closest;
+
+    if (height < 0) {
+        // behind the face, only push out if the centre is over the face itself
+        if ((toCentre - normal * height).squareMagnitude() > sphere.radius * sphere.radius * 1e-6) return 0;
+        fillContact(data, closest, normal, sphere.radius - height, sphere.body, triangleBody);
+        return 1;
+    }
+
+    real distance = toCentre.squareMagnitude();
+    if (distance > sphere.radius * sphere.radius) return 0;
+
+    distance = std::sqrt(distance);
+    if (distance > 0) normal = toCentre * (1 / distance);
+    fillContact(data, closest, normal, sphere.radius - distance, sphere.body, triangleBody);
+    return 1;
+}
+
+static inline real boxRadiusOnAxis(const CollisionBox& box, const Vector3& axis) {
+    return
+        box.halfSize.x * std::abs(axis * box.getAxis(0)) +
+        box.halfSize.y * std::abs(axis * box.getAxis(1)) +
+        box.halfSize.z * std::abs(axis * box.getAxis(2));
+}
+
+/*
+* the box corner (or edge point, skipping one axis) furthest along -direction
+*/
+static Vector3 deepestBoxPoint(const CollisionBox& box, const Vector3& direction, unsigned skipAxis = 3) {
+    real halfSize[3] = { box.halfSize.x, box.halfSize.y, box.halfSize.z };
+    Vector3 point(box.getTransform().data[3], box.getTransform().data[7], box.getTransform().data[11]);
+    for (unsigned i = 0; i < 3; i++) {
+        if (i == skipAxis) continue;
+        Vector3 axis = box.getAxis(i);
+        point.addScaledVector(axis, (axis * direction > 0) ? -halfSize[i] : halfSize[i]);
+    }
+    return point;
+}
+
+/*
+* projects the triangle (relative to the box centre) and the box onto an axis
+* returns false if they are apart, otherwise the smaller push and its sign.
+* pushes that would move the box behind the face are not allowed
+*/
+static bool triangleAxisOverlap(const CollisionBox& box, const Vector3 corners[3], const Vector3& axis,
+    const Vector3& faceNormal, real& depth, real& sign) {
+    real radius = boxRadiusOnAxis(box, axis);
+
+    real p0 = corners[0] * axis, p1 = corners[1] * axis, p2 = corners[2] * axis;
+    real low = std::min(p0, std::min(p1, p2));
+    real high = std::max(p0, std::max(p1, p2));
+    if (low > radius || high < -radius) return false;
+
+    // pushing the box along +axis clears high, along -axis clears low
+    real up = high + radius, down = radius - low;
+    real facing = axis * faceNormal;
+    if (facing > 0.0001 || (facing >= -0.0001 && up <= down)) { depth = up; sign = 1; }
+    else { depth = down; sign = -1; }
+    return true;
+}
+
+unsigned MeshDetector::boxAndTriangle(const CollisionBox& box, const Vector3 triangle[3],
+    RigidBody* triangleBody, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    // Work relative to the box centre
+    Vector3 centre(box.getTransform().data[3], box.getTransform().data[7], box.getTransform().data[11]);
+    Vector3 corners[3] = { triangle[0] - centre, triangle[1] - centre, triangle[2] - centre };
+    Vector3 edges[3] = { corners[1] - corners[0], corners[2] - corners[1], corners[0] - corners[2] };
+
+    Vector3 faceNormal = edges[0] ^ (corners[2] - corners[0]);
+    if (faceNormal.squareMagnitude() <= 0) return 0;
+    faceNormal.normalize();
+
+    // The face is one sided: the box can only leave through the front
+    real faceRadius = boxRadiusOnAxis(box, faceNormal);
+    real planeDistance = corners[0] * faceNormal;
+    if (planeDistance > faceRadius || planeDistance < -faceRadius) return 0;
+    real faceDepth = faceRadius + planeDistance;
+
+    real bestDepth = DBL_MAX, bestSign = 1;
+    unsigned best = 0xffffff;
+    Vector3 bestAxis;
+    real depth, sign;
+
+    for (unsigned i = 0; i < 3; i++) {
+        Vector3 axis = box.getAxis(i);
+        if (!triangleAxisOverlap(box, corners, axis, faceNormal, depth, sign)) return 0;
+        if (depth < bestDepth) { bestDepth = depth; bestSign = sign; best = i; bestAxis = axis; }
+    }
+
+    for (unsigned i = 0; i < 3; i++) {
+        for (unsigned j = 0; j < 3; j++) {
+            Vector3 axis = box.getAxis(i) ^ edges[j];
+            if (axis.squareMagnitude() < 0.0001 * edges[j].squareMagnitude()) continue;
+            axis.normalize();
+            if (!triangleAxisOverlap(box, corners, axis, faceNormal, depth, sign)) return 0;
+            if (depth < bestDepth) { bestDepth = depth; bestSign = sign; best = 3 + i * 3 + j; bestAxis = axis; }
+        }
+    }
+
+    // Use the face when the box's deepest corner is over it or the face is
+    // nearly as shallow, so boxes sliding over a flat mesh do not catch on
+    // the edges between its triangles
+    Vector3 deepest = deepestBoxPoint(box, faceNormal);
+    Vector3 point = closestPointOnTriangle(deepest, triangle[0], triangle[1], triangle[2]);
+    Vector3 offPlane = deepest - point;
+    bool overFace = (offPlane - faceNormal * (offPlane * faceNormal)).squareMagnitude() <= 1e-12;
+    if (overFace || faceDepth <= bestDepth * 1.05) {
+        fillContact(data, point, faceNormal, faceDepth, box.body, triangleBody);
+        return 1;
+    }
+
+    Vector3 normal = bestAxis * bestSign;
+    if (best < 3) {
+        // a box face: the triangle corner reaching furthest into the box
+        unsigned deepest = 0;
+        for (unsigned i = 1; i < 3; i++) {
+            if (corners[i] * normal > corners[deepest] * normal) deepest = i;
+        }
+        fillContact(data, triangle[deepest], normal, bestDepth, box.body, triangleBody);
+        return 1;
+    }
+
+    // edge against edge: the box edge nearest the triangle and the triangle edge
+    unsigned boxAxis = (best - 3) / 3, triangleEdge = (best - 3) % 3;
+    Vector3 vertex = deepestBoxPoint(box, normal, boxAxis);
+    real halfSize[3] = { box.halfSize.x, box.halfSize.y, box.halfSize.z };
+    Vector3 reach = box.getAxis(boxAxis) * halfSize[boxAxis];
+
+    Vector3 onBox, onTriangle;
+    closestPointsOnSegments(vertex - reach, vertex + reach, triangle[triangleEdge], triangle[(triangleEdge + 1) % 3],
+        &onBox, &onTriangle);
+    fillContact(data, (onBox + onTriangle) * 0.5, normal, bestDepth, box.body, triangleBody);
+    return 1;
+}
+
+unsigned MeshDetector::sphereAndMesh(const CollisionSphere& sphere, const CollisionMesh& mesh, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    const Matrix4& transform = mesh.getTransform();
+    unsigned count = 0;
+    mesh.getTree().overlap(localBounds(transform, BoundingBox::of(sphere)), [&](unsigned index) {
+        Vector3 corners[3];
+        mesh.getTriangle(index, corners);
+        for (Vector3& corner : corners) corner = transform.transform(corner);
+        count += sphereAndTriangle(sphere, corners, mesh.body, data);
+    });
+    return count;
+}
+
+unsigned MeshDetector::boxAndMesh(const CollisionBox& box, const CollisionMesh& mesh, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    const Matrix4& transform = mesh.getTransform();
+    unsigned count = 0;
+    mesh.getTree().overlap(localBounds(transform, BoundingBox::of(box)), [&](unsigned index) {
+        Vector3 corners[3];
+        mesh.getTriangle(index, corners);
+        for (Vector3& corner : corners) corner = transform.transform(corner);
+        count += boxAndTriangle(box, corners, mesh.body, data);
+    });
+    return count;
+}
+
+unsigned MeshDetector::sphereAndHeightfield(const CollisionSphere& sphere, const CollisionHeightfield& field, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    const Matrix4& transform = field.getTransform();
+    unsigned count = 0;
+    field.overlap(localBounds(transform, BoundingBox::of(sphere)), [&](unsigned column, unsigned row) {
+        Vector3 corners[6];
+        field.getCellTriangles(column, row, corners);
+        for (Vector3& corner : corners) corner = transform.transform(corner);
+        count += sphereAndTriangle(sphere, corners, field.body, data);
+        count += sphereAndTriangle(sphere, corners + 3, field.body, data);
+    });
+    return count;
+}
+
+unsigned MeshDetector::boxAndHeightfield(const CollisionBox& box, const CollisionHeightfield& field, CollisionData* data) {
+    if (data->contactsLeft <= 0) return 0;
+
+    const Matrix4& transform = field.getTransform();
+    unsigned count = 0;
+    field.overlap(localBounds(transform, BoundingBox::of(box)), [&](unsigned column, unsigned row) {
+        Vector3 corners[6];
+        field.getCellTriangles(column, row, corners);
+        for (Vector3& corner : corners) corner = transform.transform(corner);
+        count += boxAndTriangle(box, corners, field.body, data);
+        count += boxAndTriangle(box, corners + 3, field.body, data);
+    });
+    return count;
+}
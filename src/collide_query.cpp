@@ -0,0 +1,407 @@
+#include <cyclone/collide_query.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+using namespace cyclone;
+
+static const unsigned maxCastSteps = 32;
+static const real castTolerance = (real)0.0001;
+
+void CollisionQuery::addSphere(const CollisionSphere* sphere) {
+    shapes.push_back(Shape{ sphere, SPHERE });
+}
+
+void CollisionQuery::addBox(const CollisionBox* box) {
+    shapes.push_back(Shape{ box, BOX });
+}
+
+void CollisionQuery::addPlane(const CollisionPlane* plane) {
+    planes.push_back(plane);
+}
+
+void CollisionQuery::clear() {
+    shapes.clear();
+    planes.clear();
+    bounds.clear();
+    sphereX.clear(); sphereY.clear(); sphereZ.clear(); sphereRadius.clear();
+    tree.clear();
+}
+
+void CollisionQuery::updateBounds() {
+    unsigned count = (unsigned)shapes.size();
+    bounds.resize(count);
+    sphereX.resize(count); sphereY.resize(count); sphereZ.resize(count); sphereRadius.resize(count);
+
+    for (unsigned i = 0; i < count; i++) {
+        const Shape& shape = shapes[i];
+        if (shape.kind == SPHERE) {
+            const CollisionSphere& sphere = *static_cast<const CollisionSphere*>(shape.primitive);
+            const Matrix4& t = sphere.getTransform();
+            sphereX[i] = t.data[3];
+            sphereY[i] = t.data[7];
+            sphereZ[i] = t.data[11];
+            sphereRadius[i] = sphere.radius;
+            bounds[i] = BoundingBox::of(sphere);
+        }
+        else {
+            bounds[i] = BoundingBox::of(*static_cast<const CollisionBox*>(shape.primitive));
+        }
+    }
+}
+
+void CollisionQuery::build() {
+    updateBounds();
+    tree.build(bounds.data(), (unsigned)bounds.size());
+}
+
+void CollisionQuery::refit() {
+    updateBounds();
+    tree.refit(bounds.data());
+}
+
+/*
+* ray against two spheres at once, direction must be unit length
+* writes the entry distances (0 when starting inside) and returns a hit mask
+*/
+static inline unsigned raycastSpherePair(const Vector3& o, const Vector3& d, real maxDistance,
+    const real cx[2], const real cy[2], const real cz[2], const real radius[2], real t[2]) {
+#ifdef CYCLONE_SSE2
+    __m128d ocx = _mm_sub_pd(_mm_set1_pd(o.x), _mm_loadu_pd(cx));
+    __m128d ocy = _mm_sub_pd(_mm_set1_pd(o.y), _mm_loadu_pd(cy));
+    __m128d ocz = _mm_sub_pd(_mm_set1_pd(o.z), _mm_loadu_pd(cz));
+    __m128d r = _mm_loadu_pd(radius);
+
+    __m128d b = _mm_add_pd(_mm_add_pd(
+        _mm_mul_pd(ocx, _mm_set1_pd(d.x)), _mm_mul_pd(ocy, _mm_set1_pd(d.y))), _mm_mul_pd(ocz, _mm_set1_pd(d.z)));
+    __m128d c = _mm_sub_pd(_mm_add_pd(_mm_add_pd(
+        _mm_mul_pd(ocx, ocx), _mm_mul_pd(ocy, ocy)), _mm_mul_pd(ocz, ocz)), _mm_mul_pd(r, r));
+    __m128d discriminant = _mm_sub_pd(_mm_mul_pd(b, b), c);
+
+    const __m128d zero = _mm_setzero_pd();
+    __m128d entry = _mm_sub_pd(_mm_sub_pd(zero, b), _mm_sqrt_pd(_mm_max_pd(discriminant, zero)));
+
+    // starting inside counts as a hit at distance zero
+    __m128d inside = _mm_cmple_pd(c, zero);
+    entry = _mm_or_pd(_mm_and_pd(inside, zero), _mm_andnot_pd(inside, entry));
+
+    __m128d valid = _mm_and_pd(
+        _mm_cmpge_pd(discriminant, zero),
+        _mm_or_pd(inside, _mm_cmple_pd(b, zero)));
+    valid = _mm_and_pd(valid, _mm_cmple_pd(entry, _mm_set1_pd(maxDistance)));
+
+    _mm_storeu_pd(t, entry);
+    return (unsigned)_mm_movemask_pd(valid);
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < 2; i++) {
+        Vector3 oc(o.x - cx[i], o.y - cy[i], o.z - cz[i]);
+        real b = oc * d;
+        real c = oc * oc - radius[i] * radius[i];
+        real discriminant = b * b - c;
+        bool inside = c <= 0;
+        t[i] = inside ? 0 : -b - std::sqrt(std::fmax(discriminant, (real)0));
+        if (discriminant >= 0 && (inside || b <= 0) && t[i] <= maxDistance) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+/*
+* ray against a box grown by radius (rounded corners), in the box's frame
+* returns the distance, or a negative value on a miss
+*/
+static real castAgainstBox(const CollisionBox& box, const Vector3& origin, const Vector3& direction,
+    real maxDistance, real radius, Vector3* point, Vector3* normal) {
+    const Matrix4& transform = box.getTransform();
+    const Vector3& h = box.halfSize;
+
+    Vector3 o = transform.transformInverse(origin);
+    Vector3 d = transform.transformInverseDirection(direction);
+
+    const real oAxis[3] = { o.x, o.y, o.z };
+    const real dAxis[3] = { d.x, d.y, d.z };
+    const real hAxis[3] = { h.x + radius, h.y + radius, h.z + radius };
+
+    real entry = 0, exit = maxDistance;
+    int entryAxis = -1;
+    for (unsigned i = 0; i < 3; i++) {
+        if (std::abs(dAxis[i]) < 1e-12) {
+            if (std::abs(oAxis[i]) > hAxis[i]) return -1;
+            continue;
+        }
+        real inverse = 1 / dAxis[i];
+        real t0 = (-hAxis[i] - oAxis[i]) * inverse;
+        real t1 = (hAxis[i] - oAxis[i]) * inverse;
+        if (t0 > t1) std::swap(t0, t1);
+        if (t0 > entry) {
+            entry = t0;
+            entryAxis = (int)i;
+        }
+        exit = std::min(exit, t1);
+        if (entry > exit) return -1;
+    }
+
+    Vector3 localPoint, localNormal;
+    if (radius <= 0) {
+        // the slab entry is exact for a plain ray
+        localPoint = o + d * entry;
+        if (entryAxis < 0) {
+            localNormal = d * -1;
+        }
+        else {
+            real component[3] = { 0, 0, 0 };
+            component[entryAxis] = dAxis[entryAxis] > 0 ? -1 : 1;
+            localNormal = Vector3(component[0], component[1], component[2]);
+        }
+    }
+    else {
+        // walk from the slab entry onto the rounded surface
+        auto closestTo = [&h](const Vector3& p) {
+            return Vector3(std::clamp(p.x, -h.x, h.x), std::clamp(p.y, -h.y, h.y), std::clamp(p.z, -h.z, h.z));
+        };
+
+        Vector3 centre = o + d * entry;
+        localPoint = closestTo(centre);
+        real gap = (centre - localPoint).magnitude() - radius;
+        unsigned steps = 0;
+        while (gap > castTolerance) {
+            // every step stays short of the surface, so where the walk
+            // stops is a safe time of impact
+            if (++steps > maxCastSteps) break;
+            entry += gap;
+            if (entry > exit) return -1;
+            centre = o + d * entry;
+            localPoint = closestTo(centre);
+            gap = (centre - localPoint).magnitude() - radius;
+        }
+
+        localNormal = centre - localPoint;
+        if (localNormal.squareMagnitude() <= 0) localNormal = d * -1;
+        localNormal.normalize();
+    }
+
+    *point = transform.transform(localPoint);
+    *normal = transform.transformDirection(localNormal);
+    return entry;
+}
+
+bool CollisionQuery::castAgainstShapes(const Vector3& origin, const Vector3& direction, real maxDistance,
+    real radius, QueryHit* hit) const {
+    bool found = false;
+
+    for (const CollisionPlane* plane : planes) {
+        real approach = plane->direction * direction;
+        if (approach >= 0) continue;
+
+        real distance = plane->direction * origin - plane->offset;
+        if (distance < 0) continue; // behind a one sided plane
+
+        real t = std::max(distance - radius, (real)0) / -approach;
+        if (t > maxDistance) continue;
+
+        maxDistance = t;
+        hit->distance = t;
+        hit->normal = plane->direction;
+        hit->point = origin + direction * t - plane->direction * radius;
+        hit->primitive = nullptr;
+        hit->plane = plane;
+        found = true;
+    }
+
+    tree.raycast(origin, direction, maxDistance, radius,
+        [&](const unsigned* leafItems, unsigned count, real closest) {
+            // gather the spheres of the leaf so they can go through the kernel in pairs
+            real cx[BoundingVolumeTree::maxLeafSize + 1], cy[BoundingVolumeTree::maxLeafSize + 1];
+            real cz[BoundingVolumeTree::maxLeafSize + 1], r[BoundingVolumeTree::maxLeafSize + 1];
+            unsigned which[BoundingVolumeTree::maxLeafSize + 1];
+            unsigned sphereCount = 0;
+
+            for (unsigned i = 0; i < count; i++) {
+                unsigned item = leafItems[i];
+                if (shapes[item].kind == SPHERE) {
+                    cx[sphereCount] = sphereX[item];
+                    cy[sphereCount] = sphereY[item];
+                    cz[sphereCount] = sphereZ[item];
+                    r[sphereCount] = sphereRadius[item] + radius;
+                    which[sphereCount++] = item;
+                    continue;
+                }
+
+                Vector3 point, normal;
+                real t = castAgainstBox(*static_cast<const CollisionBox*>(shapes[item].primitive),
+                    origin, direction, closest, radius, &point, &normal);
+                if (t >= 0 && t <= closest) {
+                    closest = t;
+                    hit->distance = t;
+                    hit->point = point;
+                    hit->normal = normal;
+                    hit->primitive = shapes[item].primitive;
+                    hit->plane = nullptr;
+                    found = true;
+                }
+            }
+
+            // pad odd counts with a copy of the last sphere
+            if (sphereCount & 1) {
+                cx[sphereCount] = cx[sphereCount - 1]; cy[sphereCount] = cy[sphereCount - 1];
+                cz[sphereCount] = cz[sphereCount - 1]; r[sphereCount] = r[sphereCount - 1];
+                which[sphereCount] = which[sphereCount - 1];
+            }
+
+            for (unsigned i = 0; i < sphereCount; i += 2) {
+                real t[2];
+                unsigned mask = raycastSpherePair(origin, direction, closest, cx + i, cy + i, cz + i, r + i, t);
+                for (unsigned lane = 0; lane < 2; lane++) {
+                    if (!(mask & (1u << lane)) || t[lane] > closest) continue;
+
+                    unsigned item = which[i + lane];
+                    Vector3 centre(sphereX[item], sphereY[item], sphereZ[item]);
+                    Vector3 normal = origin + direction * t[lane] - centre;
+                    if (normal.squareMagnitude() <= 0) normal = direction * -1;
+                    normal.normalize();
+
+                    closest = t[lane];
+                    hit->distance = t[lane];
+                    hit->normal = normal;
+                    hit->point = centre + normal * sphereRadius[item];
+                    hit->primitive = shapes[item].primitive;
+                    hit->plane = nullptr;
+                    found = true;
+                }
+            }
+            return closest;
+        });
+
+    return found;
+}
+
+bool CollisionQuery::raycast(const Ray& ray, QueryHit* hit) const {
+    return sphereCast(ray, 0, hit);
+}
+
+bool CollisionQuery::sphereCast(const Ray& ray, real radius, QueryHit* hit) const {
+    hit->primitive = nullptr;
+    hit->plane = nullptr;
+    hit->distance = ray.maxDistance;
+
+    Vector3 direction = ray.direction;
+    if (direction.squareMagnitude() <= 0) return false;
+    direction.normalize();
+
+    return castAgainstShapes(ray.origin, direction, ray.maxDistance, radius, hit);
+}
+
+/*
+* separating axis test of an oriented box against an axis aligned one
+*/
+static bool boxOverlapsBounds(const CollisionBox& box, const BoundingBox& bounds) {
+    const Matrix4& t = box.getTransform();
+    Vector3 axes[3] = { t.getAxisVector(0), t.getAxisVector(1), t.getAxisVector(2) };
+    const Vector3 world[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+
+    Vector3 toCentre = Vector3(t.data[3], t.data[7], t.data[11]) - bounds.getCentre();
+    Vector3 half = bounds.getHalfSize();
+
+    auto separated = [&](Vector3 axis) {
+        if (axis.squareMagnitude() < 1e-8) return false;
+        real boundsProject = half.x * std::abs(axis.x) + half.y * std::abs(axis.y) + half.z * std::abs(axis.z);
+        real boxProject = box.halfSize.x * std::abs(axis * axes[0]) +
+            box.halfSize.y * std::abs(axis * axes[1]) +
+            box.halfSize.z * std::abs(axis * axes[2]);
+        return std::abs(toCentre * axis) > boundsProject + boxProject;
+    };
+
+    for (unsigned i = 0; i < 3; i++) {
+        if (separated(world[i]) || separated(axes[i])) return false;
+    }
+    for (unsigned i = 0; i < 3; i++) {
+        for (unsigned j = 0; j < 3; j++) {
+            if (separated(world[i] ^ axes[j])) return false;
+        }
+    }
+    return true;
+}
+
+unsigned CollisionQuery::overlap(const BoundingBox& query, const CollisionPrimitive** results, unsigned maxResults) const {
+    unsigned found = 0;
+    tree.overlap(query, [&](unsigned item) {
+        const Shape& shape = shapes[item];
+        bool touching;
+        if (shape.kind == SPHERE) {
+            Vector3 centre(sphereX[item], sphereY[item], sphereZ[item]);
+            Vector3 closest(
+                std::clamp(centre.x, query.min.x, query.max.x),
+                std::clamp(centre.y, query.min.y, query.max.y),
+                std::clamp(centre.z, query.min.z, query.max.z));
+            touching = (centre - closest).squareMagnitude() <= sphereRadius[item] * sphereRadius[item];
+        }
+        else {
+            touching = boxOverlapsBounds(*static_cast<const CollisionBox*>(shape.primitive), query);
+        }
+
+        if (!touching) return;
+        if (found < maxResults) results[found] = shape.primitive;
+        found++;
+    });
+    return found;
+}
+
+/*
+* spreads the lower 10 bits of v so there are two zero bits between each
+*/
+static inline uint32_t spreadBits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+unsigned CollisionQuery::raycastBatch(const Ray* rays, unsigned count, QueryHit* hits, ThreadPool& pool) const {
+    if (count == 0) return 0;
+
+    /*
+    * sort key: direction octant on top, then the morton code of the origin
+    * inside the tree bounds, so rays that start close and point the same
+    * way are traced one after another. the key has to fit the top 32 bits
+    * next to the ray index, so only the upper 29 of the 30 morton bits are
+    * kept below the 3 octant bits
+    */
+    BoundingBox area = tree.getBounds();
+    if (tree.isEmpty()) area.min = area.max = Vector3();
+    Vector3 extent = area.max - area.min;
+    Vector3 scale(
+        extent.x > 0 ? 1023 / extent.x : 0,
+        extent.y > 0 ? 1023 / extent.y : 0,
+        extent.z > 0 ? 1023 / extent.z : 0);
+
+    auto quantise = [](real v) {
+        return (uint32_t)std::clamp(v, (real)0, (real)1023);
+    };
+
+    std::vector<uint64_t> order(count);
+    for (unsigned i = 0; i < count; i++) {
+        const Ray& ray = rays[i];
+        uint32_t octant = (ray.direction.x < 0 ? 1 : 0) | (ray.direction.y < 0 ? 2 : 0) | (ray.direction.z < 0 ? 4 : 0);
+        uint32_t morton =
+            spreadBits(quantise((ray.origin.x - area.min.x) * scale.x)) |
+            (spreadBits(quantise((ray.origin.y - area.min.y) * scale.y)) << 1) |
+            (spreadBits(quantise((ray.origin.z - area.min.z) * scale.z)) << 2);
+        uint64_t key = ((uint64_t)octant << 29) | (morton >> 1);
+        order[i] = (key << 32) | i;
+    }
+    std::sort(order.begin(), order.end());
+
+    std::atomic<unsigned> hitCount(0);
+    pool.parallelFor(count, 64, [&](unsigned begin, unsigned end) {
+        unsigned local = 0;
+        for (unsigned i = begin; i < end; i++) {
+            unsigned index = (unsigned)(order[i] & 0xffffffffu);
+            if (raycast(rays[index], &hits[index])) local++;
+        }
+        hitCount.fetch_add(local, std::memory_order_relaxed);
+    });
+    return hitCount.load();
+}
@@ -0,0 +1,546 @@
+#include <cyclone/contacts.h>
+#include <cyclone/joints.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace cyclone;
+
+void Contact::setBodyData(RigidBody* one, RigidBody* two, real friction, real restitution) {
+	contact[0] = one;
+	contact[1] = two;
+	Contact::friction = friction;
+	Contact::restitution = restitution;
+}
+
+void Contact::matchAwakeState() {
+	// bodies have no sleep state yet, everything taking part in a contact is awake
+}
+
+void Contact::swapBodies() {
+	contactNormal *= -1;
+
+	RigidBody* temp = contact[0];
+	contact[0] = contact[1];
+	contact[1] = temp;
+}
+
+void Contact::calculateContactBasis() {
+	Vector3 contactTangent[2];
+
+	/*
+	* build an orthonormal basis with the contact normal as x axis
+	* we pick the world axis the normal is furthest from to cross with
+	*/
+	if (std::abs(contactNormal.x) > std::abs(contactNormal.y)) {
+		const real s = (real)1.0 / std::sqrt(contactNormal.z * contactNormal.z + contactNormal.x * contactNormal.x);
+
+		contactTangent[0].x = contactNormal.z * s;
+		contactTangent[0].y = 0;
+		contactTangent[0].z = -contactNormal.x * s;
+
+		contactTangent[1].x = contactNormal.y * contactTangent[0].x;
+		contactTangent[1].y = contactNormal.z * contactTangent[0].x - contactNormal.x * contactTangent[0].z;
+		contactTangent[1].z = -contactNormal.y * contactTangent[0].x;
+	}
+	else {
+		const real s = (real)1.0 / std::sqrt(contactNormal.z * contactNormal.z + contactNormal.y * contactNormal.y);
+
+		contactTangent[0].x = 0;
+		contactTangent[0].y = -contactNormal.z * s;
+		contactTangent[0].z = contactNormal.y * s;
+
+		contactTangent[1].x = contactNormal.y * contactTangent[0].z - contactNormal.z * contactTangent[0].y;
+		contactTangent[1].y = -contactNormal.x * contactTangent[0].z;
+		contactTangent[1].z = contactNormal.x * contactTangent[0].y;
+	}
+
+	contactToWorld.setComponents(contactNormal, contactTangent[0], contactTangent[1]);
+}
+
+Vector3 Contact::calculateLocalVelocity(unsigned bodyIndex, real duration) {
+	RigidBody* thisBody = contact[bodyIndex];
+
+	// velocity of the contact point
+	Vector3 velocity = thisBody->getRotation() ^ relativeContactPosition[bodyIndex];
+	velocity += thisBody->getVelocity();
+
+	Vector3 localVelocity = contactToWorld.transformTranspose(velocity);
+
+	/*
+	* velocity due to forces without reactions, only the planar part is kept
+	* so friction can remove it
+	*/
+	Vector3 accVelocity = thisBody->getLastFrameAccelaration() * duration;
+	accVelocity = contactToWorld.transformTranspose(accVelocity);
+	accVelocity.x = 0;
+
+	localVelocity += accVelocity;
+
+	return localVelocity;
+}
+
+void Contact::calculateDesiredDeltaVelocity(real duration) {
+	const static real velocityLimit = (real)0.25f;
+
+	/*
+	* speculative contact: the bodies may approach until the gap is closed
+	* only the closing speed that would overshoot the gap is removed
+	*/
+	if (penetration < 0) {
+		real allowedClosing = contactVelocity.x - penetration / duration;
+		desiredDeltaVelocity = allowedClosing < 0 ? -allowedClosing : 0;
+		return;
+	}
+
+	// velocity built up by acceleration in the last frame
+	real velocityFromAcc = contact[0]->getLastFrameAccelaration() * duration * contactNormal;
+
+	if (contact[1]) {
+		velocityFromAcc -= contact[1]->getLastFrameAccelaration() * duration * contactNormal;
+	}
+
+	// very slow contacts do not bounce, stops resting objects from jittering
+	real thisRestitution = restitution;
+	if (std::abs(contactVelocity.x) < velocityLimit) {
+		thisRestitution = (real)0.0f;
+	}
+
+	desiredDeltaVelocity = -contactVelocity.x - thisRestitution * (contactVelocity.x - velocityFromAcc);
+}
+
+void Contact::calculateInternals(real duration) {
+	// static bodies never move, so they are resolved as scenery
+	if (contact[0] && contact[0]->isStatic()) contact[0] = nullptr;
+	if (contact[1] && contact[1]->isStatic()) contact[1] = nullptr;
+
+	// scenery, then kinematic bodies, are always stored as the second body
+	if (!contact[0] || (contact[1] && !contact[0]->isDynamic() && contact[1]->isDynamic())) swapBodies();
+
+	// nothing here can move, the contact is left for the resolver to skip
+	if (!contact[0] || !contact[0]->isDynamic()) {
+		contact[0] = contact[1] = nullptr;
+		penetration = 0;
+		desiredDeltaVelocity = 0;
+		return;
+	}
+
+	calculateContactBasis();
+
+	relativeContactPosition[0] = contactPoint - contact[0]->getPosition();
+	if (contact[1]) {
+		relativeContactPosition[1] = contactPoint - contact[1]->getPosition();
+	}
+
+	contactVelocity = calculateLocalVelocity(0, duration);
+	if (contact[1]) {
+		contactVelocity -= calculateLocalVelocity(1, duration);
+	}
+
+	calculateDesiredDeltaVelocity(duration);
+}
+
+void Contact::applyVelocityChange(Vector3 velocityChange[2], Vector3 rotationChange[2]) {
+	Matrix3 inverseInertiaTensor[2];
+	contact[0]->getInertiaTensorWorld(&inverseInertiaTensor[0]);
+	if (contact[1]) {
+		contact[1]->getInertiaTensorWorld(&inverseInertiaTensor[1]);
+	}
+
+	Vector3 impulseContact;
+	if (friction == (real)0.0) {
+		impulseContact = calculateFrictionlessImpulse(inverseInertiaTensor);
+	}
+	else {
+		impulseContact = calculateFrictionImpulse(inverseInertiaTensor);
+	}
+
+	// convert impulse to world coordinates
+	Vector3 impulse = contactToWorld * impulseContact;
+
+	// split the impulse into linear and rotational components
+	Vector3 impulsiveTorque = relativeContactPosition[0] ^ impulse;
+	rotationChange[0] = inverseInertiaTensor[0] * impulsiveTorque;
+	velocityChange[0] = impulse * contact[0]->getInverseMass();
+
+	contact[0]->addVelocity(velocityChange[0]);
+	contact[0]->addRotation(rotationChange[0]);
+
+	if (contact[1]) {
+		impulsiveTorque = impulse ^ relativeContactPosition[1];
+		rotationChange[1] = inverseInertiaTensor[1] * impulsiveTorque;
+		velocityChange[1] = impulse * -contact[1]->getInverseMass();
+
+		contact[1]->addVelocity(velocityChange[1]);
+		contact[1]->addRotation(rotationChange[1]);
+	}
+}
+
+Vector3 Contact::calculateFrictionlessImpulse(Matrix3* inverseInertiaTensor) {
+	// velocity change along the normal per unit impulse
+	Vector3 deltaVelWorld = relativeContactPosition[0] ^ contactNormal;
+	deltaVelWorld = inverseInertiaTensor[0] * deltaVelWorld;
+	deltaVelWorld = deltaVelWorld ^ relativeContactPosition[0];
+
+	real deltaVelocity = deltaVelWorld * contactNormal;
+	deltaVelocity += contact[0]->getInverseMass();
+
+	if (contact[1]) {
+		deltaVelWorld = relativeContactPosition[1] ^ contactNormal;
+		deltaVelWorld = inverseInertiaTensor[1] * deltaVelWorld;
+		deltaVelWorld = deltaVelWorld ^ relativeContactPosition[1];
+
+		deltaVelocity += deltaVelWorld * contactNormal;
+		deltaVelocity += contact[1]->getInverseMass();
+	}
+
+	return Vector3(desiredDeltaVelocity / deltaVelocity, 0, 0);
+}
+
+Vector3 Contact::calculateFrictionImpulse(Matrix3* inverseInertiaTensor) {
+	real inverseMass = contact[0]->getInverseMass();
+
+	/*
+	* the equivalent of a cross product in matrices is multiplication
+	* by a skew symmetric matrix
+	*/
+	Matrix3 impulseToTorque;
+	impulseToTorque.setSkewSymmetric(relativeContactPosition[0]);
+
+	// change in velocity in world coordinates per unit impulse
+	Matrix3 deltaVelWorld = impulseToTorque;
+	deltaVelWorld = deltaVelWorld * inverseInertiaTensor[0];
+	deltaVelWorld = deltaVelWorld * impulseToTorque;
+	deltaVelWorld *= -1;
+
+	if (contact[1]) {
+		impulseToTorque.setSkewSymmetric(relativeContactPosition[1]);
+
+		Matrix3 deltaVelWorld2 = impulseToTorque;
+		deltaVelWorld2 = deltaVelWorld2 * inverseInertiaTensor[1];
+		deltaVelWorld2 = deltaVelWorld2 * impulseToTorque;
+		deltaVelWorld2 *= -1;
+
+		deltaVelWorld += deltaVelWorld2;
+		inverseMass += contact[1]->getInverseMass();
+	}
+
+	// change of basis into contact coordinates
+	Matrix3 deltaVelocity = contactToWorld.transpose();
+	deltaVelocity = deltaVelocity * deltaVelWorld;
+	deltaVelocity = deltaVelocity * contactToWorld;
+
+	// add in the linear velocity change
+	deltaVelocity.data[0] += inverseMass;
+	deltaVelocity.data[4] += inverseMass;
+	deltaVelocity.data[8] += inverseMass;
+
+	Matrix3 impulseMatrix = deltaVelocity.inverse();
+
+	// velocities to kill
+	Vector3 velKill(desiredDeltaVelocity, -contactVelocity.y, -contactVelocity.z);
+
+	Vector3 impulseContact = impulseMatrix * velKill;
+
+	// check for exceeding friction
+	real planarImpulse = std::sqrt(impulseContact.y * impulseContact.y + impulseContact.z * impulseContact.z);
+
+	if (planarImpulse > impulseContact.x * friction) {
+		// dynamic friction
+		impulseContact.y /= planarImpulse;
+		impulseContact.z /= planarImpulse;
+
+		impulseContact.x = deltaVelocity.data[0] +
+			deltaVelocity.data[1] * friction * impulseContact.y +
+			deltaVelocity.data[2] * friction * impulseContact.z;
+		impulseContact.x = desiredDeltaVelocity / impulseContact.x;
+		impulseContact.y *= friction * impulseContact.x;
+		impulseContact.z *= friction * impulseContact.x;
+	}
+
+	return impulseContact;
+}
+
+void Contact::applyPositonChange(Vector3 linearChange[2], Vector3 angularChange[2]) {
+	const real angularLimit = (real)0.2f;
+	real angularMove[2];
+	real linearMove[2];
+
+	real totalInertia = 0;
+	real linearInertia[2];
+	real angularInertia[2];
+
+	// work out the inertia of each body in the direction of the contact normal
+	for (unsigned i = 0; i < 2; i++) if (contact[i]) {
+		Matrix3 inverseInertiaTensor;
+		contact[i]->getInertiaTensorWorld(&inverseInertiaTensor);
+
+		Vector3 angularInertiaWorld = relativeContactPosition[i] ^ contactNormal;
+		angularInertiaWorld = inverseInertiaTensor * angularInertiaWorld;
+		angularInertiaWorld = angularInertiaWorld ^ relativeContactPosition[i];
+		angularInertia[i] = angularInertiaWorld * contactNormal;
+
+		linearInertia[i] = contact[i]->getInverseMass();
+
+		totalInertia += linearInertia[i] + angularInertia[i];
+	}
+
+	if (totalInertia <= 0) {
+		linearChange[0] = linearChange[1] = Vector3();
+		angularChange[0] = angularChange[1] = Vector3();
+		return;
+	}
+
+	for (unsigned i = 0; i < 2; i++) if (contact[i]) {
+		// a kinematic second body holds its ground
+		if (!contact[i]->isDynamic()) {
+			linearChange[i] = angularChange[i] = Vector3();
+			continue;
+		}
+
+		// the second body moves in the opposite direction
+		real sign = (i == 0) ? 1 : -1;
+		angularMove[i] = sign * penetration * (angularInertia[i] / totalInertia);
+		linearMove[i] = sign * penetration * (linearInertia[i] / totalInertia);
+
+		// limit the angular move to avoid projections that are too great
+		Vector3 projection = relativeContactPosition[i];
+		projection.addScaledVector(contactNormal, -(relativeContactPosition[i] * contactNormal));
+
+		real maxMagnitude = angularLimit * projection.magnitude();
+
+		if (angularMove[i] < -maxMagnitude) {
+			real totalMove = angularMove[i] + linearMove[i];
+			angularMove[i] = -maxMagnitude;
+			linearMove[i] = totalMove - angularMove[i];
+		}
+		else if (angularMove[i] > maxMagnitude) {
+			real totalMove = angularMove[i] + linearMove[i];
+			angularMove[i] = maxMagnitude;
+			linearMove[i] = totalMove - angularMove[i];
+		}
+
+		// work out the rotation needed to achieve the angular move
+		if (angularMove[i] == 0) {
+			angularChange[i] = Vector3();
+		}
+		else {
+			Vector3 targetAngularDirection = relativeContactPosition[i] ^ contactNormal;
+
+			Matrix3 inverseInertiaTensor;
+			contact[i]->getInertiaTensorWorld(&inverseInertiaTensor);
+
+			angularChange[i] = (inverseInertiaTensor * targetAngularDirection) * (angularMove[i] / angularInertia[i]);
+		}
+
+		linearChange[i] = contactNormal * linearMove[i];
+
+		Vector3 pos = contact[i]->getPosition();
+		pos.addScaledVector(contactNormal, linearMove[i]);
+		contact[i]->setPosition(pos);
+
+		Quaternion q = contact[i]->getOrientation();
+		q.addScaledVector(angularChange[i], (real)1.0);
+		contact[i]->setOrientation(q);
+
+		contact[i]->calculateDerivedData();
+	}
+}
+
+ContactResolver::ContactResolver(unsigned iterations, real velocityEpsilon, real positionEpsilon)
+	: velocityIterationsUsed(0), positionIterationsUsed(0),
+	velocityEpsilon(velocityEpsilon), positionEpsilon(positionEpsilon) {
+	setIterations(iterations, iterations);
+}
+
+ContactResolver::ContactResolver(unsigned velocityIterations, unsigned positionIterations, real velocityEpsilon, real positionEpsilon)
+	: velocityIterationsUsed(0), positionIterationsUsed(0),
+	velocityEpsilon(velocityEpsilon), positionEpsilon(positionEpsilon) {
+	setIterations(velocityIterations, positionIterations);
+}
+
+void ContactResolver::setIterations(unsigned velocityIterations, unsigned positionIterations) {
+	ContactResolver::velocityIterations = velocityIterations;
+	ContactResolver::positionIterations = positionIterations;
+}
+
+void ContactResolver::setJoints(JointSet* joints) {
+	ContactResolver::joints = joints;
+}
+
+void ContactResolver::resolveContacts(Contact* contacts, unsigned numContacts, real duration) {
+	if (numContacts == 0 && (!joints || joints->size() == 0)) return;
+
+	prepareContacts(contacts, numContacts, duration);
+
+	adjustPositions(contacts, numContacts, duration);
+
+	// joints take the bodies where the contacts left them
+	if (joints) joints->prepare(duration);
+
+	adjustVelocities(contacts, numContacts, duration);
+}
+
+void ContactResolver::prepareContacts(Contact* contacts, unsigned numContacts, real duration) {
+	Contact* lastContact = contacts + numContacts;
+	for (Contact* contact = contacts; contact < lastContact; contact++) {
+		contact->calculateInternals(duration);
+	}
+}
+
+void ContactResolver::adjustVelocities(Contact* c, unsigned numContacts, real duration) {
+	Vector3 velocityChange[2], rotationChange[2];
+	Vector3 deltaVel;
+
+	bool jointed = joints && joints->size() > 0;
+	unsigned rounds = jointed && joints->getIterations() > 1 ? joints->getIterations() : 1;
+
+	velocityIterationsUsed = 0;
+	for (unsigned round = 0; round < rounds; round++) {
+		if (jointed) {
+			joints->solveVelocities();
+			updateContactVelocities(c, numContacts, duration);
+		}
+
+		// iteratively handle the contact with the largest closing velocity
+		unsigned limit = velocityIterations * (round + 1) / rounds;
+		while (velocityIterationsUsed < limit) {
+			real max = velocityEpsilon;
+			unsigned index = numContacts;
+			for (unsigned i = 0; i < numContacts; i++) {
+				if (c[i].desiredDeltaVelocity > max) {
+					max = c[i].desiredDeltaVelocity;
+					index = i;
+				}
+			}
+			if (index == numContacts) break;
+
+			c[index].matchAwakeState();
+
+			c[index].applyVelocityChange(velocityChange, rotationChange);
+
+			// the change may alter the closing velocities of contacts sharing a body
+			for (unsigned i = 0; i < numContacts; i++) {
+				for (unsigned b = 0; b < 2; b++) if (c[i].contact[b]) {
+					for (unsigned d = 0; d < 2; d++) {
+						if (c[i].contact[b] == c[index].contact[d]) {
+							deltaVel = velocityChange[d] + (rotationChange[d] ^ c[i].relativeContactPosition[b]);
+
+							// the sign is negative for the second body
+							c[i].contactVelocity += c[i].contactToWorld.transformTranspose(deltaVel) * (b ? -1 : 1);
+							c[i].calculateDesiredDeltaVelocity(duration);
+						}
+					}
+				}
+			}
+			velocityIterationsUsed++;
+		}
+	}
+}
+
+void ContactResolver::updateContactVelocities(Contact* c, unsigned numContacts, real duration) {
+	for (unsigned i = 0; i < numContacts; i++) {
+		if (!c[i].contact[0]) continue;
+
+		c[i].contactVelocity = c[i].calculateLocalVelocity(0, duration);
+		if (c[i].contact[1]) {
+			c[i].contactVelocity -= c[i].calculateLocalVelocity(1, duration);
+		}
+		c[i].calculateDesiredDeltaVelocity(duration);
+	}
+}
+
+void ContactResolver::adjustPositions(Contact* c, unsigned numContacts, real duration) {
+	Vector3 linearChange[2], angularChange[2];
+	Vector3 deltaPosition;
+
+	// iteratively resolve the deepest interpenetration
+	positionIterationsUsed = 0;
+	while (positionIterationsUsed < positionIterations) {
+		real max = positionEpsilon;
+		unsigned index = numContacts;
+		for (unsigned i = 0; i < numContacts; i++) {
+			if (c[i].penetration > max) {
+				max = c[i].penetration;
+				index = i;
+			}
+		}
+		if (index == numContacts) break;
+
+		c[index].matchAwakeState();
+
+		c[index].applyPositonChange(linearChange, angularChange);
+
+		// the move may have changed the penetration of other contacts
+		for (unsigned i = 0; i < numContacts; i++) {
+			for (unsigned b = 0; b < 2; b++) if (c[i].contact[b]) {
+				for (unsigned d = 0; d < 2; d++) {
+					if (c[i].contact[b] == c[index].contact[d]) {
+						deltaPosition = linearChange[d] + (angularChange[d] ^ c[i].relativeContactPosition[b]);
+
+						c[i].penetration += (deltaPosition * c[i].contactNormal) * (b ? 1 : -1);
+					}
+				}
+			}
+		}
+		positionIterationsUsed++;
+	}
+}
+
+namespace {
+	// words in the sort key of a contact
+	const unsigned keyWords = 13;
+
+	uint64_t realBits(real value) {
+		uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	/*
+	* the sort key of a contact as raw bits, equal keys mean equal contacts
+	*/
+	void makeKey(const Contact& contact, uint64_t* key) {
+		unsigned n = 0;
+		for (unsigned i = 0; i < 2; i++) {
+			// scenery sorts after any body
+			Vector3 position = contact.contact[i] ? contact.contact[i]->getPosition() : Vector3();
+			key[n++] = contact.contact[i] ? realBits(position.x) : UINT64_MAX;
+			key[n++] = realBits(position.y);
+			key[n++] = realBits(position.z);
+		}
+		key[n++] = realBits(contact.contactPoint.x);
+		key[n++] = realBits(contact.contactPoint.y);
+		key[n++] = realBits(contact.contactPoint.z);
+		key[n++] = realBits(contact.contactNormal.x);
+		key[n++] = realBits(contact.contactNormal.y);
+		key[n++] = realBits(contact.contactNormal.z);
+		key[n++] = realBits(contact.penetration);
+	}
+}
+
+void ContactResolver::sortContacts(Contact* contactArray, unsigned numContacts) {
+	sortKeys.resize(numContacts * keyWords);
+	sortOrder.resize(numContacts);
+	for (unsigned i = 0; i < numContacts; i++) {
+		makeKey(contactArray[i], &sortKeys[i * keyWords]);
+		sortOrder[i] = i;
+	}
+
+	// equal keys keep their index order, which std::sort does without a buffer
+	const uint64_t* keys = sortKeys.data();
+	std::sort(sortOrder.begin(), sortOrder.end(), [keys](unsigned a, unsigned b) {
+		const uint64_t* ka = keys + a * keyWords;
+		const uint64_t* kb = keys + b * keyWords;
+		for (unsigned w = 0; w < keyWords; w++) {
+			if (ka[w] != kb[w]) return ka[w] < kb[w];
+		}
+		return a < b;
+	});
+
+	sortScratch.assign(contactArray, contactArray + numContacts);
+	for (unsigned i = 0; i < numContacts; i++) contactArray[i] = sortScratch[sortOrder[i]];
+}
@@ -0,0 +1,263 @@
+#include <cyclone/fgen.h>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace cyclone;
+
+void Gravity::compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const {
+	*torque = Vector3();
+	*force = body.hasFiniteMass() ? gravity * body.getMass() : Vector3();
+}
+
+void Gravity::updateForce(RigidBody* body, real duration) {
+	Vector3 force, torque;
+	compute(*body, duration, &force, &torque);
+	body->addForce(force);
+}
+
+void Drag::compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const {
+	*torque = Vector3();
+
+	Vector3 velocity = body.getVelocity();
+	real speed = velocity.magnitude();
+	if (speed <= 0) {
+		*force = Vector3();
+		return;
+	}
+
+	real dragCoeff = k1 * speed + k2 * speed * speed;
+	*force = velocity * (-dragCoeff / speed);
+}
+
+void Drag::updateForce(RigidBody* body, real duration) {
+	Vector3 force, torque;
+	compute(*body, duration, &force, &torque);
+	body->addForce(force);
+}
+
+void Spring::compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const {
+	Vector3 lws = body.getPointInWorldSpace(connectionPoint);
+	Vector3 ows = other->getPointInWorldSpace(otherConnectionPoint);
+
+	Vector3 stretch = lws - ows;
+	real length = stretch.magnitude();
+	if (length <= 0) {
+		*force = *torque = Vector3();
+		return;
+	}
+
+	*force = stretch * (-springConstant * (length - restLength) / length);
+	*torque = (lws - body.getPosition()) ^ *force;
+}
+
+void Spring::updateForce(RigidBody* body, real duration) {
+	Vector3 force, torque;
+	compute(*body, duration, &force, &torque);
+	body->addForce(force);
+	body->addTorque(torque);
+}
+
+void Buoyancy::compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const {
+	*force = *torque = Vector3();
+
+	Vector3 centre = body.getPointInWorldSpace(centreOfBuoyancy);
+	real depth = centre.y;
+
+	// out of the liquid
+	if (depth >= waterHeight + maxDepth) return;
+
+	// the part of the volume under the surface
+	real submerged = 1;
+	if (depth > waterHeight - maxDepth && maxDepth > 0) {
+		submerged = (waterHeight + maxDepth - depth) / (2 * maxDepth);
+	}
+
+	force->y = liquidDensity * volume * gravity * submerged;
+	*torque = (centre - body.getPosition()) ^ *force;
+}
+
+void Buoyancy::updateForce(RigidBody* body, real duration) {
+	Vector3 force, torque;
+	compute(*body, duration, &force, &torque);
+	body->addForce(force);
+	body->addTorque(torque);
+}
+
+void Aero::compute(const RigidBody& body, real duration, Vector3* force, Vector3* torque) const {
+	Vector3 velocity = body.getVelocity();
+	if (windspeed) velocity += *windspeed;
+
+	// the tensor works in body space
+	Vector3 bodyVelocity = body.getDirectionInLocalSpace(velocity);
+	Vector3 bodyForce = tensor * bodyVelocity;
+
+	*force = body.getDirectionInWorldSpace(bodyForce);
+	*torque = (body.getPointInWorldSpace(position) - body.getPosition()) ^ *force;
+}
+
+void Aero::updateForce(RigidBody* body, real duration) {
+	Vector3 force, torque;
+	compute(*body, duration, &force, &torque);
+	body->addForce(force);
+	body->addTorque(torque);
+}
+
+void AeroControl::setControl(real value) {
+	control = std::clamp(value, (real)-1, (real)1);
+
+	// blend from the base tensor towards the tensor at the end of the travel
+	const Matrix3& end = control < 0 ? minTensor : maxTensor;
+	real weight = std::abs(control);
+	for (unsigned i = 0; i < 9; i++) {
+		tensor.data[i] = baseTensor.data[i] * (1 - weight) + end.data[i] * weight;
+	}
+}
+
+void ForceRegistry::add(RigidBody* body, ForceGenerator* fg) {
+	others.push_back({ body, fg });
+}
+
+void ForceRegistry::add(RigidBody* body, Gravity* fg) {
+	gravity.push_back({ body, fg });
+	prepared = false;
+}
+
+void ForceRegistry::add(RigidBody* body, Drag* fg) {
+	drag.push_back({ body, fg });
+	prepared = false;
+}
+
+void ForceRegistry::add(RigidBody* body, Spring* fg) {
+	springs.push_back({ body, fg });
+	prepared = false;
+}
+
+void ForceRegistry::add(RigidBody* body, Buoyancy* fg) {
+	buoyancy.push_back({ body, fg });
+	prepared = false;
+}
+
+void ForceRegistry::add(RigidBody* body, Aero* fg) {
+	aero.push_back({ body, fg });
+	prepared = false;
+}
+
+template <typename Generator>
+void ForceRegistry::removeFrom(Registry<Generator>& registry, RigidBody* body, ForceGenerator* fg) {
+	auto it = std::remove_if(registry.begin(), registry.end(),
+		[body, fg](const Registration<Generator>& entry) {
+			return entry.body == body && (!fg || static_cast<ForceGenerator*>(entry.fg) == fg); });
+
+	registry.erase(it, registry.end());
+}
+
+void ForceRegistry::remove(RigidBody* body, ForceGenerator* fg) {
+	removeFrom(gravity, body, fg);
+	removeFrom(drag, body, fg);
+	removeFrom(springs, body, fg);
+	removeFrom(buoyancy, body, fg);
+	removeFrom(aero, body, fg);
+	removeFrom(others, body, fg);
+	prepared = false;
+}
+
+void ForceRegistry::remove(RigidBody* body) {
+	remove(body, nullptr);
+}
+
+void ForceRegistry::clear() {
+	gravity.clear();
+	drag.clear();
+	springs.clear();
+	buoyancy.clear();
+	aero.clear();
+	others.clear();
+	prepared = false;
+}
+
+unsigned ForceRegistry::size() const {
+	return (unsigned)(gravity.size() + drag.size() + springs.size() + buoyancy.size() + aero.size() + others.size());
+}
+
+void ForceRegistry::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+void ForceRegistry::prepare() {
+	if (prepared) return;
+	prepared = true;
+
+	bodies.clear();
+	slotBody.clear();
+
+	// give every body an index, in the order they were first registered
+	std::unordered_map<RigidBody*, unsigned> indices;
+	auto collect = [this, &indices](RigidBody* body) {
+		auto found = indices.emplace(body, (unsigned)bodies.size());
+		if (found.second) bodies.push_back(body);
+		slotBody.push_back(found.first->second);
+	};
+	for (const auto& entry : gravity) collect(entry.body);
+	for (const auto& entry : drag) collect(entry.body);
+	for (const auto& entry : springs) collect(entry.body);
+	for (const auto& entry : buoyancy) collect(entry.body);
+	for (const auto& entry : aero) collect(entry.body);
+
+	unsigned slotCount = (unsigned)slotBody.size();
+	forces.resize(slotCount);
+	torques.resize(slotCount);
+
+	// the slots of each body, in slot order
+	bodyStart.assign(bodies.size() + 1, 0);
+	for (unsigned s = 0; s < slotCount; s++) bodyStart[slotBody[s] + 1]++;
+	for (unsigned b = 0; b < bodies.size(); b++) bodyStart[b + 1] += bodyStart[b];
+
+	bodySlots.resize(slotCount);
+	std::vector<unsigned> fill(bodyStart.begin(), bodyStart.end() - 1);
+	for (unsigned s = 0; s < slotCount; s++) bodySlots[fill[slotBody[s]]++] = s;
+}
+
+template <typename Generator>
+void ForceRegistry::computeBatch(const Registry<Generator>& registry, unsigned first, real duration) {
+	parallelFor(pool, (unsigned)registry.size(), 256, [this, &registry, first, duration](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			const Registration<Generator>& entry = registry[i];
+			entry.fg->compute(*entry.body, duration, &forces[first + i], &torques[first + i]);
+		}
+	});
+}
+
+void ForceRegistry::updateForces(real duration) {
+	prepare();
+
+	// one loop per generator type, each registration fills its own slot
+	unsigned first = 0;
+	computeBatch(gravity, first, duration);
+	first += (unsigned)gravity.size();
+	computeBatch(drag, first, duration);
+	first += (unsigned)drag.size();
+	computeBatch(springs, first, duration);
+	first += (unsigned)springs.size();
+	computeBatch(buoyancy, first, duration);
+	first += (unsigned)buoyancy.size();
+	computeBatch(aero, first, duration);
+
+	// each body adds up its slots in a fixed order
+	parallelFor(pool, (unsigned)bodies.size(), 64, [this](unsigned begin, unsigned end) {
+		for (unsigned b = begin; b < end; b++) {
+			Vector3 force, torque;
+			for (unsigned i = bodyStart[b]; i < bodyStart[b + 1]; i++) {
+				force += forces[bodySlots[i]];
+				torque += torques[bodySlots[i]];
+			}
+			bodies[b]->addForce(force);
+			bodies[b]->addTorque(torque);
+		}
+	});
+
+	for (auto& registration : others) {
+		registration.fg->updateForce(registration.body, duration);
+	}
+}
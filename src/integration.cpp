@@ -0,0 +1,84 @@
+#include <cyclone/integration.h>
+#include <cmath>
+
+using namespace cyclone;
+
+IntegrationContext::IntegrationContext(DampingMode mode) : mode(mode) {
+	entries.reserve(maxEntries);
+}
+
+void IntegrationContext::setMode(DampingMode newMode) {
+	if (newMode == mode) return;
+	mode = newMode;
+	clear();
+}
+
+IntegrationContext::DampingMode IntegrationContext::getMode() const {
+	return mode;
+}
+
+void IntegrationContext::beginStep(real newDuration) {
+	// exact factors are only valid for the step length they were made for
+	if (mode == DAMPING_EXACT && newDuration != duration) entries.clear();
+	previousDuration = duration;
+	duration = newDuration;
+}
+
+void IntegrationContext::clear() {
+	entries.clear();
+	lastHit = 0;
+}
+
+real IntegrationContext::lookup(real damping) {
+	// objects are usually integrated in runs with the same damping
+	if (lastHit < entries.size() && entries[lastHit].damping == damping) return entries[lastHit].value;
+
+	for (unsigned i = 0; i < entries.size(); i++) {
+		if (entries[i].damping == damping) {
+			lastHit = i;
+			return entries[i].value;
+		}
+	}
+
+	real value = mode == DAMPING_EXACT ? std::pow(damping, duration) : std::log(damping);
+	if (entries.size() < maxEntries) {
+		lastHit = (unsigned)entries.size();
+		entries.push_back(Entry{ damping, value });
+	}
+	return value;
+}
+
+real IntegrationContext::dampingFactor(real damping) {
+	real value = lookup(damping);
+	return mode == DAMPING_EXACT ? value : approximateExp(value * duration);
+}
+
+void IntegrationContext::rotate(Quaternion* orientation, const Vector3& rotation) const {
+	if (rotationScheme == ROTATE_LINEAR) {
+		orientation->addScaledVector(rotation, duration);
+		return;
+	}
+
+	real speed = rotation.magnitude();
+	real halfAngle = speed * duration * 0.5;
+	if (halfAngle <= 0) return;
+
+	real scale = std::sin(halfAngle) / speed;
+	Quaternion step(std::cos(halfAngle), rotation.x * scale, rotation.y * scale, rotation.z * scale);
+	step *= *orientation;
+	*orientation = step;
+}
+
+real IntegrationContext::approximateExp(real x) {
+	if (x < -700) return 0;
+	if (x > 700) return HUGE_VAL;
+
+	// e^x = 2^n * e^r with |r| <= ln(2) / 2
+	const real ln2 = 0.6931471805599453;
+	real n = std::floor(x * 1.4426950408889634 + 0.5);
+	real r = x - n * ln2;
+
+	// taylor series to the 6th power, good to about 1e-7 on the reduced range
+	real p = 1 + r * (1 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120 + r * (1.0 / 720))))));
+	return std::ldexp(p, (int)n);
+}
@@ -0,0 +1,392 @@
+#include <cyclone/joints.h>
+
+#include <cmath>
+
+using namespace cyclone;
+
+namespace {
+	// a null body is the world, its local space is world space
+	Vector3 pointOf(const RigidBody* body, const Vector3& local) {
+		return body ? body->getPointInWorldSpace(local) : local;
+	}
+
+	Vector3 directionOf(const RigidBody* body, const Vector3& local) {
+		return body ? body->getDirectionInWorldSpace(local) : local;
+	}
+
+	Vector3 centreOf(const RigidBody* body) {
+		return body ? body->getPosition() : Vector3();
+	}
+
+	Quaternion orientationOf(const RigidBody* body) {
+		return body ? body->getOrientation() : Quaternion();
+	}
+
+	Quaternion conjugate(const Quaternion& q) {
+		return Quaternion(q.r, -q.i, -q.j, -q.k);
+	}
+
+	Vector3 velocityAt(const RigidBody* body, const Vector3& arm) {
+		return body ? body->getVelocity() + (body->getRotation() ^ arm) : Vector3();
+	}
+
+	Vector3 angularVelocityOf(const RigidBody* body) {
+		return body ? body->getRotation() : Vector3();
+	}
+
+	// the joint pulls body 1 by the impulse and body 0 by its opposite
+	void applyImpulse(RigidBody* body, real inverseMass, const Matrix3& inverseInertia, const Vector3& arm, const Vector3& impulse) {
+		if (!body) return;
+		body->addVelocity(impulse * inverseMass);
+		body->addRotation(inverseInertia * (arm ^ impulse));
+	}
+
+	void applyAngularImpulse(RigidBody* body, const Matrix3& inverseInertia, const Vector3& impulse) {
+		if (!body) return;
+		body->addRotation(inverseInertia * impulse);
+	}
+
+	/*
+	* two axes at right angles to the given one and to each other
+	*/
+	void makeAcross(const Vector3& axis, Vector3 across[2]) {
+		Vector3 other = std::abs(axis.x) < (real)0.6 ? Vector3(1, 0, 0) : Vector3(0, 1, 0);
+		across[0] = axis ^ other;
+		across[0].normalize();
+		across[1] = axis ^ across[0];
+	}
+
+	// m - [r] I [r], the inertia a point at r adds to the effective mass
+	void addPointInertia(Matrix3& mass, const Matrix3& inverseInertia, const Vector3& arm) {
+		Matrix3 skew;
+		skew.setSkewSymmetric(arm);
+		Matrix3 term = skew * inverseInertia * skew;
+		term *= -1;
+		mass += term;
+	}
+}
+
+JointSet::JointSet(unsigned iterations) : iterations(iterations) {}
+
+unsigned JointSet::addBall(RigidBody* one, RigidBody* two, const Vector3& anchor) {
+	BallJoint joint = {};
+	joint.body[0] = one;
+	joint.body[1] = two;
+	initPoint(joint.point, joint.body, anchor);
+	balls.push_back(joint);
+	return (unsigned)balls.size() - 1;
+}
+
+unsigned JointSet::addHinge(RigidBody* one, RigidBody* two, const Vector3& anchor, const Vector3& axis) {
+	HingeJoint joint = {};
+	joint.body[0] = one;
+	joint.body[1] = two;
+	initPoint(joint.point, joint.body, anchor);
+
+	Vector3 unit = axis;
+	unit.normalize();
+	for (unsigned i = 0; i < 2; i++) {
+		joint.hinge.localAxis[i] = joint.body[i] ? joint.body[i]->getDirectionInLocalSpace(unit) : unit;
+	}
+	hinges.push_back(joint);
+	return (unsigned)hinges.size() - 1;
+}
+
+unsigned JointSet::addSlider(RigidBody* one, RigidBody* two, const Vector3& anchor, const Vector3& axis) {
+	SliderJoint joint = {};
+	joint.body[0] = one;
+	joint.body[1] = two;
+	initLock(joint.lock, joint.body);
+
+	Vector3 unit = axis;
+	unit.normalize();
+	for (unsigned i = 0; i < 2; i++) {
+		joint.slide.localAnchor[i] = joint.body[i] ? joint.body[i]->getPointInLocalSpace(anchor) : anchor;
+	}
+	joint.slide.localAxis = one ? one->getDirectionInLocalSpace(unit) : unit;
+	sliders.push_back(joint);
+	return (unsigned)sliders.size() - 1;
+}
+
+unsigned JointSet::addFixed(RigidBody* one, RigidBody* two, const Vector3& anchor) {
+	FixedJoint joint = {};
+	joint.body[0] = one;
+	joint.body[1] = two;
+	initPoint(joint.point, joint.body, anchor);
+	initLock(joint.lock, joint.body);
+	fixed.push_back(joint);
+	return (unsigned)fixed.size() - 1;
+}
+
+unsigned JointSet::size(JointType type) const {
+	switch (type) {
+	case JOINT_BALL: return (unsigned)balls.size();
+	case JOINT_HINGE: return (unsigned)hinges.size();
+	case JOINT_SLIDER: return (unsigned)sliders.size();
+	case JOINT_FIXED: return (unsigned)fixed.size();
+	default: return 0;
+	}
+}
+
+unsigned JointSet::size() const {
+	return (unsigned)(balls.size() + hinges.size() + sliders.size() + fixed.size());
+}
+
+void JointSet::clear() {
+	balls.clear();
+	hinges.clear();
+	sliders.clear();
+	fixed.clear();
+}
+
+void JointSet::setIterations(unsigned iterations) {
+	this->iterations = iterations;
+}
+
+unsigned JointSet::getIterations() const {
+	return iterations;
+}
+
+void JointSet::setBias(real bias) {
+	this->bias = bias;
+}
+
+void JointSet::setWarmStarting(real factor) {
+	warmStarting = factor;
+}
+
+void JointSet::initPoint(PointPart& point, RigidBody* const body[2], const Vector3& anchor) const {
+	for (unsigned i = 0; i < 2; i++) {
+		point.localAnchor[i] = body[i] ? body[i]->getPointInLocalSpace(anchor) : anchor;
+	}
+}
+
+void JointSet::initLock(LockPart& lock, RigidBody* const body[2]) const {
+	// the second body's orientation as seen from the first
+	lock.relativeOrientation = conjugate(orientationOf(body[0]));
+	lock.relativeOrientation *= orientationOf(body[1]);
+}
+
+void JointSet::prepareBodies(RigidBody* const body[2], BodyTerms terms[2]) {
+	for (unsigned i = 0; i < 2; i++) {
+		if (body[i]) {
+			terms[i].inverseMass = body[i]->getInverseMass();
+			body[i]->getInertiaTensorWorld(&terms[i].inverseInertia);
+		}
+		else {
+			terms[i].inverseMass = 0;
+			terms[i].inverseInertia = Matrix3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+		}
+	}
+}
+
+void JointSet::preparePoint(PointPart& point, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const {
+	Vector3 world[2];
+	for (unsigned i = 0; i < 2; i++) {
+		world[i] = pointOf(body[i], point.localAnchor[i]);
+		point.relativeAnchor[i] = world[i] - centreOf(body[i]);
+	}
+
+	real inverseMass = terms[0].inverseMass + terms[1].inverseMass;
+	Matrix3 mass(inverseMass, 0, 0, 0, inverseMass, 0, 0, 0, inverseMass);
+	addPointInertia(mass, terms[0].inverseInertia, point.relativeAnchor[0]);
+	addPointInertia(mass, terms[1].inverseInertia, point.relativeAnchor[1]);
+	point.mass = inverseMass > 0 ? mass.inverse() : Matrix3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	point.bias = (world[1] - world[0]) * biasRate;
+
+	point.impulse *= warmStarting;
+	applyImpulse(body[0], terms[0].inverseMass, terms[0].inverseInertia, point.relativeAnchor[0], point.impulse * -1);
+	applyImpulse(body[1], terms[1].inverseMass, terms[1].inverseInertia, point.relativeAnchor[1], point.impulse);
+}
+
+void JointSet::prepareLock(LockPart& lock, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const {
+	Matrix3 mass = terms[0].inverseInertia;
+	mass += terms[1].inverseInertia;
+	bool movable = terms[0].inverseMass + terms[1].inverseMass > 0;
+	lock.mass = movable ? mass.inverse() : Matrix3(0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+	// the turn that takes the second body from where the lock wants it, the short way round
+	Quaternion target = orientationOf(body[0]);
+	target *= lock.relativeOrientation;
+	Quaternion error = orientationOf(body[1]);
+	error *= conjugate(target);
+	real sign = error.r < 0 ? -2 : 2;
+	lock.bias = Vector3(error.i, error.j, error.k) * (sign * biasRate);
+
+	lock.impulse *= warmStarting;
+	applyAngularImpulse(body[0], terms[0].inverseInertia, lock.impulse * -1);
+	applyAngularImpulse(body[1], terms[1].inverseInertia, lock.impulse);
+}
+
+void JointSet::prepareHinge(HingePart& hinge, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const {
+	Vector3 axis[2];
+	for (unsigned i = 0; i < 2; i++) axis[i] = directionOf(body[i], hinge.localAxis[i]);
+	makeAcross(axis[0], hinge.across);
+
+	Matrix3 inertia = terms[0].inverseInertia;
+	inertia += terms[1].inverseInertia;
+
+	real k00 = hinge.across[0] * (inertia * hinge.across[0]);
+	real k01 = hinge.across[0] * (inertia * hinge.across[1]);
+	real k11 = hinge.across[1] * (inertia * hinge.across[1]);
+	real determinant = k00 * k11 - k01 * k01;
+	if (determinant > 0) {
+		real inverse = 1 / determinant;
+		hinge.mass[0] = k11 * inverse;
+		hinge.mass[1] = -k01 * inverse;
+		hinge.mass[2] = -k01 * inverse;
+		hinge.mass[3] = k00 * inverse;
+	}
+	else {
+		hinge.mass[0] = hinge.mass[1] = hinge.mass[2] = hinge.mass[3] = 0;
+	}
+
+	// how far the second axis has turned away from the first
+	Vector3 error = axis[0] ^ axis[1];
+	hinge.bias[0] = (error * hinge.across[0]) * biasRate;
+	hinge.bias[1] = (error * hinge.across[1]) * biasRate;
+
+	hinge.impulse[0] *= warmStarting;
+	hinge.impulse[1] *= warmStarting;
+	Vector3 impulse = hinge.across[0] * hinge.impulse[0] + hinge.across[1] * hinge.impulse[1];
+	applyAngularImpulse(body[0], terms[0].inverseInertia, impulse * -1);
+	applyAngularImpulse(body[1], terms[1].inverseInertia, impulse);
+}
+
+void JointSet::prepareSlide(SlidePart& slide, RigidBody* const body[2], const BodyTerms terms[2], real biasRate) const {
+	Vector3 axis = directionOf(body[0], slide.localAxis);
+	makeAcross(axis, slide.across);
+
+	Vector3 world[2];
+	for (unsigned i = 0; i < 2; i++) world[i] = pointOf(body[i], slide.localAnchor[i]);
+	Vector3 offset = world[1] - world[0];
+
+	// the first body is pushed at the second anchor, so the rows do not turn it about the offset
+	slide.arm[0] = world[1] - centreOf(body[0]);
+	slide.arm[1] = world[1] - centreOf(body[1]);
+
+	Vector3 impulse;
+	for (unsigned row = 0; row < 2; row++) {
+		const Vector3& across = slide.across[row];
+		Vector3 turn[2] = { slide.arm[0] ^ across, slide.arm[1] ^ across };
+		real k = terms[0].inverseMass + terms[1].inverseMass +
+			turn[0] * (terms[0].inverseInertia * turn[0]) +
+			turn[1] * (terms[1].inverseInertia * turn[1]);
+		slide.mass[row] = k > 0 ? 1 / k : 0;
+		slide.bias[row] = (offset * across) * biasRate;
+
+		slide.impulse[row] *= warmStarting;
+		impulse += across * slide.impulse[row];
+	}
+	applyImpulse(body[0], terms[0].inverseMass, terms[0].inverseInertia, slide.arm[0], impulse * -1);
+	applyImpulse(body[1], terms[1].inverseMass, terms[1].inverseInertia, slide.arm[1], impulse);
+}
+
+void JointSet::prepare(real duration) {
+	real biasRate = duration > 0 ? bias / duration : 0;
+
+	for (BallJoint& joint : balls) {
+		prepareBodies(joint.body, joint.terms);
+		preparePoint(joint.point, joint.body, joint.terms, biasRate);
+	}
+	for (HingeJoint& joint : hinges) {
+		prepareBodies(joint.body, joint.terms);
+		prepareHinge(joint.hinge, joint.body, joint.terms, biasRate);
+		preparePoint(joint.point, joint.body, joint.terms, biasRate);
+	}
+	for (SliderJoint& joint : sliders) {
+		prepareBodies(joint.body, joint.terms);
+		prepareLock(joint.lock, joint.body, joint.terms, biasRate);
+		prepareSlide(joint.slide, joint.body, joint.terms, biasRate);
+	}
+	for (FixedJoint& joint : fixed) {
+		prepareBodies(joint.body, joint.terms);
+		prepareLock(joint.lock, joint.body, joint.terms, biasRate);
+		preparePoint(joint.point, joint.body, joint.terms, biasRate);
+	}
+}
+
+void JointSet::solvePoint(PointPart& point, RigidBody* const body[2], const BodyTerms terms[2]) {
+	Vector3 closing = velocityAt(body[1], point.relativeAnchor[1]) - velocityAt(body[0], point.relativeAnchor[0]);
+	Vector3 impulse = point.mass * ((closing + point.bias) * -1);
+	point.impulse += impulse;
+
+	applyImpulse(body[0], terms[0].inverseMass, terms[0].inverseInertia, point.relativeAnchor[0], impulse * -1);
+	applyImpulse(body[1], terms[1].inverseMass, terms[1].inverseInertia, point.relativeAnchor[1], impulse);
+}
+
+void JointSet::solveLock(LockPart& lock, RigidBody* const body[2], const BodyTerms terms[2]) {
+	Vector3 turning = angularVelocityOf(body[1]) - angularVelocityOf(body[0]);
+	Vector3 impulse = lock.mass * ((turning + lock.bias) * -1);
+	lock.impulse += impulse;
+
+	applyAngularImpulse(body[0], terms[0].inverseInertia, impulse * -1);
+	applyAngularImpulse(body[1], terms[1].inverseInertia, impulse);
+}
+
+void JointSet::solveHinge(HingePart& hinge, RigidBody* const body[2], const BodyTerms terms[2]) {
+	Vector3 turning = angularVelocityOf(body[1]) - angularVelocityOf(body[0]);
+	real c0 = -(turning * hinge.across[0] + hinge.bias[0]);
+	real c1 = -(turning * hinge.across[1] + hinge.bias[1]);
+	real lambda0 = hinge.mass[0] * c0 + hinge.mass[1] * c1;
+	real lambda1 = hinge.mass[2] * c0 + hinge.mass[3] * c1;
+	hinge.impulse[0] += lambda0;
+	hinge.impulse[1] += lambda1;
+
+	Vector3 impulse = hinge.across[0] * lambda0 + hinge.across[1] * lambda1;
+	applyAngularImpulse(body[0], terms[0].inverseInertia, impulse * -1);
+	applyAngularImpulse(body[1], terms[1].inverseInertia, impulse);
+}
+
+void JointSet::solveSlide(SlidePart& slide, RigidBody* const body[2], const BodyTerms terms[2]) {
+	for (unsigned row = 0; row < 2; row++) {
+		const Vector3& across = slide.across[row];
+		Vector3 closing = velocityAt(body[1], slide.arm[1]) - velocityAt(body[0], slide.arm[0]);
+		real lambda = -(closing * across + slide.bias[row]) * slide.mass[row];
+		slide.impulse[row] += lambda;
+
+		Vector3 impulse = across * lambda;
+		applyImpulse(body[0], terms[0].inverseMass, terms[0].inverseInertia, slide.arm[0], impulse * -1);
+		applyImpulse(body[1], terms[1].inverseMass, terms[1].inverseInertia, slide.arm[1], impulse);
+	}
+}
+
+void JointSet::solveVelocities() {
+	// the angular rows go first, the point rows then see the final turning
+	for (BallJoint& joint : balls) {
+		solvePoint(joint.point, joint.body, joint.terms);
+	}
+	for (HingeJoint& joint : hinges) {
+		solveHinge(joint.hinge, joint.body, joint.terms);
+		solvePoint(joint.point, joint.body, joint.terms);
+	}
+	for (SliderJoint& joint : sliders) {
+		solveLock(joint.lock, joint.body, joint.terms);
+		solveSlide(joint.slide, joint.body, joint.terms);
+	}
+	for (FixedJoint& joint : fixed) {
+		solveLock(joint.lock, joint.body, joint.terms);
+		solvePoint(joint.point, joint.body, joint.terms);
+	}
+}
+
+void JointSet::hashState(StateHash* hash) const {
+	for (const BallJoint& joint : balls) {
+		hash->add(joint.point.impulse);
+	}
+	for (const HingeJoint& joint : hinges) {
+		hash->add(joint.point.impulse);
+		hash->add(joint.hinge.impulse[0]);
+		hash->add(joint.hinge.impulse[1]);
+	}
+	for (const SliderJoint& joint : sliders) {
+		hash->add(joint.lock.impulse);
+		hash->add(joint.slide.impulse[0]);
+		hash->add(joint.slide.impulse[1]);
+	}
+	for (const FixedJoint& joint : fixed) {
+		hash->add(joint.point.impulse);
+		hash->add(joint.lock.impulse);
+	}
+}
@@ -0,0 +1,115 @@
+#include <cyclone/mapped_file.h>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace cyclone;
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+#ifdef _WIN32
+		std::swap(file, other.file);
+		std::swap(mapping, other.mapping);
+#endif
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const char* path) {
+	close();
+
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(handle);
+		return false;
+	}
+
+	HANDLE view = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (view == nullptr) {
+		CloseHandle(handle);
+		return false;
+	}
+
+	void* address = MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+	if (address == nullptr) {
+		CloseHandle(view);
+		CloseHandle(handle);
+		return false;
+	}
+
+	file = handle;
+	mapping = view;
+	bytes = static_cast<const unsigned char*>(address);
+	length = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close() {
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+	bytes = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+bool MappedFile::open(const char* path) {
+	close();
+
+	int descriptor = ::open(path, O_RDONLY);
+	if (descriptor < 0) return false;
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+		::close(descriptor);
+		return false;
+	}
+
+	void* address = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+	// the mapping keeps its own reference to the file
+	::close(descriptor);
+	if (address == MAP_FAILED) return false;
+
+	bytes = static_cast<const unsigned char*>(address);
+	length = (size_t)status.st_size;
+	return true;
+}
+
+void MappedFile::close() {
+	if (bytes) munmap(const_cast<unsigned char*>(bytes), length);
+	bytes = nullptr;
+	length = 0;
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include <cyclone/parallel.h>
+#include <algorithm>
+
+using namespace cyclone;
+
+ThreadPool::ThreadPool(unsigned workerCount) : stopping(false) {
+	if (workerCount == 0) {
+		unsigned hardware = std::thread::hardware_concurrency();
+		workerCount = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	jobs.reserve(16);
+	workers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+unsigned ThreadPool::getThreadCount() const {
+	return (unsigned)workers.size() + 1;
+}
+
+ThreadPool& ThreadPool::global() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::runChunks(Job* job) {
+	for (;;) {
+		unsigned chunk = job->nextChunk.fetch_add(1);
+		if (chunk >= job->chunks) return;
+
+		unsigned begin = chunk * job->grain;
+		unsigned end = std::min(begin + job->grain, job->count);
+		(*job->body)(begin, end);
+
+		// the owner keeps the job alive while this thread is a user of it
+		if (job->finishedChunks.fetch_add(1, std::memory_order_release) + 1 == job->chunks) {
+			job->finishedChunks.notify_all();
+		}
+	}
+}
+
+void ThreadPool::waitForChunks(Job* job) {
+	// chunks still running usually end soon, sleeping would cost more
+	for (unsigned spin = 0; spin < 64; spin++) {
+		if (job->finishedChunks.load(std::memory_order_acquire) >= job->chunks) return;
+		std::this_thread::yield();
+	}
+
+	for (;;) {
+		unsigned finished = job->finishedChunks.load(std::memory_order_acquire);
+		if (finished >= job->chunks) return;
+		job->finishedChunks.wait(finished, std::memory_order_acquire);
+	}
+}
+
+void ThreadPool::workerLoop() {
+	for (;;) {
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping) return;
+
+			// oldest job first, jobs without chunks left are retired
+			job = jobs.front();
+			if (job->nextChunk.load() >= job->chunks) {
+				jobs.erase(jobs.begin());
+				continue;
+			}
+			job->users.fetch_add(1);
+		}
+
+		runChunks(job);
+		release(job);
+	}
+}
+
+void ThreadPool::release(Job* job) {
+	// under the lock, so retire can not miss the last user leaving
+	bool last;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		last = job->users.fetch_sub(1, std::memory_order_release) == 1;
+	}
+	if (last) released.notify_all();
+}
+
+bool ThreadPool::runPending() {
+	Job* job = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Job* candidate : jobs) {
+			if (candidate->nextChunk.load() < candidate->chunks) {
+				job = candidate;
+				break;
+			}
+		}
+		if (!job) return false;
+		job->users.fetch_add(1);
+	}
+
+	runChunks(job);
+	release(job);
+	return true;
+}
+
+unsigned ThreadPool::getWorkEpoch() const {
+	return workEpoch.load();
+}
+
+void ThreadPool::waitForWork(unsigned epoch) {
+	workEpoch.wait(epoch);
+}
+
+void ThreadPool::notifyWork() {
+	workEpoch.fetch_add(1);
+	workEpoch.notify_all();
+}
+
+void ThreadPool::parallelFor(unsigned count, unsigned grain, const RangeFunction& body) {
+	if (count == 0) return;
+	if (grain == 0) grain = 1;
+
+	unsigned chunks = (count + grain - 1) / grain;
+
+	// nothing to share, run inline
+	if (chunks == 1 || workers.empty()) {
+		for (unsigned begin = 0; begin < count; begin += grain) {
+			body(begin, std::min(begin + grain, count));
+		}
+		return;
+	}
+
+	Job job;
+	job.body = &body;
+	job.count = count;
+	job.grain = grain;
+	job.chunks = chunks;
+	job.nextChunk = 0;
+	job.finishedChunks = 0;
+	job.users = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(&job);
+	}
+	wake.notify_all();
+	notifyWork();
+
+	// the caller works on its own loop, then waits for chunks others claimed
+	runChunks(&job);
+	waitForChunks(&job);
+
+	retire(&job);
+}
+
+void ThreadPool::retire(Job* job) {
+	// no worker may pick the job up once it is off the list
+	std::unique_lock<std::mutex> lock(mutex);
+	auto it = std::find(jobs.begin(), jobs.end(), job);
+	if (it != jobs.end()) jobs.erase(it);
+	released.wait(lock, [job] { return job->users.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::start(AsyncTask& task, std::function<void()> work) {
+	task.wait();
+
+	if (workers.empty()) {
+		work();
+		return;
+	}
+
+	// a job of one chunk, whoever claims it runs the work
+	task.work = std::move(work);
+	task.body = [&task](unsigned, unsigned) { task.work(); };
+	task.job.body = &task.body;
+	task.job.count = 1;
+	task.job.grain = 1;
+	task.job.chunks = 1;
+	task.job.nextChunk = 0;
+	task.job.finishedChunks = 0;
+	task.job.users = 0;
+	task.pool = this;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(&task.job);
+	}
+	wake.notify_one();
+	notifyWork();
+}
+
+void ThreadPool::AsyncTask::wait() {
+	if (!pool) return;
+
+	runChunks(&job);
+	waitForChunks(&job);
+	pool->retire(&job);
+	pool = nullptr;
+}
+
+void cyclone::parallelFor(ThreadPool* pool, unsigned count, unsigned grain, const ThreadPool::RangeFunction& body) {
+	if (pool) pool->parallelFor(count, grain, body);
+	else if (count > 0) body(0, count);
+}
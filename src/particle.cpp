@@ -9,25 +9,101 @@ void Particle::integrate(real duration) {
 		return; // infinite mass objects do not move
 	}
 
-	//update position
-	position += velocity * duration;
+	// we apply friction -> damping = e^(-k*t), k is the damping coefficient, t 
+	// t is time; derived from the m*v'+m*k*v = 0 differential equation
+	integrateDamped(duration, std::pow(damping, duration));
+}
 
-	//calculate the resulting acceleration for the force
-	Vector3 resultingAcc = accelaration;
+namespace {
+	using Scheme = IntegrationContext::IntegrationScheme;
 
-	// F = m*a => a = F/m = F * inverseMass
-	resultingAcc += forceAccum * inverseMass;
+	/*
+	* one step of the given scheme for a movable particle
+	*/
+	template <Scheme scheme>
+	inline void advance(Particle& particle, real duration, real dampingFactor, real previousDuration) {
+		// F = m*a => a = F/m = F * inverseMass
+		Vector3 resultingAcc = particle.accelaration;
+		resultingAcc += particle.forceAccum * particle.inverseMass;
 
+		switch (scheme) {
+		case IntegrationContext::INTEGRATE_DEFAULT:
+		case IntegrationContext::INTEGRATE_EXPLICIT_EULER:
+			particle.position += particle.velocity * duration;
+			particle.velocity += resultingAcc * duration;
+			particle.velocity *= dampingFactor;
+			break;
 
+		case IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER:
+			particle.velocity += resultingAcc * duration;
+			particle.velocity *= dampingFactor;
+			particle.position += particle.velocity * duration;
+			break;
 
-	//update velocity from the acceleration
-	velocity += resultingAcc * duration;
+		case IntegrationContext::INTEGRATE_POSITION_VERLET:
+			particle.velocity += resultingAcc * ((duration + previousDuration) * 0.5);
+			particle.velocity *= dampingFactor;
+			particle.position += particle.velocity * duration;
+			break;
 
-	// we apply friction -> damping = e^(-k*t), k is the damping coefficient, t 
-	// t is time; derived from the m*v'+m*k*v = 0 differential equation
-	velocity *= std::pow(damping, duration);
+		case IntegrationContext::INTEGRATE_VELOCITY_VERLET:
+			// the last step kicked with its own accelaration for the whole step,
+			// swap the second half for the accelaration at its end
+			particle.velocity += (resultingAcc - particle.lastFrameAccelaration) * (previousDuration * 0.5);
+			particle.position += particle.velocity * duration;
+			particle.position += resultingAcc * (duration * duration * 0.5);
+			particle.velocity += resultingAcc * duration;
+			particle.velocity *= dampingFactor;
+			break;
+		}
+
+		particle.lastFrameAccelaration = resultingAcc;
+		particle.clearAccumulator();
+	}
+
+	template <Scheme scheme>
+	void advanceAll(Particle* const* particles, unsigned count, IntegrationContext& context, const real* previousDurations) {
+		real duration = context.getDuration();
+		real previousDuration = context.getPreviousDuration();
+		for (unsigned i = 0; i < count; i++) {
+			Particle& particle = *particles[i];
+			if (particle.inverseMass <= 0.0) continue;
+			advance<scheme>(particle, duration, context.dampingFactor(particle.damping),
+				previousDurations ? previousDurations[i] : previousDuration);
+		}
+	}
+}
+
+void Particle::integrate(IntegrationContext& context) {
+	Particle* self = this;
+	integrateAll(&self, 1, context);
+}
+
+void Particle::integrateAll(Particle* const* particles, unsigned count, IntegrationContext& context,
+	const real* previousDurations) {
+	if (context.getDuration() <= 0.0) return;
+
+	switch (context.getScheme()) {
+	case IntegrationContext::INTEGRATE_DEFAULT:
+		advanceAll<IntegrationContext::INTEGRATE_DEFAULT>(particles, count, context, previousDurations);
+		break;
+	case IntegrationContext::INTEGRATE_EXPLICIT_EULER:
+		advanceAll<IntegrationContext::INTEGRATE_EXPLICIT_EULER>(particles, count, context, previousDurations);
+		break;
+	case IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER:
+		advanceAll<IntegrationContext::INTEGRATE_SEMI_IMPLICIT_EULER>(particles, count, context, previousDurations);
+		break;
+	case IntegrationContext::INTEGRATE_POSITION_VERLET:
+		advanceAll<IntegrationContext::INTEGRATE_POSITION_VERLET>(particles, count, context, previousDurations);
+		break;
+	case IntegrationContext::INTEGRATE_VELOCITY_VERLET:
+		advanceAll<IntegrationContext::INTEGRATE_VELOCITY_VERLET>(particles, count, context, previousDurations);
+		break;
+	}
+}
 
-	clearAccumulator();
+void Particle::integrateDamped(real duration, real dampingFactor) {
+	advance<IntegrationContext::INTEGRATE_EXPLICIT_EULER>(*this, duration, dampingFactor, 0);
 }
 
 void Particle::addForce(const Vector3& force) {
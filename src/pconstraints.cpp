@@ -0,0 +1,274 @@
+#include <cyclone/pconstraints.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace cyclone;
+
+ParticleConstraintSolver::ParticleConstraintSolver(unsigned iterations) : iterations(iterations) {}
+
+unsigned ParticleConstraintSolver::addRod(Particle* one, Particle* two, real length, real compliance) {
+	constraints.push_back(Constraint{ { one, two, nullptr }, length, compliance, 0, CONSTRAINT_ROD });
+	prepared = false;
+	return size() - 1;
+}
+
+unsigned ParticleConstraintSolver::addCable(Particle* one, Particle* two, real maxLength, real compliance) {
+	constraints.push_back(Constraint{ { one, two, nullptr }, maxLength, compliance, 0, CONSTRAINT_CABLE });
+	prepared = false;
+	return size() - 1;
+}
+
+unsigned ParticleConstraintSolver::addSpring(Particle* one, Particle* two, real restLength, real springConstant) {
+	return addRod(one, two, restLength, springConstant > 0 ? 1 / springConstant : 0);
+}
+
+unsigned ParticleConstraintSolver::addBending(Particle* one, Particle* middle, Particle* two, real compliance) {
+	Vector3 centroid = (one->position + middle->position + two->position) * (1.0 / 3);
+	real rest = (middle->position - centroid).magnitude();
+	constraints.push_back(Constraint{ { one, middle, two }, rest, compliance, 0, CONSTRAINT_BENDING });
+	prepared = false;
+	return size() - 1;
+}
+
+void ParticleConstraintSolver::clear() {
+	constraints.clear();
+	prepared = false;
+}
+
+void ParticleConstraintSolver::setIterations(unsigned iterations) {
+	this->iterations = iterations;
+}
+
+void ParticleConstraintSolver::setMode(SolveMode mode) {
+	this->mode = mode;
+}
+
+ParticleConstraintSolver::SolveMode ParticleConstraintSolver::getMode() const {
+	return mode;
+}
+
+void ParticleConstraintSolver::setRelaxation(real relaxation) {
+	this->relaxation = relaxation;
+}
+
+void ParticleConstraintSolver::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+unsigned ParticleConstraintSolver::getColourCount() {
+	prepare();
+	return colourStart.empty() ? 0 : (unsigned)colourStart.size() - 1;
+}
+
+void ParticleConstraintSolver::prepare() {
+	if (prepared) return;
+	prepared = true;
+
+	// give every particle a slot
+	std::unordered_map<Particle*, unsigned> slots;
+	particles.clear();
+	constraintSlots.assign(constraints.size() * 3, ~0u);
+	for (unsigned i = 0; i < constraints.size(); i++) {
+		for (unsigned k = 0; k < 3; k++) {
+			Particle* particle = constraints[i].particles[k];
+			if (!particle) continue;
+
+			auto found = slots.emplace(particle, (unsigned)particles.size());
+			if (found.second) particles.push_back(particle);
+			constraintSlots[i * 3 + k] = found.first->second;
+		}
+	}
+	startPositions.resize(particles.size());
+	corrections.resize(constraints.size() * 3);
+
+	// entries (constraint * 3 + k) touching each particle, for the jacobi gather
+	particleStart.assign(particles.size() + 1, 0);
+	for (unsigned slot : constraintSlots) {
+		if (slot != ~0u) particleStart[slot + 1]++;
+	}
+	for (unsigned i = 0; i < particles.size(); i++) particleStart[i + 1] += particleStart[i];
+	particleEntries.resize(particleStart.back());
+	std::vector<unsigned> fill(particleStart.begin(), particleStart.end() - 1);
+	for (unsigned entry = 0; entry < constraintSlots.size(); entry++) {
+		unsigned slot = constraintSlots[entry];
+		if (slot != ~0u) particleEntries[fill[slot]++] = entry;
+	}
+
+	/*
+	* greedy colouring: each constraint takes the lowest colour none of its
+	* particles has been given yet. it is cached until constraints change,
+	* so it goes by topology alone: a pinned particle can be given mass
+	* later and must not end up in two constraints of one colour
+	*/
+	std::vector<std::vector<bool>> used;
+	std::vector<unsigned> colours(constraints.size());
+	unsigned colourCount = 0;
+	for (unsigned i = 0; i < constraints.size(); i++) {
+		unsigned colour = 0;
+		for (;; colour++) {
+			if (colour == colourCount) {
+				used.emplace_back(particles.size(), false);
+				colourCount++;
+			}
+			bool free = true;
+			for (unsigned k = 0; k < 3 && free; k++) {
+				unsigned slot = constraintSlots[i * 3 + k];
+				if (slot != ~0u && used[colour][slot]) free = false;
+			}
+			if (free) break;
+		}
+
+		for (unsigned k = 0; k < 3; k++) {
+			unsigned slot = constraintSlots[i * 3 + k];
+			if (slot != ~0u) used[colour][slot] = true;
+		}
+		colours[i] = colour;
+	}
+
+	colourStart.assign(colourCount + 1, 0);
+	for (unsigned colour : colours) colourStart[colour + 1]++;
+	for (unsigned c = 0; c < colourCount; c++) colourStart[c + 1] += colourStart[c];
+	colourOrder.resize(constraints.size());
+	fill.assign(colourStart.begin(), colourStart.end() - 1);
+	for (unsigned i = 0; i < constraints.size(); i++) colourOrder[fill[colours[i]]++] = i;
+}
+
+real ParticleConstraintSolver::solveConstraint(unsigned index, real alphaScale, Vector3* moves) const {
+	const Constraint& constraint = constraints[index];
+	Particle* const* p = constraint.particles;
+
+	real error;
+	real weight;
+	if (constraint.type == CONSTRAINT_BENDING) {
+		// C = |x1 - c| - rest, c the centroid of the three
+		Vector3 centroid = (p[0]->position + p[1]->position + p[2]->position) * (1.0 / 3);
+		Vector3 direction = p[1]->position - centroid;
+		real distance = direction.magnitude();
+		if (distance <= 0) return 0;
+		direction *= 1 / distance;
+
+		error = distance - constraint.rest;
+		moves[0] = direction * (p[0]->inverseMass * (-1.0 / 3));
+		moves[1] = direction * (p[1]->inverseMass * (2.0 / 3));
+		moves[2] = direction * (p[2]->inverseMass * (-1.0 / 3));
+		weight = p[1]->inverseMass * (4.0 / 9) + (p[0]->inverseMass + p[2]->inverseMass) * (1.0 / 9);
+	}
+	else {
+		// C = |x0 - x1| - rest
+		Vector3 direction = p[0]->position - p[1]->position;
+		real distance = direction.magnitude();
+		if (distance <= 0) return 0;
+		direction *= 1 / distance;
+
+		error = distance - constraint.rest;
+		if (constraint.type == CONSTRAINT_CABLE && error <= 0 && constraint.lambda == 0) return 0;
+
+		moves[0] = direction * p[0]->inverseMass;
+		moves[1] = direction * -p[1]->inverseMass;
+		weight = p[0]->inverseMass + p[1]->inverseMass;
+	}
+
+	real alpha = constraint.compliance * alphaScale;
+	if (weight + alpha <= 0) return 0;
+
+	real deltaLambda = (-error - alpha * constraint.lambda) / (weight + alpha);
+
+	// a cable can only pull, its multiplier stays negative
+	if (constraint.type == CONSTRAINT_CABLE && constraint.lambda + deltaLambda > 0) {
+		deltaLambda = -constraint.lambda;
+	}
+	return deltaLambda;
+}
+
+void ParticleConstraintSolver::apply(unsigned index, real deltaLambda, const Vector3* moves) {
+	if (deltaLambda == 0) return;
+
+	Constraint& constraint = constraints[index];
+	constraint.lambda += deltaLambda;
+
+	// immovable particles are shared between colours, so they are never written
+	for (unsigned k = 0; k < 3; k++) {
+		Particle* particle = constraint.particles[k];
+		if (particle && particle->inverseMass > 0) particle->position += moves[k] * deltaLambda;
+	}
+}
+
+void ParticleConstraintSolver::sweepGaussSeidel(real alphaScale) {
+	Vector3 moves[3];
+	for (unsigned i = 0; i < constraints.size(); i++) {
+		apply(i, solveConstraint(i, alphaScale, moves), moves);
+	}
+}
+
+void ParticleConstraintSolver::sweepJacobi(real alphaScale) {
+	// every constraint reads the same positions and writes its own corrections
+	parallelFor(pool, size(), 256, [this, alphaScale](unsigned begin, unsigned end) {
+		Vector3 moves[3];
+		for (unsigned i = begin; i < end; i++) {
+			real deltaLambda = solveConstraint(i, alphaScale, moves);
+			constraints[i].lambda += deltaLambda;
+			for (unsigned k = 0; k < 3; k++) corrections[i * 3 + k] = moves[k] * deltaLambda;
+		}
+	});
+
+	// then each particle averages the corrections aimed at it
+	parallelFor(pool, (unsigned)particles.size(), 256, [this](unsigned begin, unsigned end) {
+		for (unsigned slot = begin; slot < end; slot++) {
+			unsigned first = particleStart[slot];
+			unsigned last = particleStart[slot + 1];
+			if (first == last) continue;
+
+			Vector3 total;
+			for (unsigned e = first; e < last; e++) total += corrections[particleEntries[e]];
+			particles[slot]->position += total * (relaxation / (last - first));
+		}
+	});
+}
+
+void ParticleConstraintSolver::sweepColoured(real alphaScale) {
+	for (unsigned c = 0; c + 1 < colourStart.size(); c++) {
+		unsigned first = colourStart[c];
+		parallelFor(pool, colourStart[c + 1] - first, 256, [this, first, alphaScale](unsigned begin, unsigned end) {
+			Vector3 moves[3];
+			for (unsigned n = first + begin; n < first + end; n++) {
+				unsigned i = colourOrder[n];
+				apply(i, solveConstraint(i, alphaScale, moves), moves);
+			}
+		});
+	}
+}
+
+void ParticleConstraintSolver::solve(real duration) {
+	if (constraints.empty() || duration <= 0) return;
+	prepare();
+
+	for (unsigned slot = 0; slot < particles.size(); slot++) startPositions[slot] = particles[slot]->position;
+	for (Constraint& constraint : constraints) constraint.lambda = 0;
+
+	// compliance is scaled by 1 / dt^2 so stiffness does not depend on the step
+	real alphaScale = 1 / (duration * duration);
+	for (unsigned i = 0; i < iterations; i++) {
+		switch (mode) {
+		case SOLVE_GAUSS_SEIDEL:
+			sweepGaussSeidel(alphaScale);
+			break;
+		case SOLVE_JACOBI:
+			sweepJacobi(alphaScale);
+			break;
+		case SOLVE_COLOURED:
+			sweepColoured(alphaScale);
+			break;
+		}
+	}
+
+	/*
+	* the integrator already moved the particles with their velocity,
+	* so the velocity only picks up the correction the solver added
+	*/
+	real inverseDuration = 1 / duration;
+	for (unsigned slot = 0; slot < particles.size(); slot++) {
+		Particle* particle = particles[slot];
+		particle->velocity += (particle->position - startPositions[slot]) * inverseDuration;
+	}
+}
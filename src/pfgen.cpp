@@ -24,8 +24,33 @@ void ParticleForceRegister::remove(Particle* particle, ParticleForceGenerator* f
 	registrations.erase(it, registrations.end());
 }
 
+void ParticleForceRegister::remove(Particle* particle) {
+	auto it = std::remove_if(registrations.begin(), registrations.end(),
+		[particle](const ParticleForceRegistration& entry) {
+			return entry.particle == particle; });
+
+	registrations.erase(it, registrations.end());
+}
+
+void ParticleForceRegister::remove(const std::vector<Particle*>& sortedParticles) {
+	auto it = std::remove_if(registrations.begin(), registrations.end(),
+		[&sortedParticles](const ParticleForceRegistration& entry) {
+			return std::binary_search(sortedParticles.begin(), sortedParticles.end(), entry.particle); });
+
+	registrations.erase(it, registrations.end());
+}
+
+void ParticleForceRegister::addBatch(ParticleForceBatch* batch) {
+	batches.push_back(batch);
+}
+
+void ParticleForceRegister::removeBatch(ParticleForceBatch* batch) {
+	batches.erase(std::remove(batches.begin(), batches.end(), batch), batches.end());
+}
+
 void ParticleForceRegister::clear() {
 	registrations.clear();
+	batches.clear();
 }
 
 /*
@@ -36,4 +61,8 @@ void ParticleForceRegister::updateForces(real duration) {
 	for (auto& registration : registrations) {
 		registration.fg->updateForce(registration.particle, duration);
 	}
+
+	for (auto batch : batches) {
+		batch->updateForces(duration);
+	}
 }
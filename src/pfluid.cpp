@@ -0,0 +1,231 @@
+#include <cyclone/pfluid.h>
+
+#include <cmath>
+
+using namespace cyclone;
+
+namespace {
+	const real pi = 3.14159265358979323846;
+}
+
+ParticleFluid::ParticleFluid(const std::vector<Particle*>& particles, real smoothingRadius, real restDensity)
+	: particles(particles), smoothingRadius(smoothingRadius), restDensity(restDensity) {
+	real h3 = smoothingRadius * smoothingRadius * smoothingRadius;
+	real h6 = h3 * h3;
+	poly6 = 315 / (64 * pi * h6 * h3);
+	spikyGradient = 45 / (pi * h6);
+	viscosityLaplacian = 45 / (pi * h6);
+}
+
+void ParticleFluid::setStiffness(real stiffness) {
+	this->stiffness = stiffness;
+}
+
+void ParticleFluid::setViscosity(real viscosity) {
+	this->viscosity = viscosity;
+}
+
+void ParticleFluid::addBoundary(const CollisionPlane& plane) {
+	boundaries.push_back(plane);
+}
+
+void ParticleFluid::clearBoundaries() {
+	boundaries.clear();
+}
+
+void ParticleFluid::setBoundaryStiffness(real stiffness) {
+	boundaryStiffness = stiffness;
+}
+
+void ParticleFluid::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+real ParticleFluid::getDensity(unsigned index) const {
+	return index < densityOf.size() ? densityOf[index] : 0;
+}
+
+unsigned ParticleFluid::cellHash(int x, int y, int z) const {
+	return ((unsigned)x * 73856093u ^ (unsigned)y * 19349663u ^ (unsigned)z * 83492791u) & tableMask;
+}
+
+void ParticleFluid::sortIntoCells() {
+	movable.clear();
+	for (unsigned i = 0; i < particles.size(); i++) {
+		if (particles[i]->inverseMass > 0) movable.push_back(i);
+	}
+	unsigned count = (unsigned)movable.size();
+
+	// about two buckets per particle keeps collisions between cells rare
+	unsigned tableSize = 64;
+	while (tableSize < count * 2) tableSize <<= 1;
+	tableMask = tableSize - 1;
+
+	real inverseRadius = 1 / smoothingRadius;
+	cellOf.resize(count);
+	cellStart.assign(tableSize + 1, 0);
+	for (unsigned k = 0; k < count; k++) {
+		const Vector3& position = particles[movable[k]]->position;
+		unsigned bucket = cellHash(
+			(int)std::floor(position.x * inverseRadius),
+			(int)std::floor(position.y * inverseRadius),
+			(int)std::floor(position.z * inverseRadius));
+		cellOf[k] = bucket;
+		cellStart[bucket + 1]++;
+	}
+	for (unsigned b = 0; b < tableSize; b++) cellStart[b + 1] += cellStart[b];
+
+	// counting sort into cell order, stable so the order is deterministic
+	order.resize(count);
+	fill.assign(cellStart.begin(), cellStart.end() - 1);
+	for (unsigned k = 0; k < count; k++) order[fill[cellOf[k]]++] = movable[k];
+
+	positionX.resize(count);
+	positionY.resize(count);
+	positionZ.resize(count);
+	velocityX.resize(count);
+	velocityY.resize(count);
+	velocityZ.resize(count);
+	mass.resize(count);
+	density.resize(count);
+	pressure.resize(count);
+	for (unsigned i = 0; i < count; i++) {
+		const Particle* particle = particles[order[i]];
+		positionX[i] = particle->position.x;
+		positionY[i] = particle->position.y;
+		positionZ[i] = particle->position.z;
+		velocityX[i] = particle->velocity.x;
+		velocityY[i] = particle->velocity.y;
+		velocityZ[i] = particle->velocity.z;
+		mass[i] = 1 / particle->inverseMass;
+	}
+}
+
+template <typename Visitor>
+void ParticleFluid::forNeighbours(real x, real y, real z, Visitor&& visit) const {
+	real inverseRadius = 1 / smoothingRadius;
+	int cx = (int)std::floor(x * inverseRadius);
+	int cy = (int)std::floor(y * inverseRadius);
+	int cz = (int)std::floor(z * inverseRadius);
+
+	// two of the 27 cells can share a bucket, each bucket is visited once
+	unsigned visited[27];
+	unsigned visitedCount = 0;
+	for (int dz = -1; dz <= 1; dz++) {
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				unsigned bucket = cellHash(cx + dx, cy + dy, cz + dz);
+
+				bool seen = false;
+				for (unsigned v = 0; v < visitedCount && !seen; v++) seen = visited[v] == bucket;
+				if (seen) continue;
+				visited[visitedCount++] = bucket;
+
+				for (unsigned j = cellStart[bucket]; j < cellStart[bucket + 1]; j++) visit(j);
+			}
+		}
+	}
+}
+
+void ParticleFluid::computeDensities(unsigned begin, unsigned end) {
+	real radiusSquared = smoothingRadius * smoothingRadius;
+
+	for (unsigned i = begin; i < end; i++) {
+		real x = positionX[i], y = positionY[i], z = positionZ[i];
+		real sum = 0;
+		forNeighbours(x, y, z, [&](unsigned j) {
+			real dx = x - positionX[j], dy = y - positionY[j], dz = z - positionZ[j];
+			real squared = dx * dx + dy * dy + dz * dz;
+			if (squared >= radiusSquared) return;
+
+			real falloff = radiusSquared - squared;
+			sum += mass[j] * falloff * falloff * falloff;
+		});
+
+		density[i] = sum * poly6;
+		real excess = density[i] - restDensity;
+		pressure[i] = excess > 0 ? stiffness * excess : 0;
+	}
+}
+
+void ParticleFluid::computeForces(unsigned begin, unsigned end) {
+	real radiusSquared = smoothingRadius * smoothingRadius;
+	real boundaryRange = smoothingRadius * 0.5;
+
+	for (unsigned i = begin; i < end; i++) {
+		real x = positionX[i], y = positionY[i], z = positionZ[i];
+		real vx = velocityX[i], vy = velocityY[i], vz = velocityZ[i];
+		real pressureI = pressure[i];
+		real fx = 0, fy = 0, fz = 0;
+
+		forNeighbours(x, y, z, [&](unsigned j) {
+			if (j == i) return;
+			real dx = x - positionX[j], dy = y - positionY[j], dz = z - positionZ[j];
+			real squared = dx * dx + dy * dy + dz * dz;
+			if (squared >= radiusSquared || squared <= 0) return;
+
+			real distance = std::sqrt(squared);
+			real falloff = smoothingRadius - distance;
+			real share = mass[j] / density[j];
+
+			// pressure pushes along the line between the two, away from j
+			real push = share * (pressureI + pressure[j]) * 0.5 * spikyGradient * falloff * falloff / distance;
+			fx += dx * push;
+			fy += dy * push;
+			fz += dz * push;
+
+			// viscosity pulls the velocity towards the neighbours'
+			real drag = share * viscosity * viscosityLaplacian * falloff;
+			fx += (velocityX[j] - vx) * drag;
+			fy += (velocityY[j] - vy) * drag;
+			fz += (velocityZ[j] - vz) * drag;
+		});
+
+		// force density over density is the accelaration
+		real inverseDensity = 1 / density[i];
+		Vector3 accelaration(fx * inverseDensity, fy * inverseDensity, fz * inverseDensity);
+
+		if (boundaryStiffness > 0) {
+			for (const CollisionPlane& plane : boundaries) {
+				real distance = plane.direction.x * x + plane.direction.y * y + plane.direction.z * z - plane.offset;
+				if (distance < boundaryRange) {
+					accelaration += plane.direction * (boundaryStiffness * (boundaryRange - distance));
+				}
+			}
+		}
+
+		particles[order[i]]->addForce(accelaration * mass[i]);
+	}
+}
+
+void ParticleFluid::updateForces(real duration) {
+	sortIntoCells();
+
+	// each pass writes only its own particles, the force pass needs every density
+	unsigned count = (unsigned)order.size();
+	parallelFor(pool, count, 512, [this](unsigned begin, unsigned end) { computeDensities(begin, end); });
+	parallelFor(pool, count, 512, [this](unsigned begin, unsigned end) { computeForces(begin, end); });
+
+	densityOf.assign(particles.size(), 0);
+	for (unsigned i = 0; i < count; i++) densityOf[order[i]] = density[i];
+}
+
+void ParticleFluid::enforceBoundaries(real restitution) {
+	if (boundaries.empty()) return;
+
+	parallelFor(pool, (unsigned)particles.size(), 512, [this, restitution](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			Particle* particle = particles[i];
+			if (particle->inverseMass <= 0) continue;
+
+			for (const CollisionPlane& plane : boundaries) {
+				real distance = plane.direction * particle->position - plane.offset;
+				if (distance >= 0) continue;
+
+				particle->position += plane.direction * -distance;
+				real closing = plane.direction * particle->velocity;
+				if (closing < 0) particle->velocity += plane.direction * (-closing * (1 + restitution));
+			}
+		}
+	});
+}
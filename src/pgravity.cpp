@@ -0,0 +1,182 @@
+#include <cyclone/pgravity.h>
+
+#include <cmath>
+
+using namespace cyclone;
+
+ParticleGravitation::ParticleGravitation(const std::vector<Particle*>& particles, real gravitationalConstant)
+	: particles(particles), gravitationalConstant(gravitationalConstant) {}
+
+void ParticleGravitation::setTheta(real theta) {
+	this->theta = theta;
+}
+
+real ParticleGravitation::getTheta() const {
+	return theta;
+}
+
+void ParticleGravitation::setSoftening(real softening) {
+	this->softening = softening;
+}
+
+real ParticleGravitation::getSoftening() const {
+	return softening;
+}
+
+void ParticleGravitation::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+void ParticleGravitation::build() {
+	nodes.clear();
+	order.clear();
+	for (unsigned i = 0; i < particles.size(); i++) {
+		if (particles[i]->inverseMass > 0) order.push_back(i);
+	}
+	if (order.empty()) return;
+
+	// a cube around every body
+	Vector3 low = particles[order[0]]->position;
+	Vector3 high = low;
+	for (unsigned index : order) {
+		const Vector3& position = particles[index]->position;
+		low = Vector3(std::fmin(low.x, position.x), std::fmin(low.y, position.y), std::fmin(low.z, position.z));
+		high = Vector3(std::fmax(high.x, position.x), std::fmax(high.y, position.y), std::fmax(high.z, position.z));
+	}
+	Vector3 extent = high - low;
+	real half = std::fmax(extent.x, std::fmax(extent.y, extent.z)) * 0.5;
+	half = half * (1 + 1e-9) + 1e-12;
+
+	scratch.resize(order.size());
+	buildNode(0, (unsigned)order.size(), (low + high) * 0.5, half, 0);
+
+	// copy the bodies in tree order so leaves read contiguous memory
+	bodyX.resize(order.size());
+	bodyY.resize(order.size());
+	bodyZ.resize(order.size());
+	bodyMass.resize(order.size());
+	for (unsigned k = 0; k < order.size(); k++) {
+		const Particle* particle = particles[order[k]];
+		bodyX[k] = particle->position.x;
+		bodyY[k] = particle->position.y;
+		bodyZ[k] = particle->position.z;
+		bodyMass[k] = 1 / particle->inverseMass;
+	}
+}
+
+unsigned ParticleGravitation::buildNode(unsigned begin, unsigned end, const Vector3& centre, real half, unsigned depth) {
+	unsigned index = (unsigned)nodes.size();
+	nodes.push_back(Node{ Vector3(), 0, half * 2, begin, end, 0, true });
+
+	Vector3 weighted;
+	real mass = 0;
+
+	if (end - begin <= leafSize || depth >= maxDepth) {
+		for (unsigned k = begin; k < end; k++) {
+			const Particle* particle = particles[order[k]];
+			real bodyMass = 1 / particle->inverseMass;
+			weighted += particle->position * bodyMass;
+			mass += bodyMass;
+		}
+	}
+	else {
+		nodes[index].leaf = false;
+
+		// counting sort of the range by octant
+		unsigned counts[9] = {};
+		auto octant = [&](unsigned k) {
+			const Vector3& position = particles[order[k]]->position;
+			return (position.x >= centre.x ? 1u : 0u) | (position.y >= centre.y ? 2u : 0u) | (position.z >= centre.z ? 4u : 0u);
+		};
+		for (unsigned k = begin; k < end; k++) counts[octant(k) + 1]++;
+		for (unsigned c = 0; c < 8; c++) counts[c + 1] += counts[c];
+
+		unsigned fill[8];
+		for (unsigned c = 0; c < 8; c++) fill[c] = begin + counts[c];
+		for (unsigned k = begin; k < end; k++) scratch[fill[octant(k)]++] = order[k];
+		for (unsigned k = begin; k < end; k++) order[k] = scratch[k];
+
+		real quarter = half * 0.5;
+		for (unsigned c = 0; c < 8; c++) {
+			unsigned childBegin = begin + counts[c];
+			unsigned childEnd = begin + counts[c + 1];
+			if (childBegin == childEnd) continue;
+
+			Vector3 childCentre(
+				centre.x + (c & 1 ? quarter : -quarter),
+				centre.y + (c & 2 ? quarter : -quarter),
+				centre.z + (c & 4 ? quarter : -quarter));
+			unsigned child = buildNode(childBegin, childEnd, childCentre, quarter, depth + 1);
+			weighted += nodes[child].centreOfMass * nodes[child].mass;
+			mass += nodes[child].mass;
+		}
+	}
+
+	Node& node = nodes[index];
+	node.mass = mass;
+	node.centreOfMass = weighted * (1 / mass);
+	node.skip = (unsigned)nodes.size();
+	return index;
+}
+
+Vector3 ParticleGravitation::accelarationAt(const Vector3& position) const {
+	real softeningSquared = softening * softening;
+	real thetaSquared = theta * theta;
+	real ax = 0, ay = 0, az = 0;
+
+	unsigned n = 0;
+	while (n < nodes.size()) {
+		const Node& node = nodes[n];
+		real dx = node.centreOfMass.x - position.x;
+		real dy = node.centreOfMass.y - position.y;
+		real dz = node.centreOfMass.z - position.z;
+		real distanceSquared = dx * dx + dy * dy + dz * dz;
+
+		if (node.leaf) {
+			for (unsigned k = node.begin; k < node.end; k++) {
+				real bx = bodyX[k] - position.x;
+				real by = bodyY[k] - position.y;
+				real bz = bodyZ[k] - position.z;
+				real squared = bx * bx + by * by + bz * bz + softeningSquared;
+
+				// the body itself, or one on top of it without softening
+				if (squared <= 0) continue;
+
+				real inverse = 1 / std::sqrt(squared);
+				real scale = bodyMass[k] * inverse * inverse * inverse;
+				ax += bx * scale;
+				ay += by * scale;
+				az += bz * scale;
+			}
+			n = node.skip;
+		}
+		else if (node.size * node.size < thetaSquared * distanceSquared) {
+			// far enough away to act as a single body
+			real inverse = 1 / std::sqrt(distanceSquared + softeningSquared);
+			real scale = node.mass * inverse * inverse * inverse;
+			ax += dx * scale;
+			ay += dy * scale;
+			az += dz * scale;
+			n = node.skip;
+		}
+		else {
+			n++;
+		}
+	}
+
+	return Vector3(ax, ay, az) * gravitationalConstant;
+}
+
+void ParticleGravitation::updateForces(real duration) {
+	build();
+
+	// each particle only writes its own accumulator
+	ThreadPool::RangeFunction body = [this](unsigned begin, unsigned end) {
+		for (unsigned k = begin; k < end; k++) {
+			Vector3 position(bodyX[k], bodyY[k], bodyZ[k]);
+			particles[order[k]]->addForce(accelarationAt(position) * bodyMass[k]);
+		}
+	};
+
+	parallelFor(pool, (unsigned)order.size(), 256, body);
+}
@@ -1,5 +1,8 @@
 #include <cyclone/plinks.h>
 
+#include <assert.h>
+#include <cmath>
+
 using namespace cyclone;
 
 using namespace std;
@@ -35,3 +38,110 @@ unsigned ParticleCable::addContact(ParticleContact* contact, unsigned limit) con
 	return 1;
 }
 
+
+
+ParticleLinkSet::ParticleLinkSet(const vector<Particle*>& particles) : particles(particles) {}
+
+unsigned ParticleLinkSet::addCable(unsigned one, unsigned two, real maxLength, real restitution) {
+	assert(one < particles.size() && two < particles.size());
+	first.push_back(one);
+	second.push_back(two);
+	length.push_back(maxLength);
+	lengthSquared.push_back(maxLength * maxLength);
+	this->restitution.push_back(restitution);
+	rod.push_back(0);
+	return size() - 1;
+}
+
+unsigned ParticleLinkSet::addRod(unsigned one, unsigned two, real length) {
+	assert(one < particles.size() && two < particles.size());
+	first.push_back(one);
+	second.push_back(two);
+	this->length.push_back(length);
+	lengthSquared.push_back(length * length);
+	restitution.push_back(0);
+	rod.push_back(1);
+	return size() - 1;
+}
+
+void ParticleLinkSet::reserve(unsigned count) {
+	first.reserve(count);
+	second.reserve(count);
+	length.reserve(count);
+	lengthSquared.reserve(count);
+	restitution.reserve(count);
+	rod.reserve(count);
+}
+
+void ParticleLinkSet::clear() {
+	first.clear();
+	second.clear();
+	length.clear();
+	lengthSquared.clear();
+	restitution.clear();
+	rod.clear();
+}
+
+unsigned ParticleLinkSet::addContact(ParticleContact* contact, unsigned limit) const {
+	real dx[blockSize], dy[blockSize], dz[blockSize];
+	unsigned char violated[blockSize];
+
+	Particle* const* table = particles.data();
+	const unsigned* __restrict a = first.data();
+	const unsigned* __restrict b = second.data();
+	const real* __restrict maxSquared = lengthSquared.data();
+	const real* __restrict linkLength = length.data();
+	const unsigned char* __restrict isRod = rod.data();
+
+	unsigned used = 0;
+	for (unsigned start = 0; start < size() && used < limit; start += blockSize) {
+		unsigned count = size() - start < blockSize ? size() - start : blockSize;
+
+		// gather the offsets, the particles themselves are not contiguous
+		for (unsigned i = 0; i < count; i++) {
+			assert(a[start + i] < particles.size() && b[start + i] < particles.size());
+			const Vector3& from = table[a[start + i]]->position;
+			const Vector3& to = table[b[start + i]]->position;
+			dx[i] = to.x - from.x;
+			dy[i] = to.y - from.y;
+			dz[i] = to.z - from.z;
+		}
+
+		// cables are violated once taut, like ParticleCable, rods when off their
+		// length by more than the tolerance. |l^2 - L^2| is about 2 L |l - L|
+		for (unsigned i = 0; i < count; i++) {
+			real squared = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i];
+			real limitSquared = maxSquared[start + i];
+			violated[i] = isRod[start + i]
+				? std::abs(squared - limitSquared) > 2 * rodTolerance * linkLength[start + i]
+				: squared >= limitSquared;
+		}
+
+		for (unsigned i = 0; i < count && used < limit; i++) {
+			if (!violated[i]) continue;
+
+			unsigned link = start + i;
+			Vector3 normal(dx[i], dy[i], dz[i]);
+			real current = normal.magnitude();
+			if (current <= 0) continue;
+			normal *= 1 / current;
+
+			// too short rods push the particles apart instead
+			real penetration = current - length[link];
+			if (penetration < 0) {
+				normal *= -1;
+				penetration = -penetration;
+			}
+
+			contact->particles[0] = table[a[link]];
+			contact->particles[1] = table[b[link]];
+			contact->contactNormal = normal;
+			contact->penetration = penetration;
+			contact->restitution = restitution[link];
+			contact++;
+			used++;
+		}
+	}
+
+	return used;
+}
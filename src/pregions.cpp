@@ -0,0 +1,367 @@
+#include <cyclone/pregions.h>
+#include <cyclone/mapped_file.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace cyclone;
+
+namespace {
+	// position, velocity, accelaration, damping and inverse mass
+	const unsigned recordReals = 11;
+	const size_t recordSize = recordReals * sizeof(real);
+
+	// page files start with this and the particle count
+	const uint32_t pageMagic = 0x47505943;
+
+	void encode(const Particle& particle, unsigned char* out) {
+		real values[recordReals] = {
+			particle.position.x, particle.position.y, particle.position.z,
+			particle.velocity.x, particle.velocity.y, particle.velocity.z,
+			particle.accelaration.x, particle.accelaration.y, particle.accelaration.z,
+			particle.damping, particle.inverseMass
+		};
+		std::memcpy(out, values, recordSize);
+	}
+
+	Particle decode(const unsigned char* in) {
+		real values[recordReals];
+		std::memcpy(values, in, recordSize);
+
+		Particle particle;
+		particle.position = Vector3(values[0], values[1], values[2]);
+		particle.velocity = Vector3(values[3], values[4], values[5]);
+		particle.accelaration = Vector3(values[6], values[7], values[8]);
+		particle.damping = values[9];
+		particle.inverseMass = values[10];
+		return particle;
+	}
+}
+
+ParticleRegions::ParticleRegions(ParticleWorld& world, real regionSize) : world(world), regionSize(regionSize) {}
+
+uint64_t ParticleRegions::key(int x, int y, int z) {
+	// 21 bits per axis, enough for two million regions each way
+	auto bits = [](int value) { return (uint64_t)(uint32_t)value & 0x1fffff; };
+	return bits(x) | (bits(y) << 21) | (bits(z) << 42);
+}
+
+void ParticleRegions::cellOf(const Vector3& position, int* x, int* y, int* z) const {
+	*x = (int)std::floor(position.x / regionSize);
+	*y = (int)std::floor(position.y / regionSize);
+	*z = (int)std::floor(position.z / regionSize);
+}
+
+ParticleRegions::Region& ParticleRegions::regionAt(int x, int y, int z) {
+	Region& region = regions[key(x, y, z)];
+	region.x = x;
+	region.y = y;
+	region.z = z;
+	return region;
+}
+
+void ParticleRegions::addForceGenerator(ParticleForceGenerator* generator) {
+	generators.push_back(generator);
+}
+
+unsigned ParticleRegions::addFocus(const Vector3& position, real radius) {
+	focuses.push_back({ position, radius });
+	return (unsigned)focuses.size() - 1;
+}
+
+void ParticleRegions::moveFocus(unsigned focus, const Vector3& position) {
+	focuses[focus].position = position;
+}
+
+void ParticleRegions::setPageDirectory(const std::string& directory) {
+	pageDirectory = directory;
+}
+
+unsigned ParticleRegions::getActiveRegionCount() const {
+	unsigned count = 0;
+	for (uint64_t k : loaded) {
+		if (regions.at(k).state == REGION_ACTIVE) count++;
+	}
+	return count;
+}
+
+void ParticleRegions::add(const Particle& particle) {
+	int x, y, z;
+	cellOf(particle.position, &x, &y, &z);
+	Region& region = regionAt(x, y, z);
+
+	if (region.state == REGION_PAGED) {
+		appendToPage(region, particle);
+		return;
+	}
+
+	Particle* added = enter(region, particle);
+	if (region.state == REGION_HALO) {
+		region.frozenInverseMass.push_back(added->inverseMass);
+		added->inverseMass = 0;
+	}
+}
+
+Particle* ParticleRegions::enter(Region& region, const Particle& particle) {
+	// a handle that was just created always has a particle
+	ParticleWorld::ParticleHandle handle = world.createParticle();
+	Particle* added = world.getParticle(handle);
+	*added = particle;
+	for (ParticleForceGenerator* generator : generators) world.getForceRegistry().add(added, generator);
+	region.particles.push_back(handle);
+	return added;
+}
+
+void ParticleRegions::dropDestroyed(Region& region) {
+	bool frozen = region.frozenInverseMass.size() == region.particles.size();
+
+	unsigned kept = 0;
+	for (unsigned i = 0; i < region.particles.size(); i++) {
+		if (!world.getParticle(region.particles[i])) continue;
+		if (frozen) region.frozenInverseMass[kept] = region.frozenInverseMass[i];
+		region.particles[kept++] = region.particles[i];
+	}
+	region.particles.resize(kept);
+	if (frozen) region.frozenInverseMass.resize(kept);
+}
+
+void ParticleRegions::leave(const std::vector<ParticleWorld::ParticleHandle>& handles) {
+	world.destroyParticles(handles.data(), (unsigned)handles.size());
+}
+
+void ParticleRegions::update() {
+	for (uint64_t k : loaded) regions[k].wanted = REGION_PAGED;
+
+	// regions overlapping a focus are active
+	std::vector<uint64_t> wanted;
+	for (const Focus& focus : focuses) {
+		int x0, y0, z0, x1, y1, z1;
+		Vector3 extent(focus.radius, focus.radius, focus.radius);
+		cellOf(focus.position - extent, &x0, &y0, &z0);
+		cellOf(focus.position + extent, &x1, &y1, &z1);
+
+		for (int z = z0; z <= z1; z++) {
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					// distance from the focus to the closest point of the cell
+					real squared = 0;
+					real low[3] = { x * regionSize, y * regionSize, z * regionSize };
+					real point[3] = { focus.position.x, focus.position.y, focus.position.z };
+					for (unsigned axis = 0; axis < 3; axis++) {
+						real d = point[axis] < low[axis] ? low[axis] - point[axis]
+							: point[axis] > low[axis] + regionSize ? point[axis] - low[axis] - regionSize : 0;
+						squared += d * d;
+					}
+					if (squared > focus.radius * focus.radius) continue;
+
+					Region& region = regionAt(x, y, z);
+					if (region.wanted == REGION_PAGED) wanted.push_back(key(x, y, z));
+					region.wanted = REGION_ACTIVE;
+				}
+			}
+		}
+	}
+
+	// and their neighbours are the halo
+	unsigned activeCount = (unsigned)wanted.size();
+	for (unsigned i = 0; i < activeCount; i++) {
+		Region& active = regions[wanted[i]];
+		int cx = active.x, cy = active.y, cz = active.z;
+		for (int z = cz - 1; z <= cz + 1; z++) {
+			for (int y = cy - 1; y <= cy + 1; y++) {
+				for (int x = cx - 1; x <= cx + 1; x++) {
+					Region& region = regionAt(x, y, z);
+					if (region.wanted != REGION_PAGED) continue;
+					region.wanted = REGION_HALO;
+					wanted.push_back(key(x, y, z));
+				}
+			}
+		}
+	}
+
+	// particles that crossed into another region follow its state
+	std::vector<ParticleWorld::ParticleHandle> leaving;
+	for (uint64_t k : loaded) {
+		Region& region = regions[k];
+		if (region.state != REGION_ACTIVE) continue;
+
+		for (unsigned i = 0; i < region.particles.size();) {
+			ParticleWorld::ParticleHandle handle = region.particles[i];
+			Particle* particle = world.getParticle(handle);
+			int x, y, z;
+			if (particle) {
+				cellOf(particle->position, &x, &y, &z);
+				if (x == region.x && y == region.y && z == region.z) {
+					i++;
+					continue;
+				}
+			}
+
+			// it moved on, or was destroyed through the world and is dropped
+			region.particles[i] = region.particles.back();
+			region.particles.pop_back();
+			if (!particle) continue;
+
+			Region& target = regionAt(x, y, z);
+			if (target.state == REGION_PAGED) {
+				appendToPage(target, *particle);
+				leaving.push_back(handle);
+				continue;
+			}
+			target.particles.push_back(handle);
+			if (target.state == REGION_HALO) {
+				target.frozenInverseMass.push_back(particle->inverseMass);
+				particle->inverseMass = 0;
+			}
+		}
+	}
+
+	leave(leaving);
+
+	// page out first so the memory is free before loading
+	std::vector<uint64_t> emptied;
+	for (uint64_t k : loaded) {
+		Region& region = regions[k];
+		if (region.wanted != REGION_PAGED) continue;
+		setState(region, REGION_PAGED);
+		if (region.pagedCount == 0) emptied.push_back(k);
+	}
+	for (uint64_t k : wanted) setState(regions[k], regions[k].wanted);
+	loaded.swap(wanted);
+
+	// empty regions far from every focus are not worth keeping
+	for (uint64_t k : emptied) regions.erase(k);
+}
+
+void ParticleRegions::setState(Region& region, RegionState state) {
+	if (state == region.state) return;
+
+	if (state == REGION_PAGED) {
+		if (region.state == REGION_HALO) unfreeze(region);
+		pageOut(region);
+		region.state = REGION_PAGED;
+		return;
+	}
+
+	if (region.state == REGION_PAGED) {
+		pageIn(region);
+		region.state = REGION_ACTIVE;
+	}
+	if (state == REGION_HALO && region.state == REGION_ACTIVE) freeze(region);
+	if (state == REGION_ACTIVE && region.state == REGION_HALO) unfreeze(region);
+	region.state = state;
+}
+
+void ParticleRegions::freeze(Region& region) {
+	region.frozenInverseMass.clear();
+	dropDestroyed(region);
+
+	region.frozenInverseMass.resize(region.particles.size());
+	for (unsigned i = 0; i < region.particles.size(); i++) {
+		Particle* particle = world.getParticle(region.particles[i]);
+		region.frozenInverseMass[i] = particle->inverseMass;
+		particle->inverseMass = 0;
+	}
+}
+
+void ParticleRegions::unfreeze(Region& region) {
+	dropDestroyed(region);
+
+	for (unsigned i = 0; i < region.particles.size(); i++) {
+		world.getParticle(region.particles[i])->inverseMass = region.frozenInverseMass[i];
+	}
+	region.frozenInverseMass.clear();
+}
+
+void ParticleRegions::pageIn(Region& region) {
+	if (region.onDisk) {
+		// decoded straight from the mapping
+		MappedFile file;
+		uint32_t header[2] = { 0, 0 };
+		if (file.open(pagePath(region).c_str()) && file.size() >= sizeof(header)) {
+			std::memcpy(header, file.data(), sizeof(header));
+			if (header[0] == pageMagic && file.size() >= sizeof(header) + header[1] * recordSize) {
+				for (unsigned i = 0; i < header[1]; i++) {
+					enter(region, decode(file.data() + sizeof(header) + i * recordSize));
+				}
+			}
+		}
+		std::remove(pagePath(region).c_str());
+		region.onDisk = false;
+	}
+	else {
+		for (unsigned i = 0; i < region.pagedCount; i++) enter(region, decode(region.page.data() + i * recordSize));
+		pagedBytes -= region.page.size();
+		std::vector<unsigned char>().swap(region.page);
+	}
+	region.pagedCount = 0;
+}
+
+void ParticleRegions::pageOut(Region& region) {
+	for (ParticleWorld::ParticleHandle handle : region.particles) {
+		const Particle* particle = world.getParticle(handle);
+		if (particle) appendToPage(region, *particle);
+	}
+	leave(region.particles);
+	region.particles.clear();
+	region.frozenInverseMass.clear();
+	writePage(region);
+}
+
+void ParticleRegions::flushPages() {
+	for (auto& entry : regions) {
+		if (entry.second.state == REGION_PAGED) writePage(entry.second);
+	}
+}
+
+void ParticleRegions::writePage(Region& region) {
+	if (pageDirectory.empty() || region.onDisk || region.pagedCount == 0) return;
+
+	// keep the page in memory if it can not be written
+	FILE* file = std::fopen(pagePath(region).c_str(), "wb");
+	if (!file) return;
+	uint32_t header[2] = { pageMagic, region.pagedCount };
+	bool written = std::fwrite(header, sizeof(header), 1, file) == 1 &&
+		std::fwrite(region.page.data(), region.page.size(), 1, file) == 1;
+	if (std::fclose(file) != 0) written = false;
+	if (!written) return;
+
+	pagedBytes -= region.page.size();
+	std::vector<unsigned char>().swap(region.page);
+	region.onDisk = true;
+}
+
+void ParticleRegions::appendToPage(Region& region, const Particle& particle) {
+	if (region.onDisk) readFromDisk(region);
+
+	size_t offset = region.page.size();
+	region.page.resize(offset + recordSize);
+	encode(particle, region.page.data() + offset);
+	region.pagedCount++;
+	pagedBytes += recordSize;
+}
+
+void ParticleRegions::readFromDisk(Region& region) {
+	MappedFile file;
+	uint32_t header[2] = { 0, 0 };
+	region.page.clear();
+	region.pagedCount = 0;
+	if (file.open(pagePath(region).c_str()) && file.size() >= sizeof(header)) {
+		std::memcpy(header, file.data(), sizeof(header));
+		if (header[0] == pageMagic && file.size() >= sizeof(header) + header[1] * recordSize) {
+			region.page.assign(file.data() + sizeof(header), file.data() + sizeof(header) + header[1] * recordSize);
+			region.pagedCount = header[1];
+			pagedBytes += region.page.size();
+		}
+	}
+	file.close();
+	std::remove(pagePath(region).c_str());
+	region.onDisk = false;
+}
+
+std::string ParticleRegions::pagePath(const Region& region) const {
+	char name[96];
+	std::snprintf(name, sizeof(name), "/region_%d_%d_%d.page", region.x, region.y, region.z);
+	return pageDirectory + name;
+}
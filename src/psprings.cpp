@@ -0,0 +1,188 @@
+#include <cyclone/psprings.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+using namespace cyclone;
+
+ParticleSpringNetwork::ParticleSpringNetwork(const std::vector<Particle*>& particles) : particles(particles) {}
+
+unsigned ParticleSpringNetwork::addSpring(unsigned one, unsigned two, real springConstant, real restLength, real damping) {
+	first.push_back(one);
+	second.push_back(two);
+	this->springConstant.push_back(springConstant);
+	this->restLength.push_back(restLength);
+	this->damping.push_back(damping);
+	prepared = false;
+	return size() - 1;
+}
+
+unsigned ParticleSpringNetwork::addSpring(unsigned one, unsigned two, real springConstant) {
+	real length = (particles[one]->position - particles[two]->position).magnitude();
+	return addSpring(one, two, springConstant, length);
+}
+
+void ParticleSpringNetwork::buildCloth(unsigned first, unsigned columns, unsigned rows,
+	const Vector3& origin, const Vector3& across, const Vector3& down,
+	real springConstant, real damping, bool shear, bool bend) {
+
+	auto at = [first, columns](unsigned column, unsigned row) {
+		return first + row * columns + column;
+	};
+	auto connect = [this, springConstant, damping](unsigned one, unsigned two) {
+		real length = (particles[one]->position - particles[two]->position).magnitude();
+		addSpring(one, two, springConstant, length, damping);
+	};
+
+	for (unsigned row = 0; row < rows; row++) {
+		for (unsigned column = 0; column < columns; column++) {
+			particles[at(column, row)]->position = origin + across * (real)column + down * (real)row;
+		}
+	}
+
+	for (unsigned row = 0; row < rows; row++) {
+		for (unsigned column = 0; column < columns; column++) {
+			if (column + 1 < columns) connect(at(column, row), at(column + 1, row));
+			if (row + 1 < rows) connect(at(column, row), at(column, row + 1));
+
+			if (shear && column + 1 < columns && row + 1 < rows) {
+				connect(at(column, row), at(column + 1, row + 1));
+				connect(at(column + 1, row), at(column, row + 1));
+			}
+
+			if (bend) {
+				if (column + 2 < columns) connect(at(column, row), at(column + 2, row));
+				if (row + 2 < rows) connect(at(column, row), at(column, row + 2));
+			}
+		}
+	}
+}
+
+void ParticleSpringNetwork::buildTetrahedra(unsigned first, const Vector3* vertices, unsigned vertexCount,
+	const unsigned* tetrahedra, unsigned tetrahedronCount,
+	real springConstant, real damping) {
+
+	for (unsigned v = 0; v < vertexCount; v++) {
+		particles[first + v]->position = vertices[v];
+	}
+
+	// the six edges of every tetrahedron, smaller index first, then deduplicated
+	static const unsigned corners[6][2] = { {0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3} };
+	std::vector<std::pair<unsigned, unsigned>> edges;
+	edges.reserve(tetrahedronCount * 6);
+	for (unsigned t = 0; t < tetrahedronCount; t++) {
+		const unsigned* tetrahedron = tetrahedra + t * 4;
+		for (auto& corner : corners) {
+			unsigned one = tetrahedron[corner[0]];
+			unsigned two = tetrahedron[corner[1]];
+			edges.push_back(one < two ? std::make_pair(one, two) : std::make_pair(two, one));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+	for (auto& edge : edges) {
+		real length = (vertices[edge.first] - vertices[edge.second]).magnitude();
+		addSpring(first + edge.first, first + edge.second, springConstant, length, damping);
+	}
+}
+
+void ParticleSpringNetwork::clear() {
+	first.clear();
+	second.clear();
+	springConstant.clear();
+	restLength.clear();
+	damping.clear();
+	prepared = false;
+}
+
+void ParticleSpringNetwork::setThreadPool(ThreadPool* pool) {
+	this->pool = pool;
+}
+
+void ParticleSpringNetwork::prepare() {
+	if (prepared) return;
+	prepared = true;
+
+	unsigned particleCount = 0;
+	for (unsigned e = 0; e < size(); e++) {
+		particleCount = std::max(particleCount, std::max(first[e], second[e]) + 1);
+	}
+
+	adjacencyStart.assign(particleCount + 1, 0);
+	for (unsigned e = 0; e < size(); e++) {
+		adjacencyStart[first[e] + 1]++;
+		adjacencyStart[second[e] + 1]++;
+	}
+	for (unsigned p = 0; p < particleCount; p++) adjacencyStart[p + 1] += adjacencyStart[p];
+
+	adjacency.resize(size() * 2);
+	std::vector<unsigned> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (unsigned e = 0; e < size(); e++) {
+		adjacency[fill[first[e]]++] = e * 2;
+		adjacency[fill[second[e]]++] = e * 2 + 1;
+	}
+
+	forceX.resize(size());
+	forceY.resize(size());
+	forceZ.resize(size());
+}
+
+void ParticleSpringNetwork::updateForces(real duration) {
+	prepare();
+
+	// one evaluation per spring
+	parallelFor(pool, size(), 1024, [this](unsigned begin, unsigned end) {
+		Particle* const* table = particles.data();
+		const unsigned* __restrict a = first.data();
+		const unsigned* __restrict b = second.data();
+		const real* __restrict k = springConstant.data();
+		const real* __restrict rest = restLength.data();
+		const real* __restrict c = damping.data();
+		real* __restrict fx = forceX.data();
+		real* __restrict fy = forceY.data();
+		real* __restrict fz = forceZ.data();
+
+		for (unsigned e = begin; e < end; e++) {
+			const Particle* one = table[a[e]];
+			const Particle* two = table[b[e]];
+			real dx = one->position.x - two->position.x;
+			real dy = one->position.y - two->position.y;
+			real dz = one->position.z - two->position.z;
+			real vx = one->velocity.x - two->velocity.x;
+			real vy = one->velocity.y - two->velocity.y;
+			real vz = one->velocity.z - two->velocity.z;
+
+			real length = std::sqrt(dx * dx + dy * dy + dz * dz);
+			real inverse = length > 0 ? 1 / length : 0;
+
+			// hooke's law as in ParticleSpring, plus a dashpot along the spring
+			real separating = (dx * vx + dy * vy + dz * vz) * inverse;
+			real magnitude = -(k[e] * (length - rest[e]) + c[e] * separating) * inverse;
+			fx[e] = dx * magnitude;
+			fy[e] = dy * magnitude;
+			fz[e] = dz * magnitude;
+		}
+	});
+
+	// each particle gathers its springs, the second end takes the opposite force
+	parallelFor(pool, (unsigned)adjacencyStart.size() - 1, 1024, [this](unsigned begin, unsigned end) {
+		for (unsigned p = begin; p < end; p++) {
+			unsigned from = adjacencyStart[p];
+			unsigned to = adjacencyStart[p + 1];
+			if (from == to) continue;
+
+			real x = 0, y = 0, z = 0;
+			for (unsigned i = from; i < to; i++) {
+				unsigned entry = adjacency[i];
+				unsigned e = entry >> 1;
+				real sign = (entry & 1) ? -1 : 1;
+				x += forceX[e] * sign;
+				y += forceY[e] * sign;
+				z += forceZ[e] * sign;
+			}
+			particles[p]->addForce(Vector3(x, y, z));
+		}
+	});
+}
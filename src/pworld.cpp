@@ -1,16 +1,18 @@
 #include <cyclone/pworld.h>
 
+#include <algorithm>
+#include <cstring>
+
 using namespace cyclone;
 
 using namespace std;
 
-ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iterations) : resolver(iterations), maxContacts(maxContacts) {
-	contacts = new ParticleContact[maxContacts];
+ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iterations) : resolver(iterations), contactBuffer(maxContacts) {
 	calculateIterations = (iterations == 0);
 }
 
 ParticleWorld::~ParticleWorld() {
-	delete[] contacts;
+	endStep();
 }
 
 void ParticleWorld::startFrame() {
@@ -19,47 +21,418 @@ void ParticleWorld::startFrame() {
 	}
 }
 
-unsigned ParticleWorld::generateContacts() {
-	unsigned limit = maxContacts;
-	ParticleContact *nextContact = contacts;
-	
+void ParticleWorld::beginStep(real duration, ThreadPool& pool) {
+	endStep();
 
-	for (auto generator : contactGenerators) {
-		if (limit <= 0) {
+	// on the caller, so the queue is never read while it is being filled
+	startFrame();
+	applyCommands();
+	pool.start(stepTask, [this, duration]() {
+		runPhysics(duration);
+	});
+}
+
+void ParticleWorld::endStep() {
+	stepTask.wait();
+}
+
+bool ParticleWorld::isStepping() const {
+	return stepTask.isRunning();
+}
+
+ParticleWorld::ParticleHandle ParticleWorld::queueCreateParticle(const Particle& particle) {
+	ParticleHandle handle = particlePool.create(particle);
+	commands.push_back({ Command::CREATE, handle, Vector3() });
+	return handle;
+}
+
+void ParticleWorld::queueDestroyParticle(ParticleHandle handle) {
+	commands.push_back({ Command::DESTROY, handle, Vector3() });
+}
+
+void ParticleWorld::queueForce(ParticleHandle handle, const Vector3& force) {
+	commands.push_back({ Command::FORCE, handle, force });
+}
+
+void ParticleWorld::applyCommands() {
+	for (const Command& command : commands) {
+		Particle* particle = particlePool.get(command.handle);
+		if (!particle) continue;
+
+		switch (command.type) {
+		case Command::CREATE:
+			particles.push_back(particle);
+			break;
+		case Command::DESTROY:
+			destroyParticle(command.handle);
+			break;
+		case Command::FORCE:
+			particle->addForce(command.force);
 			break;
 		}
-		unsigned used = generator->addContact(nextContact, limit);
-		limit -= used;
-		nextContact += used;
+	}
+	commands.clear();
+}
+
+unsigned ParticleWorld::generateContacts() {
+	unsigned used = 0;
+
+	for (auto generator : contactGenerators) {
+		unsigned added;
+		for (;;) {
+			unsigned limit = contactBuffer.capacity() - used;
+
+			// at full size the spare slot shows whether the generator had
+			// more than fits, which is the only case counted as an overflow
+			if (!contactBuffer.canGrow()) {
+				added = generator->addContact(contactBuffer.data() + used, limit + 1);
+				if (added > limit) {
+					added = limit;
+					contactBuffer.markOverflow();
+				}
+				break;
+			}
+
+			added = limit > 0 ? generator->addContact(contactBuffer.data() + used, limit) : 0;
 
-		
+			// a generator that fills the room may have had more to add, grow
+			// the buffer (reserve doubles it) and run it again over the same slots
+			if (added < limit) break;
+			contactBuffer.reserve(contactBuffer.capacity() + 1, used);
+		}
+		used += added;
 	}
 
-	return maxContacts - limit;
+	return used;
 }
 
 void ParticleWorld::integrate(real duration) {
-	for (auto particle : particles) {
-		particle->integrate(duration);
+	integrationContext.beginStep(duration);
+	if (!lodTiers.empty() && !observers.empty()) {
+		integrateLod(duration);
+		return;
+	}
+
+	integratedCount = (unsigned)particles.size();
+	Particle::integrateAll(particles.data(), integratedCount, integrationContext);
+}
+
+void ParticleWorld::addLodTier(real distance, unsigned interval) {
+	LodTier tier = { distance, interval };
+	auto at = std::upper_bound(lodTiers.begin(), lodTiers.end(), tier,
+		[](const LodTier& a, const LodTier& b) { return a.distance < b.distance; });
+	lodTiers.insert(at, tier);
+}
+
+void ParticleWorld::clearLodTiers() {
+	lodTiers.clear();
+	lodStates.clear();
+}
+
+unsigned ParticleWorld::addObserver(const Vector3& position) {
+	observers.push_back(position);
+	return (unsigned)observers.size() - 1;
+}
+
+void ParticleWorld::moveObserver(unsigned observer, const Vector3& position) {
+	observers[observer] = position;
+}
+
+void ParticleWorld::clearObservers() {
+	observers.clear();
+
+	// every particle runs at full rate until observers come back
+	lodStates.clear();
+}
+
+void ParticleWorld::setLodHysteresis(real hysteresis) {
+	lodHysteresis = hysteresis;
+}
+
+void ParticleWorld::setLodWakeFrames(unsigned frames) {
+	lodWakeFrames = frames;
+}
+
+unsigned ParticleWorld::getIntegratedCount() const {
+	return integratedCount;
+}
+
+unsigned ParticleWorld::lodTierOf(unsigned index, unsigned current) const {
+	const Vector3& position = particles[index]->position;
+	real closest = -1;
+	for (const Vector3& observer : observers) {
+		real squared = (position - observer).squareMagnitude();
+		if (closest < 0 || squared < closest) closest = squared;
+	}
+
+	unsigned tier = 0;
+	for (unsigned i = 0; i < lodTiers.size(); i++) {
+		// tier i + 1 starts at this distance, farther when moving out to it
+		real limit = lodTiers[i].distance * (current > i ? 1 : 1 + lodHysteresis);
+		if (closest > limit * limit) tier = i + 1;
+	}
+	return tier;
+}
+
+void ParticleWorld::integrateLod(real duration) {
+	unsigned count = (unsigned)particles.size();
+
+	// new particles' previous step is the world's, none on its first frame
+	LodState fresh;
+	fresh.lastFrames = integrationContext.getPreviousDuration() > 0 ? 1 : 0;
+	lodStates.resize(count, fresh);
+
+	auto interval = [this](unsigned tier) {
+		return tier == 0 ? 1u : lodTiers[tier - 1].interval;
+	};
+	unsigned longest = 1;
+	for (const LodTier& tier : lodTiers) longest = std::max(longest, tier.interval);
+
+	// due particles, how many frames each has built up and how many its
+	// step before covered
+	Particle** due = frameArena.allocate<Particle*>(count);
+	unsigned short* frames = frameArena.allocate<unsigned short>(count);
+	unsigned short* previous = frameArena.allocate<unsigned short>(count);
+	unsigned dueCount = 0;
+
+	for (unsigned i = 0; i < count; i++) {
+		LodState& state = lodStates[i];
+		unsigned wanted = lodTierOf(i, state.tier);
+		if (state.wake > 0) {
+			state.wake--;
+			wanted = 0;
+		}
+
+		// frozen particles do not build up time or forces, they pick up where they were
+		if (interval(state.tier) == 0) {
+			if (interval(wanted) == 0) continue;
+			state.tier = (unsigned char)wanted;
+			state.pending = 0;
+			state.countdown = 1;
+			state.forceSum = Vector3();
+		}
+
+		// the accumulator is cleared every frame, so skipped frames' forces are kept here
+		Particle* particle = particles[i];
+		state.pending++;
+		if (--state.countdown > 0) {
+			state.forceSum += particle->forceAccum;
+			continue;
+		}
+
+		// tiers only change on a due frame, so no built up time is lost
+		unsigned built = std::min<unsigned>(state.pending, longest);
+		if (state.pending > 1) {
+			// the average force over the built up time gives the same impulse
+			particle->forceAccum = (state.forceSum + particle->forceAccum) * ((real)1 / built);
+			state.forceSum = Vector3();
+		}
+		due[dueCount] = particle;
+		frames[dueCount] = (unsigned short)built;
+		previous[dueCount] = state.lastFrames;
+		dueCount++;
+		state.lastFrames = (unsigned short)built;
+		state.pending = 0;
+		state.tier = (unsigned char)wanted;
+		state.countdown = (unsigned short)std::max(interval(wanted), 1u);
+	}
+	integratedCount = dueCount;
+
+	// group by frame count, each group is one step of that many frames
+	unsigned* start = frameArena.allocate<unsigned>(longest + 2);
+	for (unsigned i = 0; i < dueCount; i++) start[frames[i] + 1]++;
+	for (unsigned k = 0; k <= longest; k++) start[k + 1] += start[k];
+	Particle** grouped = frameArena.allocate<Particle*>(dueCount);
+
+	// the verlet schemes need each particle's own previous step, a tier
+	// change or a wake makes it differ from the rest of its group
+	IntegrationContext::IntegrationScheme scheme = integrationContext.getScheme();
+	bool verlet = scheme == IntegrationContext::INTEGRATE_POSITION_VERLET ||
+		scheme == IntegrationContext::INTEGRATE_VELOCITY_VERLET;
+	real* previousDurations = verlet ? frameArena.allocate<real>(dueCount) : nullptr;
+	for (unsigned i = 0; i < dueCount; i++) {
+		unsigned at = start[frames[i]]++;
+		grouped[at] = due[i];
+		if (verlet) previousDurations[at] = duration * previous[i];
+	}
+
+	if (lodContexts.size() < longest + 1) lodContexts.resize(longest + 1);
+	unsigned begin = 0;
+	for (unsigned k = 1; k <= longest; k++) {
+		unsigned end = start[k];
+		if (end == begin) continue;
+
+		IntegrationContext* context = &integrationContext;
+		if (k > 1) {
+			context = &lodContexts[k];
+			context->setScheme(integrationContext.getScheme());
+			if (context->getMode() != integrationContext.getMode()) context->setMode(integrationContext.getMode());
+			context->beginStep(duration * k);
+		}
+		Particle::integrateAll(grouped + begin, end - begin, *context,
+			previousDurations ? previousDurations + begin : nullptr);
+		begin = end;
+	}
+}
+
+void ParticleWorld::wakeContacts(unsigned count) {
+	ParticleContact* contacts = contactBuffer.data();
+	for (unsigned c = 0; c < count; c++) {
+		unsigned one = indexOf(contacts[c].particles[0]);
+		unsigned two = indexOf(contacts[c].particles[1]);
+		if (one == ~0u || two == ~0u) continue;
+
+		for (unsigned side = 0; side < 2; side++) {
+			LodState& sleeper = lodStates[side ? two : one];
+			const LodState& other = lodStates[side ? one : two];
+			if (sleeper.tier == 0 || other.tier != 0) continue;
+
+			// due next frame with the time it has built up
+			sleeper.wake = (unsigned short)lodWakeFrames;
+			sleeper.countdown = 1;
+		}
 	}
 }
 
+void ParticleWorld::buildParticleIndex() {
+	using Entry = std::pair<const Particle*, unsigned>;
+	unsigned particleCount = (unsigned)particles.size();
+	particleIndex = frameArena.allocate<Entry>(particleCount);
+	for (unsigned i = 0; i < particleCount; i++) particleIndex[i] = Entry(particles[i], i);
+	std::sort(particleIndex, particleIndex + particleCount);
+}
+
+unsigned ParticleWorld::indexOf(const Particle* particle) const {
+	using Entry = std::pair<const Particle*, unsigned>;
+	unsigned particleCount = (unsigned)particles.size();
+	const Entry* found = std::lower_bound(particleIndex, particleIndex + particleCount, Entry(particle, 0));
+	return (particle && found != particleIndex + particleCount && found->first == particle) ? found->second : ~0u;
+}
+
 void ParticleWorld::runPhysics(real duration) {
+	frameArena.reset();
+
 	// we apply the force generators;
 	forceRegistry.updateForces(duration);
 
 	// then we integrate the objects
 	integrate(duration);
 
+	// and pull them back onto their constraints
+	constraintSolver.solve(duration);
+
+	resolveFrameContacts(duration);
+	publishFrame();
+}
+
+void ParticleWorld::addStepTasks(TaskGraph& graph) {
+	graph.add([this](real duration) {
+		frameArena.reset();
+		startFrame();
+		forceRegistry.updateForces(duration);
+	}, RESOURCE_PARTICLES, RESOURCE_PARTICLE_FORCES);
+
+	graph.add([this](real duration) { integrate(duration); },
+		RESOURCE_PARTICLE_FORCES, RESOURCE_PARTICLES);
+
+	graph.add([this](real duration) { constraintSolver.solve(duration); },
+		0, RESOURCE_PARTICLES);
+
+	graph.add([this](real duration) {
+		resolveFrameContacts(duration);
+		publishFrame();
+	}, 0, RESOURCE_PARTICLES | RESOURCE_PARTICLE_CONTACTS);
+}
+
+void ParticleWorld::resolveFrameContacts(real duration) {
 	// generate contacts
 	unsigned usedContacts = generateContacts();
 
+	bool lod = !lodTiers.empty() && !observers.empty() && lodStates.size() == particles.size();
+	if ((deterministic || lod) && usedContacts > 0) buildParticleIndex();
+	if (deterministic) sortContacts(usedContacts);
+	if (lod) wakeContacts(usedContacts);
+
 	if (usedContacts > 0) {
 		if (calculateIterations) {
 			resolver.setIterations(usedContacts * 2);
 		}
-		resolver.resolveContacts(contacts, usedContacts, duration);
+		resolver.resolveContacts(contactBuffer.data(), usedContacts, duration);
+	}
+	contactBuffer.endFrame(usedContacts);
+}
+
+void ParticleWorld::publishFrame() {
+	frames++;
+
+	if (snapshots) {
+		TransformState* states = snapshots->beginPublish((unsigned)particles.size());
+		for (unsigned i = 0; states && i < particles.size(); i++) {
+			states[i].position = particles[i]->position;
+			states[i].orientation = Quaternion(1, 0, 0, 0);
+			states[i].velocity = particles[i]->velocity;
+			states[i].rotation = Vector3();
+		}
+		snapshots->endPublish(frames);
+	}
+}
+
+ParticleWorld::ParticleHandle ParticleWorld::createParticle() {
+	ParticleHandle handle = particlePool.create();
+	particles.push_back(particlePool.get(handle));
+	return handle;
+}
+
+void ParticleWorld::destroyParticle(ParticleHandle handle) {
+	Particle* particle = particlePool.get(handle);
+	if (!particle) return;
+
+	// a queued particle may not have joined the list yet
+	auto found = std::find(particles.begin(), particles.end(), particle);
+	if (found != particles.end()) {
+		size_t index = found - particles.begin();
+		if (index < lodStates.size()) lodStates.erase(lodStates.begin() + index);
+		particles.erase(found);
 	}
+	forceRegistry.remove(particle);
+	particlePool.destroy(handle);
+}
+
+void ParticleWorld::destroyParticles(const ParticleHandle* handles, unsigned count) {
+	vector<Particle*> doomed;
+	doomed.reserve(count);
+	for (unsigned i = 0; i < count; i++) {
+		Particle* particle = particlePool.get(handles[i]);
+		if (particle) doomed.push_back(particle);
+	}
+	if (doomed.empty()) return;
+	sort(doomed.begin(), doomed.end());
+
+	// the list and the lod states move down together
+	unsigned kept = 0, keptStates = 0;
+	for (unsigned i = 0; i < particles.size(); i++) {
+		if (binary_search(doomed.begin(), doomed.end(), particles[i])) continue;
+		if (i < lodStates.size()) lodStates[keptStates++] = lodStates[i];
+		particles[kept++] = particles[i];
+	}
+	particles.resize(kept);
+	lodStates.resize(keptStates);
+
+	forceRegistry.remove(doomed);
+	for (unsigned i = 0; i < count; i++) particlePool.destroy(handles[i]);
+}
+
+Particle* ParticleWorld::getParticle(ParticleHandle handle) {
+	return particlePool.get(handle);
+}
+
+void ParticleWorld::reserveParticles(unsigned count) {
+	particlePool.reserve(count);
+	particles.reserve(count);
+}
+
+FrameArena& ParticleWorld::getFrameArena() {
+	return frameArena;
 }
 
 ParticleWorld::Particles& ParticleWorld::getParticles() {
@@ -72,4 +445,74 @@ ParticleWorld::ContactGenerators& ParticleWorld::getContactGenerators() {
 
 ParticleForceRegister& ParticleWorld::getForceRegistry() {
 	return forceRegistry;
-}
\ No newline at end of file
+}
+
+IntegrationContext& ParticleWorld::getIntegrationContext() {
+	return integrationContext;
+}
+
+ParticleConstraintSolver& ParticleWorld::getConstraintSolver() {
+	return constraintSolver;
+}
+
+void ParticleWorld::setSnapshotBuffer(SnapshotBuffer* buffer) {
+	snapshots = buffer;
+}
+
+ContactBuffer<ParticleContact>& ParticleWorld::getContactBuffer() {
+	return contactBuffer;
+}
+
+void ParticleWorld::setDeterministic(bool deterministic) {
+	this->deterministic = deterministic;
+}
+
+bool ParticleWorld::isDeterministic() const {
+	return deterministic;
+}
+
+void ParticleWorld::sortContacts(unsigned count) {
+	if (count < 2) return;
+
+	// particles outside the world and the immovable world itself sort last
+	auto id = [this](const Particle* particle) {
+		return indexOf(particle);
+	};
+	auto bits = [](real value) {
+		uint64_t result;
+		std::memcpy(&result, &value, sizeof(result));
+		return result;
+	};
+
+	// ties between the same particles are broken on the contact itself, then
+	// on the generation order, which gives a stable sort without its buffer
+	ParticleContact* contacts = contactBuffer.data();
+	unsigned* order = frameArena.allocate<unsigned>(count);
+	for (unsigned i = 0; i < count; i++) order[i] = i;
+	std::sort(order, order + count, [&](unsigned ia, unsigned ib) {
+		const ParticleContact& a = contacts[ia];
+		const ParticleContact& b = contacts[ib];
+		unsigned a0 = id(a.particles[0]), b0 = id(b.particles[0]);
+		if (a0 != b0) return a0 < b0;
+		unsigned a1 = id(a.particles[1]), b1 = id(b.particles[1]);
+		if (a1 != b1) return a1 < b1;
+
+		uint64_t ka[5] = { bits(a.penetration), bits(a.contactNormal.x), bits(a.contactNormal.y), bits(a.contactNormal.z), ia };
+		uint64_t kb[5] = { bits(b.penetration), bits(b.contactNormal.x), bits(b.contactNormal.y), bits(b.contactNormal.z), ib };
+		return std::lexicographical_compare(ka, ka + 5, kb, kb + 5);
+	});
+
+	ParticleContact* sorted = frameArena.allocate<ParticleContact>(count);
+	for (unsigned i = 0; i < count; i++) sorted[i] = contacts[order[i]];
+	std::copy(sorted, sorted + count, contacts);
+}
+
+uint64_t ParticleWorld::stateHash() const {
+	StateHash hash;
+	for (const Particle* particle : particles) {
+		hash.add(particle->position);
+		hash.add(particle->velocity);
+		hash.add(particle->lastFrameAccelaration);
+	}
+	return hash.get();
+}
@@ -0,0 +1,72 @@
+#include <cyclone/snapshot.h>
+
+#include <utility>
+
+using namespace cyclone;
+
+SnapshotBuffer::View::View(View&& other) noexcept : slot(other.slot) {
+	other.slot = nullptr;
+}
+
+SnapshotBuffer::View& SnapshotBuffer::View::operator=(View&& other) noexcept {
+	std::swap(slot, other.slot);
+	return *this;
+}
+
+SnapshotBuffer::View::~View() {
+	if (slot) slot->readers.fetch_sub(1);
+}
+
+const TransformState* SnapshotBuffer::View::data() const {
+	return slot ? slot->states.data() : nullptr;
+}
+
+unsigned SnapshotBuffer::View::size() const {
+	return slot ? (unsigned)slot->states.size() : 0;
+}
+
+uint64_t SnapshotBuffer::View::frame() const {
+	return slot ? slot->frame : 0;
+}
+
+TransformState* SnapshotBuffer::beginPublish(unsigned count) {
+	/*
+	* a slot that is not published and has no readers can not gain any:
+	* readers only keep a slot they still find published after pinning it
+	*/
+	Slot* current = published.load();
+	writing = nullptr;
+	for (Slot& slot : slots) {
+		if (&slot != current && slot.readers.load() == 0) {
+			writing = &slot;
+			break;
+		}
+	}
+
+	if (!writing) {
+		skipped++;
+		return nullptr;
+	}
+
+	writing->states.resize(count);
+	return writing->states.data();
+}
+
+void SnapshotBuffer::endPublish(uint64_t frame) {
+	if (!writing) return;
+	writing->frame = frame;
+	published.store(writing);
+	writing = nullptr;
+}
+
+SnapshotBuffer::View SnapshotBuffer::read() const {
+	for (;;) {
+		Slot* slot = published.load();
+		if (!slot) return View();
+
+		// pin, then check the writer did not move on in between
+		slot->readers.fetch_add(1);
+		if (published.load() == slot) return View(slot);
+		slot->readers.fetch_sub(1);
+	}
+}
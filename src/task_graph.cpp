@@ -0,0 +1,144 @@
+#include <cyclone/task_graph.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <thread>
+
+using namespace cyclone;
+
+unsigned TaskGraph::add(const Work& work, uint64_t reads, uint64_t writes, real cost) {
+	std::unique_ptr<Task> task(new Task());
+	task->work = work;
+	task->reads = reads;
+	task->writes = writes;
+	task->cost = cost;
+	tasks.push_back(std::move(task));
+	prepared = false;
+	return size() - 1;
+}
+
+void TaskGraph::precede(unsigned before, unsigned after) {
+	// edges run forwards, so the graph can not have a cycle
+	assert(before < after && after < size());
+	explicitEdges.emplace_back(before, after);
+	prepared = false;
+}
+
+void TaskGraph::clear() {
+	tasks.clear();
+	explicitEdges.clear();
+	prepared = false;
+}
+
+void TaskGraph::prepare() {
+	if (prepared) return;
+	prepared = true;
+
+	for (auto& task : tasks) {
+		task->successors.clear();
+		task->predecessorCount = 0;
+	}
+
+	auto connect = [this](unsigned before, unsigned after) {
+		std::vector<unsigned>& successors = tasks[before]->successors;
+		if (std::find(successors.begin(), successors.end(), after) != successors.end()) return;
+		successors.push_back(after);
+		tasks[after]->predecessorCount++;
+	};
+
+	// read after write, write after write and write after read
+	for (unsigned after = 0; after < size(); after++) {
+		const Task& second = *tasks[after];
+		for (unsigned before = 0; before < after; before++) {
+			const Task& first = *tasks[before];
+			if ((first.writes & (second.reads | second.writes)) || (first.reads & second.writes)) {
+				connect(before, after);
+			}
+		}
+	}
+	for (auto& edge : explicitEdges) connect(edge.first, edge.second);
+
+	// successors always come later, so one backwards pass finds every chain
+	for (unsigned i = size(); i-- > 0;) {
+		Task& task = *tasks[i];
+		real longest = 0;
+		for (unsigned successor : task.successors) longest = std::max(longest, tasks[successor]->priority);
+		task.priority = task.cost + longest;
+	}
+}
+
+bool TaskGraph::lessUrgent(unsigned a, unsigned b) const {
+	// most urgent first, ties in the order the tasks were added
+	real pa = tasks[a]->priority, pb = tasks[b]->priority;
+	return pa < pb || (pa == pb && a > b);
+}
+
+void TaskGraph::makeReady(unsigned task, ThreadPool* pool) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(task);
+		std::push_heap(ready.begin(), ready.end(), [this](unsigned a, unsigned b) { return lessUrgent(a, b); });
+	}
+	if (pool) pool->notifyWork();
+}
+
+void TaskGraph::runLane(real duration, ThreadPool& pool) {
+	unsigned idle = 0;
+	for (;;) {
+		// read first, anything that happens after it ends the wait below
+		unsigned epoch = pool.getWorkEpoch();
+		if (remaining.load() == 0) return;
+
+		unsigned index = ~0u;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!ready.empty()) {
+				std::pop_heap(ready.begin(), ready.end(), [this](unsigned a, unsigned b) { return lessUrgent(a, b); });
+				index = ready.back();
+				ready.pop_back();
+			}
+		}
+
+		// nothing to start, steal chunks of a running task's loops instead,
+		// and with none of those either spin a little, then sleep
+		if (index == ~0u) {
+			if (pool.runPending()) idle = 0;
+			else if (++idle < 64) std::this_thread::yield();
+			else pool.waitForWork(epoch);
+			continue;
+		}
+		idle = 0;
+
+		Task& task = *tasks[index];
+		task.work(duration);
+		for (unsigned successor : task.successors) {
+			if (tasks[successor]->waiting.fetch_sub(1) == 1) makeReady(successor, &pool);
+		}
+
+		// wakes the lanes waiting for work so they see the graph is done
+		if (remaining.fetch_sub(1) == 1) pool.notifyWork();
+	}
+}
+
+void TaskGraph::run(real duration, ThreadPool& pool) {
+	prepare();
+	if (tasks.empty()) return;
+
+	ready.clear();
+	for (unsigned i = 0; i < size(); i++) {
+		tasks[i]->waiting.store(tasks[i]->predecessorCount);
+	}
+	remaining.store(size());
+	for (unsigned i = 0; i < size(); i++) {
+		if (tasks[i]->predecessorCount == 0) makeReady(i, nullptr);
+	}
+
+	// one lane per thread, a lane started after the graph is done returns
+	pool.parallelFor(pool.getThreadCount(), 1, [this, duration, &pool](unsigned, unsigned) {
+		runLane(duration, pool);
+	});
+}
+
+void TaskGraph::run(real duration) {
+	for (auto& task : tasks) task->work(duration);
+}
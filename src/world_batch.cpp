@@ -0,0 +1,155 @@
+#include <cyclone/world_batch.h>
+
+using namespace cyclone;
+
+WorldBatch::WorldBatch(unsigned particleCapacity, unsigned contactCapacity)
+	: particleArena(particleCapacity), contactArena(contactCapacity) {}
+
+unsigned WorldBatch::createWorld(unsigned particleCount, unsigned maxContacts, unsigned bodyCount) {
+	if (particleCount > particleArena.size() - particlesUsed) return noWorld;
+	if (maxContacts > contactArena.size() - contactsUsed) return noWorld;
+
+	std::unique_ptr<World> added(new World());
+	World& world = *added;
+	world.particleStart = particlesUsed;
+	world.contactStart = contactsUsed;
+	world.maxContacts = maxContacts;
+	particlesUsed += particleCount;
+	contactsUsed += maxContacts;
+
+	world.particles.reserve(particleCount);
+	for (unsigned i = 0; i < particleCount; i++) {
+		particleArena[world.particleStart + i] = Particle();
+		world.particles.push_back(&particleArena[world.particleStart + i]);
+	}
+	world.resetParticles.assign(particleCount, Particle());
+
+	world.bodies.reserve(bodyCount);
+	for (unsigned i = 0; i < bodyCount; i++) {
+		world.bodies.push_back(bodies.add());
+	}
+	world.resetBodies.assign(bodyCount, RigidBody());
+	for (unsigned i = 0; i < bodyCount; i++) {
+		bodies.store(world.bodies[i], &world.resetBodies[i]);
+	}
+
+	worlds.push_back(std::move(added));
+	return size() - 1;
+}
+
+unsigned WorldBatch::clone(unsigned source) {
+	const World& from = *worlds[source];
+	unsigned index = createWorld((unsigned)from.particles.size(), from.maxContacts, (unsigned)from.bodies.size());
+	if (index == noWorld) return noWorld;
+
+	World& to = *worlds[index];
+	for (unsigned i = 0; i < from.particles.size(); i++) {
+		*to.particles[i] = *from.particles[i];
+	}
+	for (unsigned i = 0; i < from.bodies.size(); i++) {
+		RigidBody body;
+		bodies.store(from.bodies[i], &body);
+		bodies.load(to.bodies[i], body);
+	}
+	to.resetParticles = from.resetParticles;
+	to.resetBodies = from.resetBodies;
+	to.integrationContext = from.integrationContext;
+	return index;
+}
+
+void WorldBatch::saveResetState(unsigned index) {
+	World& world = *worlds[index];
+	for (unsigned i = 0; i < world.particles.size(); i++) {
+		world.resetParticles[i] = *world.particles[i];
+	}
+	for (unsigned i = 0; i < world.bodies.size(); i++) {
+		bodies.store(world.bodies[i], &world.resetBodies[i]);
+	}
+}
+
+void WorldBatch::reset(unsigned index) {
+	World& world = *worlds[index];
+	for (unsigned i = 0; i < world.particles.size(); i++) {
+		*world.particles[i] = world.resetParticles[i];
+	}
+	for (unsigned i = 0; i < world.bodies.size(); i++) {
+		bodies.load(world.bodies[i], world.resetBodies[i]);
+	}
+}
+
+std::vector<Particle*>& WorldBatch::getParticles(unsigned world) {
+	return worlds[world]->particles;
+}
+
+ParticleForceRegister& WorldBatch::getForceRegistry(unsigned world) {
+	return worlds[world]->forceRegistry;
+}
+
+std::vector<ParticleContactGenerator*>& WorldBatch::getContactGenerators(unsigned world) {
+	return worlds[world]->contactGenerators;
+}
+
+unsigned WorldBatch::getBody(unsigned world, unsigned body) const {
+	return worlds[world]->bodies[body];
+}
+
+unsigned WorldBatch::getBodyCount(unsigned world) const {
+	return (unsigned)worlds[world]->bodies.size();
+}
+
+void WorldBatch::stepParticles(World& world, real duration) {
+	world.forceRegistry.updateForces(duration);
+
+	world.integrationContext.beginStep(duration);
+	Particle::integrateAll(world.particles.data(), (unsigned)world.particles.size(), world.integrationContext);
+
+	// contacts go into the world's slice of the shared array
+	ParticleContact* first = &contactArena[world.contactStart];
+	unsigned limit = world.maxContacts;
+	ParticleContact* next = first;
+	for (auto generator : world.contactGenerators) {
+		if (limit == 0) break;
+		unsigned used = generator->addContact(next, limit);
+		limit -= used;
+		next += used;
+	}
+
+	unsigned usedContacts = world.maxContacts - limit;
+	if (usedContacts > 0) {
+		ParticleContactResolver resolver(usedContacts * 2);
+		resolver.resolveContacts(first, usedContacts, duration);
+	}
+}
+
+void WorldBatch::stepAll(real duration) {
+	for (auto& world : worlds) {
+		stepParticles(*world, duration);
+	}
+	bodies.integrate(duration);
+}
+
+void WorldBatch::stepAll(real duration, ThreadPool& pool) {
+	// small worlds, so several go into one chunk
+	pool.parallelFor(size(), 8, [this, duration](unsigned begin, unsigned end) {
+		for (unsigned i = begin; i < end; i++) {
+			stepParticles(*worlds[i], duration);
+		}
+	});
+	bodies.integrate(duration, pool);
+}
+
+uint64_t WorldBatch::stateHash(unsigned index) const {
+	const World& world = *worlds[index];
+	StateHash hash;
+	for (const Particle* particle : world.particles) {
+		hash.add(particle->position);
+		hash.add(particle->velocity);
+		hash.add(particle->lastFrameAccelaration);
+	}
+	for (unsigned body : world.bodies) {
+		RigidBody copy;
+		bodies.store(body, &copy);
+		copy.hashState(&hash);
+	}
+	return hash.get();
+}
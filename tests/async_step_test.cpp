@@ -0,0 +1,104 @@
+#include <cyclone/parallel.h>
+#include <cyclone/plinks.h>
+#include <cyclone/pworld.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace cyclone;
+
+using namespace std;
+
+/*
+* keeps every particle of a world above the ground plane
+*/
+class Ground : public ParticleContactGenerator {
+public:
+	ParticleWorld* world = nullptr;
+
+	virtual unsigned addContact(ParticleContact* contact, unsigned limit) const {
+		unsigned used = 0;
+		for (Particle* particle : world->getParticles()) {
+			if (used >= limit) break;
+			if (particle->position.y >= 0) continue;
+			contact[used].particles[0] = particle;
+			contact[used].particles[1] = nullptr;
+			contact[used].contactNormal = Vector3(0, 1, 0);
+			contact[used].penetration = -particle->position.y;
+			contact[used].restitution = (real)0.4;
+			used++;
+		}
+		return used;
+	}
+};
+
+/*
+* a world driven only through its command queue
+*/
+struct Scene {
+	ParticleWorld world;
+	Ground ground;
+	vector<ParticleWorld::ParticleHandle> live;
+
+	Scene() : world(256) {
+		world.setDeterministic(true);
+		ground.world = &world;
+		world.getContactGenerators().push_back(&ground);
+	}
+
+	/*
+	* queues the commands of one frame: a new particle every few frames,
+	* the oldest destroyed every few more, and gravity on the rest
+	*/
+	void queueFrame(unsigned frame) {
+		if (frame % 4 == 0) {
+			Particle particle;
+			particle.setmass((real)(1 + frame % 3));
+			particle.damping = (real)0.99;
+			particle.position = Vector3((real)(frame % 7), 5, (real)(frame % 5));
+			particle.velocity = Vector3(1, 0, -1);
+			live.push_back(world.queueCreateParticle(particle));
+		}
+		if (frame % 11 == 0 && !live.empty()) {
+			world.queueDestroyParticle(live.front());
+			live.erase(live.begin());
+		}
+		for (unsigned i = 0; i < live.size(); i++) {
+			world.queueForce(live[i], Vector3(0, (real)-10 * (1 + i % 3), 0));
+		}
+	}
+};
+
+int main() {
+	const unsigned frames = 300;
+	const real duration = (real)1 / 60;
+
+	Scene serial, stepped;
+	ThreadPool pool(3);
+
+	// commands for a frame are queued while the previous frame is stepping
+	stepped.queueFrame(0);
+	for (unsigned frame = 0; frame < frames; frame++) {
+		serial.queueFrame(frame);
+		serial.world.startFrame();
+		serial.world.applyCommands();
+		serial.world.runPhysics(duration);
+
+		stepped.world.beginStep(duration, pool);
+		stepped.queueFrame(frame + 1);
+		stepped.world.endStep();
+
+		if (serial.world.stateHash() != stepped.world.stateHash()) {
+			cout << "failed: async step diverged at frame " << frame << endl;
+			return 1;
+		}
+	}
+
+	if (serial.world.getParticles().size() != stepped.world.getParticles().size() ||
+		serial.world.getParticles().empty()) {
+		cout << "failed: particle counts differ" << endl;
+		return 1;
+	}
+
+	return 0;
+}
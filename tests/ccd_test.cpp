@@ -0,0 +1,88 @@
+#include <cyclone/body.h>
+#include <cyclone/collide_broad.h>
+#include <cyclone/collide_dispatch.h>
+#include <cyclone/contacts.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace cyclone;
+
+using namespace std;
+
+/*
+* drops a small sphere at 120 m/s onto a 2 cm thick floor, far more than
+* its size per step, through the broadphase, the dispatcher and the
+* contact resolver. returns where the sphere ends up
+*/
+real dropSphere(bool continuous) {
+	const real duration = (real)1 / 60;
+
+	RigidBody ball;
+	ball.setMass(1);
+	Matrix3 tensor;
+	tensor.setInertiaTensorCoeffs((real)0.004, (real)0.004, (real)0.004);
+	ball.setInertiaTensor(tensor);
+	ball.setDamping(1, 1);
+	ball.setPosition(0, 1, 0);
+	ball.setVelocity(0, -120, 0);
+	ball.setAccelaration(Vector3(0, (real)-9.81, 0));
+	ball.setContinuous(continuous);
+	ball.calculateDerivedData();
+
+	CollisionSphere sphere;
+	sphere.body = &ball;
+	sphere.radius = (real)0.1;
+	sphere.calculateInternals();
+
+	// level geometry with no body
+	CollisionBox floor;
+	floor.halfSize = Vector3(5, (real)0.01, 5);
+	floor.calculateInternals();
+
+	CollisionBroadPhase broadPhase;
+	broadPhase.addStatic(&floor);
+	broadPhase.addMoving(&sphere);
+
+	Contact contacts[16];
+	CollisionData data;
+	data.contactArray = contacts;
+	data.friction = (real)0.5;
+	data.restitution = 0;
+
+	ContactResolver resolver(32);
+	std::vector<PrimitivePair> pairs;
+
+	for (unsigned step = 0; step < 60; step++) {
+		sphere.calculateInternals();
+
+		unsigned count = broadPhase.findPairs(pairs, duration);
+		data.reset(16);
+		CollisionDispatcher::standard().collide(pairs.data(), count, duration, &data);
+		resolver.resolveContacts(contacts, data.contactCount, duration);
+
+		ball.integrate(duration);
+	}
+
+	return ball.getPosition().y;
+}
+
+int main() {
+	int failures = 0;
+
+	// without the flag the sphere is tested discretely and passes through
+	real discrete = dropSphere(false);
+	if (discrete > 0) {
+		cout << "discrete sphere did not tunnel, the test does not exercise ccd (y=" << discrete << ")" << endl;
+		failures++;
+	}
+
+	// with it the sphere comes to rest on the floor
+	real continuous = dropSphere(true);
+	if (continuous < (real)0.09 || continuous > (real)0.13) {
+		cout << "continuous sphere did not stop on the floor (y=" << continuous << ")" << endl;
+		failures++;
+	}
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#include <cyclone/contact_buffer.h>
+#include <cyclone/pworld.h>
+
+#include <iostream>
+
+using namespace cyclone;
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+	if (condition) return;
+	cout << "failed: " << what << endl;
+	failures++;
+}
+
+/*
+* a generator that always has the same number of resting contacts
+*/
+class FixedContacts : public ParticleContactGenerator {
+public:
+	unsigned count = 0;
+	Particle* particle = nullptr;
+
+	virtual unsigned addContact(ParticleContact* contact, unsigned limit) const {
+		unsigned added = 0;
+		for (; added < count && added < limit; added++) {
+			contact[added].particles[0] = particle;
+			contact[added].particles[1] = nullptr;
+			contact[added].contactNormal = Vector3(0, 1, 0);
+			contact[added].penetration = 0;
+			contact[added].restitution = 0;
+		}
+		return added;
+	}
+};
+
+/*
+* runs one frame of a world whose generators have one and two contacts,
+* returns the buffer's statistics after it
+*/
+static ContactBufferStats runFrame(unsigned capacity, bool growable, unsigned maxCapacity, unsigned one, unsigned two) {
+	ParticleWorld world(capacity, 1);
+	world.getContactBuffer().setGrowable(growable, maxCapacity);
+
+	Particle particle;
+	particle.setmass(1);
+	particle.damping = 1;
+	world.getParticles().push_back(&particle);
+
+	FixedContacts first, second;
+	first.count = one;
+	first.particle = &particle;
+	second.count = two;
+	second.particle = &particle;
+	world.getContactGenerators().push_back(&first);
+	world.getContactGenerators().push_back(&second);
+
+	world.startFrame();
+	world.runPhysics((real)0.01);
+
+	world.getParticles().clear();
+	return world.getContactBuffer().getStats();
+}
+
+int main() {
+	// a growable buffer doubles up to its maximum and no further
+	{
+		ContactBuffer<ParticleContact> buffer(4);
+		buffer.setGrowable(true, 16);
+		check(buffer.reserve(10, 0) && buffer.capacity() == 16, "grows to the maximum");
+		check(buffer.getStats().growths == 1, "one growth to the maximum");
+		check(!buffer.canGrow(), "can not grow past the maximum");
+		check(!buffer.reserve(17, 0) && buffer.capacity() == 16, "stops at the maximum");
+		buffer.endFrame(16);
+		check(buffer.getStats().overflows == 1, "a failed reserve counts an overflow");
+	}
+
+	// exactly full is not an overflow, one more contact than fits is
+	{
+		ContactBufferStats stats = runFrame(8, false, 0, 5, 3);
+		check(stats.overflows == 0 && stats.lastCount == 8, "fixed buffer filled exactly");
+
+		stats = runFrame(8, false, 0, 5, 4);
+		check(stats.overflows == 1 && stats.lastCount == 8, "fixed buffer one contact over");
+
+		stats = runFrame(8, true, 16, 16, 0);
+		check(stats.overflows == 0 && stats.capacity == 16 && stats.lastCount == 16, "grown buffer filled exactly at the maximum");
+
+		stats = runFrame(8, true, 16, 16, 1);
+		check(stats.overflows == 1 && stats.lastCount == 16, "grown buffer one contact over the maximum");
+
+		stats = runFrame(8, true, 0, 100, 3);
+		check(stats.overflows == 0 && stats.lastCount == 103 && stats.capacity == 128, "unbounded buffer doubles until everything fits");
+	}
+
+	// a run of quiet frames shrinks the buffer to twice their high water mark
+	{
+		ContactBuffer<ParticleContact> buffer(4);
+		buffer.setGrowable(true);
+		buffer.setShrinkPolicy(3);
+		buffer.reserve(64, 0);
+		buffer.endFrame(40);
+
+		buffer.endFrame(5);
+		buffer.endFrame(3);
+		check(buffer.capacity() == 64, "keeps its size until the run is long enough");
+
+		buffer.endFrame(2);
+		check(buffer.capacity() == 10 && buffer.getStats().shrinks == 1, "shrinks after the quiet frames");
+
+		// never below the starting capacity
+		buffer.endFrame(0);
+		buffer.endFrame(0);
+		buffer.endFrame(0);
+		check(buffer.capacity() == 4, "shrinks no further than the starting capacity");
+	}
+
+	return failures == 0 ? 0 : 1;
+}
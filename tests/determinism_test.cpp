@@ -0,0 +1,138 @@
+#include <cyclone/pworld.h>
+#include <cyclone/psprings.h>
+#include <cyclone/body_step.h>
+#include <cyclone/task_graph.h>
+
+#include <iostream>
+#include <vector>
+
+using namespace cyclone;
+
+using namespace std;
+
+/*
+* a hanging cloth, a rope of constraints and a pile of spheres on a floor
+* the same scene is built for every run, only the threading differs
+*/
+struct Scene {
+	ParticleWorld particleWorld;
+	ParticleSpringNetwork cloth;
+
+	vector<Particle> ropeParticles;
+
+	vector<RigidBody> bodyStorage;
+	vector<RigidBody*> bodies;
+	vector<CollisionSphere> spheres;
+	vector<CollisionPrimitive*> primitives;
+	CollisionBox floor;
+	ForceRegistry forces;
+	Gravity gravity;
+	CollisionBroadPhase broadPhase;
+	ContactResolver resolver;
+	RigidBodyStep bodyStep;
+
+	Scene() : particleWorld(256), cloth(particleWorld.getParticles()), gravity(Vector3(0, (real)-9.81, 0)),
+		resolver(64), bodyStep(bodies, primitives, forces, broadPhase, resolver) {
+		particleWorld.setDeterministic(true);
+
+		const unsigned columns = 12, rows = 12;
+		for (unsigned i = 0; i < columns * rows; i++) {
+			ParticleWorld::ParticleHandle handle = particleWorld.createParticle();
+			Particle* particle = particleWorld.getParticle(handle);
+			particle->damping = (real)0.99;
+			particle->accelaration = Vector3(0, (real)-9.81, 0);
+			particle->setmass(i < columns ? 0 : 1);
+		}
+		cloth.buildCloth(0, columns, rows, Vector3(0, 10, 0), Vector3((real)0.2, 0, (real)0.05), Vector3(0, (real)-0.2, 0), 400, 2);
+		particleWorld.getForceRegistry().addBatch(&cloth);
+
+		// a rope hanging from a fixed end, solved by colours
+		ropeParticles.resize(40);
+		for (unsigned i = 0; i < ropeParticles.size(); i++) {
+			Particle& particle = ropeParticles[i];
+			particle.position = Vector3(5 + i * (real)0.1, 8, 0);
+			particle.damping = (real)0.99;
+			particle.accelaration = Vector3(0, (real)-9.81, 0);
+			particle.setmass(i == 0 ? 0 : 1);
+			particleWorld.getParticles().push_back(&particle);
+			if (i > 0) particleWorld.getConstraintSolver().addRod(&ropeParticles[i - 1], &particle, (real)0.1);
+		}
+		particleWorld.getConstraintSolver().setMode(ParticleConstraintSolver::SOLVE_COLOURED);
+
+		bodyStorage.resize(150);
+		spheres.resize(bodyStorage.size());
+		for (unsigned i = 0; i < bodyStorage.size(); i++) {
+			RigidBody& body = bodyStorage[i];
+			body.setMass(1);
+			Matrix3 tensor;
+			tensor.setInertiaTensorCoeffs((real)0.016, (real)0.016, (real)0.016);
+			body.setInertiaTensor(tensor);
+			body.setDamping((real)0.99, (real)0.99);
+			body.setPosition((i % 10) * (real)0.41, (real)0.3 + (i / 10) * (real)0.45, (i % 3) * (real)0.15);
+			body.setRotation(0, 0, (real)0.1 * (i % 5));
+			body.calculateDerivedData();
+			bodies.push_back(&body);
+
+			spheres[i].body = &body;
+			spheres[i].radius = (real)0.2;
+			primitives.push_back(&spheres[i]);
+			broadPhase.addMoving(&spheres[i]);
+			forces.add(&body, &gravity);
+		}
+		floor.halfSize = Vector3(50, (real)0.1, 50);
+		floor.calculateInternals();
+		broadPhase.addStatic(&floor);
+	}
+
+	void setThreadPool(ThreadPool* pool) {
+		cloth.setThreadPool(pool);
+		particleWorld.getConstraintSolver().setThreadPool(pool);
+		forces.setThreadPool(pool);
+		bodyStep.setThreadPool(pool);
+	}
+
+	uint64_t stateHash() const {
+		StateHash hash;
+		hash.add((uint64_t)particleWorld.stateHash());
+		hash.add((uint64_t)bodyStep.stateHash());
+		return hash.get();
+	}
+};
+
+int main() {
+	const real duration = (real)1 / 60;
+	const unsigned frames = 240;
+
+	// on the caller, phase after phase
+	Scene serial;
+	vector<uint64_t> expected;
+	for (unsigned frame = 0; frame < frames; frame++) {
+		serial.particleWorld.startFrame();
+		serial.particleWorld.runPhysics(duration);
+		serial.bodyStep.step(duration);
+		expected.push_back(serial.stateHash());
+	}
+
+	// the same scene as one step graph, on pools of different sizes
+	int failures = 0;
+	for (unsigned workers : { 1u, 3u, 7u }) {
+		ThreadPool pool(workers);
+		Scene threaded;
+		threaded.setThreadPool(&pool);
+
+		TaskGraph graph;
+		threaded.particleWorld.addStepTasks(graph);
+		threaded.bodyStep.addStepTasks(graph);
+
+		for (unsigned frame = 0; frame < frames; frame++) {
+			graph.run(duration, pool);
+			if (threaded.stateHash() != expected[frame]) {
+				cout << "state differs from the serial run at frame " << frame << " with " << workers << " workers" << endl;
+				failures++;
+				break;
+			}
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}
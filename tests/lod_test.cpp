@@ -0,0 +1,110 @@
+#include <cyclone/pworld.h>
+
+#include <cmath>
+#include <iostream>
+
+using namespace cyclone;
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+	if (condition) return;
+	cout << "failed: " << what << endl;
+	failures++;
+}
+
+static bool close(real a, real b) {
+	return std::abs(a - b) <= (real)1e-9 * (1 + std::abs(b));
+}
+
+/*
+* a world with one full rate particle at the observer and one
+* integrated every four frames far away
+*/
+struct Pair {
+	ParticleWorld world;
+	Particle* nearby;
+	Particle* distant;
+
+	Pair() : world(16, 1) {
+		world.addLodTier(10, 4);
+		world.addObserver(Vector3());
+
+		nearby = world.getParticle(world.createParticle());
+		distant = world.getParticle(world.createParticle());
+		for (Particle* particle : world.getParticles()) {
+			particle->setmass(2);
+			particle->damping = 1;
+		}
+		distant->position = Vector3(100, 0, 0);
+	}
+};
+
+int main() {
+	const real duration = (real)1 / 60;
+
+	// far particles are integrated less often
+	{
+		ParticleWorld world(16, 1);
+		world.addLodTier(50, 4);
+		world.addLodTier(200, 16);
+		world.addLodTier(500, 0);
+		world.addObserver(Vector3());
+
+		const unsigned count = 1000;
+		for (unsigned i = 0; i < count; i++) {
+			Particle* particle = world.getParticle(world.createParticle());
+			particle->position = Vector3((real)i, 0, 0);
+			particle->damping = 1;
+		}
+
+		const unsigned frames = 64;
+		unsigned integrated = 0;
+		for (unsigned frame = 0; frame < frames; frame++) {
+			world.startFrame();
+			world.runPhysics(duration);
+			integrated += world.getIntegratedCount();
+		}
+		check(integrated * 4 < frames * count, "reduced tiers integrate less");
+		check(integrated > 51 * frames, "the nearest tier runs every frame");
+	}
+
+	// a force on a skipped frame still reaches the particle
+	{
+		Pair pair;
+		const Vector3 push(6, 0, 0);
+		for (unsigned frame = 0; frame < 5; frame++) {
+			pair.world.startFrame();
+			if (frame == 1) {
+				pair.nearby->addForce(push);
+				pair.distant->addForce(push);
+			}
+			pair.world.runPhysics(duration);
+		}
+		check(close(pair.nearby->velocity.x, 3 * duration), "full rate particle takes the push");
+		check(close(pair.distant->velocity.x, pair.nearby->velocity.x), "reduced particle takes the same push");
+	}
+
+	// position verlet stays exact for constant accelaration across a tier change
+	{
+		Pair pair;
+		pair.world.getIntegrationContext().setScheme(IntegrationContext::INTEGRATE_POSITION_VERLET);
+		const Vector3 gravity(0, -10, 0);
+		for (Particle* particle : pair.world.getParticles()) particle->accelaration = gravity;
+
+		const unsigned frames = 9;
+		for (unsigned frame = 0; frame < frames; frame++) {
+			pair.world.startFrame();
+			pair.world.runPhysics(duration);
+		}
+
+		real time = duration * frames;
+		real expected = (real)-5 * time * time;
+		check(close(pair.nearby->position.y, expected), "full rate verlet");
+		check(close(pair.distant->position.y, expected), "reduced verlet uses its own previous step");
+	}
+
+	return failures == 0 ? 0 : 1;
+}
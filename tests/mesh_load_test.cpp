@@ -0,0 +1,142 @@
+#include <cyclone/collide_mesh.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace cyclone;
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+	if (condition) return;
+	cout << "failed: " << what << endl;
+	failures++;
+}
+
+static vector<unsigned char> readFile(const char* path) {
+	vector<unsigned char> bytes;
+	FILE* in = fopen(path, "rb");
+	if (!in) return bytes;
+	unsigned char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(in);
+	return bytes;
+}
+
+/*
+* writes a copy of a saved file with one 32 bit value replaced
+*/
+static void writePatched(const char* path, const vector<unsigned char>& bytes, size_t offset, int32_t value) {
+	vector<unsigned char> patched = bytes;
+	memcpy(patched.data() + offset, &value, sizeof(value));
+	FILE* out = fopen(path, "wb");
+	fwrite(patched.data(), 1, patched.size(), out);
+	fclose(out);
+}
+
+/*
+* the nodes are the last section, the data of node i is its last four bytes
+*/
+static size_t nodeData(const vector<unsigned char>& bytes, unsigned nodeCount, unsigned node) {
+	return bytes.size() - (nodeCount - node) * sizeof(QuantizedTree::Node) + offsetof(QuantizedTree::Node, data);
+}
+
+static unsigned firstInner(const QuantizedTree& tree) {
+	for (unsigned i = 0; i < tree.getNodeCount(); i++) {
+		if (!tree.getNodes()[i].isLeaf()) return i;
+	}
+	return 0;
+}
+
+static unsigned firstLeaf(const QuantizedTree& tree) {
+	for (unsigned i = 0; i < tree.getNodeCount(); i++) {
+		if (tree.getNodes()[i].isLeaf()) return i;
+	}
+	return 0;
+}
+
+int main() {
+	const char* original = "mesh_load_test_original.bin";
+	const char* patched = "mesh_load_test_patched.bin";
+
+	// a 4x4 grid of vertices, two triangles per cell
+	{
+		vector<Vector3> vertices;
+		vector<unsigned> indices;
+		for (unsigned z = 0; z < 4; z++) {
+			for (unsigned x = 0; x < 4; x++) vertices.push_back(Vector3((real)x, (real)(x * z % 3), (real)z));
+		}
+		for (unsigned z = 0; z < 3; z++) {
+			for (unsigned x = 0; x < 3; x++) {
+				unsigned corner = z * 4 + x;
+				unsigned cell[6] = { corner, corner + 4, corner + 1, corner + 1, corner + 4, corner + 5 };
+				indices.insert(indices.end(), cell, cell + 6);
+			}
+		}
+
+		CollisionMesh mesh;
+		mesh.build(vertices.data(), (unsigned)vertices.size(), indices.data(), (unsigned)indices.size() / 3);
+		check(mesh.save(original), "mesh saves");
+
+		CollisionMesh loaded;
+		check(loaded.load(original) && loaded.getTriangleCount() == 18, "mesh loads");
+
+		vector<unsigned char> bytes = readFile(original);
+		unsigned nodes = mesh.getTree().getNodeCount();
+
+		// the index section is found by its contents
+		size_t indexBytes = indices.size() * sizeof(unsigned);
+		size_t at = 0;
+		while (at + indexBytes <= bytes.size() && memcmp(bytes.data() + at, indices.data(), indexBytes) != 0) at++;
+		check(at + indexBytes <= bytes.size(), "index section found");
+
+		writePatched(patched, bytes, at + 4 * sizeof(unsigned), 16);
+		check(!loaded.load(patched), "rejects an index past the vertices");
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstLeaf(mesh.getTree())), 18);
+		check(!loaded.load(patched), "rejects a leaf past the triangles");
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstInner(mesh.getTree())), -(int32_t)nodes - 1);
+		check(!loaded.load(patched), "rejects a skip past the nodes");
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstInner(mesh.getTree())), INT32_MIN);
+		check(!loaded.load(patched), "rejects the most negative skip");
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstInner(mesh.getTree())), -1);
+		check(!loaded.load(patched), "rejects a skip that does not move on");
+
+		check(loaded.load(original) && loaded.getTriangleCount() == 18, "still loads the good file");
+	}
+
+	// a 9x9 heightfield is 2x2 tiles
+	{
+		vector<real> heights(81);
+		for (unsigned i = 0; i < heights.size(); i++) heights[i] = (real)(i % 5);
+
+		CollisionHeightfield field;
+		field.build(heights.data(), 9, 9, 1);
+		check(field.save(original), "heightfield saves");
+
+		CollisionHeightfield loaded;
+		check(loaded.load(original), "heightfield loads");
+
+		vector<unsigned char> bytes = readFile(original);
+		unsigned nodes = field.getTree().getNodeCount();
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstLeaf(field.getTree())), 4);
+		check(!loaded.load(patched), "rejects a leaf past the tiles");
+
+		writePatched(patched, bytes, nodeData(bytes, nodes, firstInner(field.getTree())), -100);
+		check(!loaded.load(patched), "rejects a heightfield skip past the nodes");
+	}
+
+	remove(original);
+	remove(patched);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include <cyclone/pworld.h>
+#include <cyclone/snapshot.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace cyclone;
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+	if (condition) return;
+	cout << "failed: " << what << endl;
+	failures++;
+}
+
+/*
+* every state of a frame carries the frame number, and the number of
+* states depends on the frame too, so a torn read shows up as a mismatch
+*/
+static unsigned stateCount(uint64_t frame) {
+	return 1 + (unsigned)(frame % 17);
+}
+
+static bool publish(SnapshotBuffer& buffer, uint64_t frame) {
+	unsigned count = stateCount(frame);
+	TransformState* states = buffer.beginPublish(count);
+	if (!states) return false;
+	for (unsigned i = 0; i < count; i++) {
+		states[i].position = Vector3((real)frame, (real)i, 0);
+		states[i].orientation = Quaternion(1, 0, 0, 0);
+		states[i].velocity = Vector3((real)frame, 0, 0);
+		states[i].rotation = Vector3();
+	}
+	buffer.endPublish(frame);
+	return true;
+}
+
+int main() {
+	// a reader holding every spare buffer makes the writer skip, not wait
+	{
+		SnapshotBuffer buffer;
+		check(buffer.read().empty(), "empty before the first publish");
+
+		publish(buffer, 1);
+		SnapshotBuffer::View first = buffer.read();
+		publish(buffer, 2);
+		SnapshotBuffer::View second = buffer.read();
+		publish(buffer, 3);
+		SnapshotBuffer::View third = buffer.read();
+
+		check(!publish(buffer, 4) && buffer.getSkipped() == 1, "skips while every spare is read");
+		check(first.frame() == 1 && second.frame() == 2 && third.frame() == 3, "held views keep their frames");
+		check(buffer.read().frame() == 3, "the skipped frame is not published");
+
+		first = SnapshotBuffer::View();
+		check(publish(buffer, 5) && buffer.read().frame() == 5, "publishes again once a spare is released");
+	}
+
+	// concurrent readers only ever see whole frames, in order
+	{
+		SnapshotBuffer buffer;
+		const uint64_t steps = 20000;
+		atomic<bool> done{ false };
+		atomic<unsigned> torn{ 0 };
+		atomic<unsigned> backwards{ 0 };
+
+		vector<thread> readers;
+		for (unsigned r = 0; r < 4; r++) {
+			readers.emplace_back([&]() {
+				uint64_t last = 0;
+				while (!done.load()) {
+					SnapshotBuffer::View view = buffer.read();
+					if (view.empty()) continue;
+
+					uint64_t frame = view.frame();
+					if (frame < last) backwards++;
+					last = frame;
+
+					if (view.size() != stateCount(frame)) torn++;
+					for (unsigned i = 0; i < view.size(); i++) {
+						if (view[i].position.x != (real)frame || view[i].position.y != (real)i ||
+							view[i].velocity.x != (real)frame) {
+							torn++;
+							break;
+						}
+					}
+				}
+			});
+		}
+
+		unsigned published = 0;
+		for (uint64_t frame = 1; frame <= steps; frame++) {
+			if (publish(buffer, frame)) published++;
+		}
+		done.store(true);
+		for (thread& reader : readers) reader.join();
+
+		check(torn.load() == 0, "no torn snapshots");
+		check(backwards.load() == 0, "frames never go backwards");
+		check(published + buffer.getSkipped() == steps, "every frame is published or counted as skipped");
+	}
+
+	// a particle world publishes its particles once per frame
+	{
+		ParticleWorld world(16, 1);
+		SnapshotBuffer buffer;
+		world.setSnapshotBuffer(&buffer);
+
+		Particle* particle = world.getParticle(world.createParticle());
+		particle->setmass(1);
+		particle->damping = 1;
+		particle->position = Vector3(1, 2, 3);
+		particle->velocity = Vector3(0, 1, 0);
+
+		world.startFrame();
+		world.runPhysics((real)0.5);
+
+		SnapshotBuffer::View view = buffer.read();
+		check(view.size() == 1 && view.frame() == 1, "one particle in frame one");
+		check(view[0].position.y == particle->position.y && view[0].velocity.y == particle->velocity.y,
+			"the snapshot matches the particle");
+	}
+
+	return failures == 0 ? 0 : 1;
+}